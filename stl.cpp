@@ -1,14 +1,6251 @@
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <set>
+#include <string>
+#include <string_view>
 #include <random>
 #include <algorithm>
 #include <iterator>
 #include <numeric>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <optional>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <deque>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
 
 #include <functional>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 // #include <execution>
 
+// Thread pool - persistent workers shared by every par_ algorithm below, scheduled by work stealing
+// parallel_for(count, f) runs f(0) .. f(count - 1) on the workers and the calling thread and returns when all are done.
+// Every thread running tasks owns a Chase-Lev deque: it pushes and pops ranges of indices at the bottom, idle threads
+// steal from the top. A thread working through a range splits its upper half off onto its deque whenever the deque is
+// empty (lazy binary splitting), so ranges are only cut while other threads can take them and the grain adapts to the
+// load. A thread waiting for its parallel_for runs other tasks meanwhile, so nested calls, from inside a task or from
+// many request threads at once, share the same workers and never add threads. STL_PIN=1 pins the workers to the
+// allowed CPUs in NUMA node order, and thieves then try their own node first.
+class thread_pool {
+public:
+    explicit thread_pool(unsigned threads = std::max(1u, std::thread::hardware_concurrency()), bool pin = false)
+        : worker_count(threads - 1), slots(new slot[worker_count + external_slots]) {
+        std::vector<std::pair<int, int>> cpus = pin ? allowed_cpus() : std::vector<std::pair<int, int>>();
+        for(std::size_t i = 0; i < worker_count; ++i){
+            if(!cpus.empty()) slots[i].node = cpus[(i + 1) % cpus.size()].first;
+            workers.emplace_back([this, i]{ worker_loop(i); });
+#if defined(__linux__)
+            if(!cpus.empty()){
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[(i + 1) % cpus.size()].second, &set);
+                pthread_setaffinity_np(workers.back().native_handle(), sizeof(set), &set);
+            }
+#endif
+        }
+    }
+
+    ~thread_pool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ++epoch;
+        }
+        wake.notify_all();
+        for(auto& w : workers) w.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    std::size_t size() const { return workers.size() + 1; }
+
+    template<typename F>
+    void parallel_for(std::size_t count, F&& f){
+        if(count == 0) return;
+        const slot_guard guard(*this);
+        if(count == 1 || workers.empty() || guard.index == no_slot){
+            for(std::size_t i = 0; i < count; ++i) f(i);
+            return;
+        }
+
+        job task;
+        task.context = &f;
+        task.call = [](void* context, std::size_t i){ (*static_cast<std::remove_reference_t<F>*>(context))(i); };
+        task.remaining.store(count, std::memory_order_relaxed);
+        execute({&task, 0, count}, guard.index);
+        wait(task, guard.index);
+        if(task.error) std::rethrow_exception(task.error);
+    }
+
+private:
+    struct job {
+        void (*call)(void*, std::size_t) = nullptr;
+        void* context = nullptr;
+        std::atomic<std::size_t> remaining{0};      // indices not run yet; the job is done at 0
+        std::mutex error_mutex;
+        std::exception_ptr error;                   // first exception thrown by call
+    };
+
+    struct range_task {
+        job* owner;
+        std::size_t begin, end;
+    };
+
+    // Chase-Lev deque with a fixed capacity (Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for
+    // Weak Memory Models"). push and pop are for the owning thread only. Slots are atomics, so a thief reading a slot the
+    // owner is reusing reads a stale task whose steal then fails, never a torn one.
+    class task_deque {
+    public:
+        bool push(const range_task& task){
+            const std::int64_t b = bottom.load(std::memory_order_relaxed);
+            if(b - top.load(std::memory_order_acquire) >= capacity) return false;
+            store(b, task);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        bool pop(range_task& task){
+            const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top.load(std::memory_order_relaxed);
+            if(t > b){
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            task = load(b);
+            if(t == b){
+                // Last task: races with thieves for it
+                const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        bool steal(range_task& task){
+            std::int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::int64_t b = bottom.load(std::memory_order_acquire);
+            if(t >= b) return false;
+            task = load(t);
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        bool empty() const { return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr std::int64_t capacity = 256;
+
+        struct cell {
+            std::atomic<job*> owner{nullptr};
+            std::atomic<std::size_t> begin{0}, end{0};
+        };
+
+        void store(std::int64_t i, const range_task& task){
+            cell& c = cells[i & (capacity - 1)];
+            c.owner.store(task.owner, std::memory_order_relaxed);
+            c.begin.store(task.begin, std::memory_order_relaxed);
+            c.end.store(task.end, std::memory_order_relaxed);
+        }
+
+        range_task load(std::int64_t i) const {
+            const cell& c = cells[i & (capacity - 1)];
+            return {c.owner.load(std::memory_order_relaxed), c.begin.load(std::memory_order_relaxed), c.end.load(std::memory_order_relaxed)};
+        }
+
+        alignas(64) std::atomic<std::int64_t> top{0};
+        alignas(64) std::atomic<std::int64_t> bottom{0};
+        cell cells[capacity];
+    };
+
+    // A deque and the NUMA node of its thread (-1 = unknown). Workers own the first worker_count slots; threads from
+    // outside take a free one of the others for the length of their call.
+    struct alignas(64) slot {
+        task_deque deque;
+        int node = -1;
+        std::atomic<bool> in_use{false};
+    };
+
+    static constexpr std::size_t external_slots = 64;
+    static constexpr std::size_t no_slot = ~std::size_t(0);
+
+    // The slot of the calling thread for one parallel_for: its own inside the pool, a free external one otherwise,
+    // no_slot if all are taken (the call then runs serially)
+    struct slot_guard {
+        explicit slot_guard(thread_pool& pool) : pool(pool), previous_pool(current_pool), previous_slot(current_slot) {
+            if(current_pool == &pool){
+                index = current_slot;
+                return;
+            }
+            for(std::size_t i = pool.worker_count; i < pool.worker_count + external_slots; ++i){
+                bool expected = false;
+                if(!pool.slots[i].in_use.load(std::memory_order_relaxed) &&
+                   pool.slots[i].in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)){
+                    index = i;
+                    acquired = true;
+                    std::size_t used = pool.slots_used.load(std::memory_order_relaxed);
+                    while(used < i + 1 && !pool.slots_used.compare_exchange_weak(used, i + 1)){}
+                    current_pool = &pool;
+                    current_slot = i;
+                    return;
+                }
+            }
+        }
+
+        ~slot_guard(){
+            if(!acquired) return;
+            current_pool = previous_pool;
+            current_slot = previous_slot;
+            pool.slots[index].in_use.store(false, std::memory_order_release);
+        }
+
+        thread_pool& pool;
+        const thread_pool* previous_pool;
+        std::size_t previous_slot;
+        std::size_t index = no_slot;
+        bool acquired = false;
+    };
+
+    // Runs a range on the thread of slot 'self', splitting off its upper half whenever the deque of the slot is empty
+    void execute(range_task task, std::size_t self){
+        task_deque& own = slots[self].deque;
+        std::size_t done = 0;
+        for(std::size_t i = task.begin; i < task.end; ++i, ++done){
+            if(task.end - i > 1 && own.empty()){
+                const std::size_t middle = i + (task.end - i + 1) / 2;
+                if(own.push({task.owner, middle, task.end})){
+                    task.end = middle;
+                    wake_sleepers(false);
+                }
+            }
+            try { task.owner->call(task.owner->context, i); }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(task.owner->error_mutex);
+                if(!task.owner->error) task.owner->error = std::current_exception();
+            }
+        }
+        // The last access to the job: its caller may return as soon as remaining reaches 0
+        if(task.owner->remaining.fetch_sub(done, std::memory_order_acq_rel) == done) wake_sleepers(true);
+    }
+
+    // Own deque first, then the other slots from a random one on, on the same NUMA node first
+    bool find_task(std::size_t self, range_task& task){
+        if(slots[self].deque.pop(task)) return true;
+        const std::size_t n = slots_used.load(std::memory_order_acquire);
+        thread_local std::uint64_t random = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<std::uintptr_t>(&random);
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        const std::size_t start = random % n;
+        const int node = slots[self].node;
+        for(int pass = node < 0 ? 1 : 0; pass < 2; ++pass){
+            for(std::size_t k = 0; k < n; ++k){
+                const std::size_t victim = (start + k) % n;
+                if(victim == self || (pass == 0 && slots[victim].node != node)) continue;
+                if(slots[victim].deque.steal(task)) return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs tasks until the job is done, sleeping when there are none to run
+    void wait(job& task, std::size_t self){
+        range_task other;
+        for(unsigned idle = 0; task.remaining.load(std::memory_order_acquire) != 0;){
+            if(find_task(self, other)){
+                execute(other, self);
+                idle = 0;
+            }
+            else if(++idle < 64) std::this_thread::yield();
+            else sleep([&]{ return task.remaining.load(std::memory_order_acquire) == 0; });
+        }
+    }
+
+    void worker_loop(std::size_t self){
+        current_pool = this;
+        current_slot = self;
+        range_task task;
+        for(unsigned idle = 0;;){
+            if(find_task(self, task)){
+                execute(task, self);
+                idle = 0;
+            }
+            else if(++idle < 64) std::this_thread::yield();
+            else if(sleep([&]{ return stopping; })) return;
+        }
+    }
+
+    // Blocks until the next push or finished job unless there is work or done() holds; returns done()
+    template<typename Done>
+    bool sleep(Done done){
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::uint64_t seen = epoch;
+        const std::size_t n = slots_used.load(std::memory_order_acquire);
+        bool work = false;
+        for(std::size_t i = 0; i < n && !work; ++i) work = !slots[i].deque.empty();
+        if(!work && !done()) wake.wait(lock, [&]{ return epoch != seen; });
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+        return done();
+    }
+
+    void wake_sleepers(bool all){
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(sleeping.load(std::memory_order_seq_cst) == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++epoch;
+        }
+        if(all) wake.notify_all();
+        else    wake.notify_one();
+    }
+
+    // (NUMA node, CPU) of every CPU this process may run on, ordered by node
+    static std::vector<std::pair<int, int>> allowed_cpus(){
+        std::vector<std::pair<int, int>> cpus;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return cpus;
+        std::vector<int> node_of(CPU_SETSIZE, 0);
+        for(int node = 0;; ++node){
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if(!list) break;
+            // e.g. 0-3,8-11
+            for(std::string range; std::getline(list, range, ',');){
+                const std::size_t dash = range.find('-');
+                const int first = std::atoi(range.c_str()), last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+                for(int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) node_of[cpu] = node;
+            }
+        }
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if(CPU_ISSET(cpu, &allowed)) cpus.push_back({node_of[cpu], cpu});
+        std::stable_sort(cpus.begin(), cpus.end(), [](auto& a, auto& b){ return a.first < b.first; });
+#endif
+        return cpus;
+    }
+
+    const std::size_t worker_count;
+    std::unique_ptr<slot[]> slots;
+    std::atomic<std::size_t> slots_used{worker_count};      // slots thieves look at: the workers' and the external ones taken so far
+    std::vector<std::thread> workers;
+    std::mutex mutex;                                       // guards epoch and stopping
+    std::condition_variable wake;
+    std::uint64_t epoch = 0;                                // bumped by every wake_sleepers
+    std::atomic<unsigned> sleeping{0};
+    bool stopping = false;
+    static inline thread_local const thread_pool* current_pool = nullptr;
+    static inline thread_local std::size_t current_slot = 0;
+};
+
+// Shared pool, one thread per hardware thread unless STL_THREADS overrides it; STL_PIN=1 pins its workers
+thread_pool& default_thread_pool(){
+    static thread_pool pool(std::getenv("STL_THREADS") ? std::max(1, std::atoi(std::getenv("STL_THREADS")))
+                                                       : std::max(1u, std::thread::hardware_concurrency()),
+                            std::getenv("STL_PIN") != nullptr && std::string(std::getenv("STL_PIN")) == "1");
+    return pool;
+}
+
+// Number of elements per parallel chunk: sized so a chunk of input stays resident in L2.
+// Chunk boundaries depend only on this value, never on the number of threads, and partial results are combined
+// left to right, so floating point results are identical from run to run and machine to machine.
+template<typename T>
+constexpr std::size_t parallel_chunk_elements(){
+    return std::max<std::size_t>(1, (256 * 1024) / sizeof(T));
+}
+
+// Splits [0, n) into chunks of parallel_chunk_elements<T>() and calls f(chunk_index, begin, end) in parallel
+template<typename T, typename F>
+void parallel_chunks(std::size_t n, F&& f){
+    const std::size_t chunk = parallel_chunk_elements<T>();
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+    default_thread_pool().parallel_for(chunks, [&](std::size_t c){
+        f(c, c * chunk, std::min(n, (c + 1) * chunk));
+    });
+}
+
+// par_transform_reduce - reduce(transform(x)) over cache-sized chunks on the thread pool
+// Unlike std::reduce the combination order is fixed, so non-associative operations (float +) are reproducible.
+template<typename RandomIt, typename T, typename BinaryOp, typename UnaryOp>
+T par_transform_reduce(RandomIt first, RandomIt last, T init, BinaryOp reduce, UnaryOp transform){
+    const std::size_t n = last - first;
+    if(n == 0) return init;
+
+    const std::size_t chunk = parallel_chunk_elements<typename std::iterator_traits<RandomIt>::value_type>();
+    std::vector<std::optional<T>> partials((n + chunk - 1) / chunk);
+    parallel_chunks<typename std::iterator_traits<RandomIt>::value_type>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        T acc = transform(first[begin]);
+        for(std::size_t i = begin + 1; i < end; ++i) acc = reduce(std::move(acc), transform(first[i]));
+        partials[c] = std::move(acc);
+    });
+
+    for(auto& p : partials) init = reduce(std::move(init), std::move(*p));
+    return init;
+}
+
+// Two-range form, e.g. a parallel inner_product
+template<typename RandomIt1, typename RandomIt2, typename T, typename BinaryOp1, typename BinaryOp2>
+T par_transform_reduce(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, T init, BinaryOp1 reduce, BinaryOp2 transform){
+    const std::size_t n = last1 - first1;
+    if(n == 0) return init;
+
+    const std::size_t chunk = parallel_chunk_elements<typename std::iterator_traits<RandomIt1>::value_type>();
+    std::vector<std::optional<T>> partials((n + chunk - 1) / chunk);
+    parallel_chunks<typename std::iterator_traits<RandomIt1>::value_type>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        T acc = transform(first1[begin], first2[begin]);
+        for(std::size_t i = begin + 1; i < end; ++i) acc = reduce(std::move(acc), transform(first1[i], first2[i]));
+        partials[c] = std::move(acc);
+    });
+
+    for(auto& p : partials) init = reduce(std::move(init), std::move(*p));
+    return init;
+}
+
+template<typename RandomIt1, typename RandomIt2, typename T>
+T par_transform_reduce(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, T init){
+    return par_transform_reduce(first1, last1, first2, init, std::plus<>(), std::multiplies<>());
+}
+
+// par_reduce - parallel std::reduce with a deterministic combination order
+template<typename RandomIt, typename T, typename BinaryOp>
+T par_reduce(RandomIt first, RandomIt last, T init, BinaryOp op){
+    return par_transform_reduce(first, last, init, op, [](const auto& x) -> const auto& { return x; });
+}
+
+template<typename RandomIt, typename T>
+T par_reduce(RandomIt first, RandomIt last, T init){
+    return par_reduce(first, last, init, std::plus<>());
+}
+
+// Shared implementation of the four scans. Pass 1 reduces every chunk, the chunk totals are scanned serially,
+// pass 2 rescans every chunk starting from its offset. Output may alias input (d_first == first).
+template<bool Inclusive, typename RandomIt, typename OutputIt, typename T, typename BinaryOp, typename UnaryOp>
+OutputIt par_scan(RandomIt first, RandomIt last, OutputIt d_first, std::optional<T> init, BinaryOp op, UnaryOp transform){
+    const std::size_t n = last - first;
+    if(n == 0) return d_first;
+
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t chunk = parallel_chunk_elements<value_type>();
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+
+    // Pass 1 - totals of every chunk but the last
+    std::vector<std::optional<T>> offsets(chunks);
+    parallel_chunks<value_type>((chunks - 1) * chunk, [&](std::size_t c, std::size_t begin, std::size_t end){
+        T acc = transform(first[begin]);
+        for(std::size_t i = begin + 1; i < end; ++i) acc = op(std::move(acc), transform(first[i]));
+        offsets[c + 1] = std::move(acc);
+    });
+
+    // Offsets of each chunk, carrying init in front
+    offsets[0] = init;
+    for(std::size_t c = 1; c < chunks; ++c)
+        if(offsets[c - 1]) offsets[c] = op(*offsets[c - 1], std::move(*offsets[c]));
+
+    // Pass 2
+    parallel_chunks<value_type>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        std::optional<T> acc = offsets[c];
+        for(std::size_t i = begin; i < end; ++i){
+            T x = transform(first[i]);
+            if constexpr (Inclusive){
+                acc = acc ? op(std::move(*acc), std::move(x)) : std::move(x);
+                d_first[i] = *acc;
+            }
+            else {
+                d_first[i] = *acc;
+                acc = op(std::move(*acc), std::move(x));
+            }
+        }
+    });
+    return d_first + n;
+}
+
+// par_inclusive_scan / par_exclusive_scan / par_transform_inclusive_scan / par_transform_exclusive_scan
+// Parallel versions of the <numeric> scans, deterministic for floating point like par_reduce
+template<typename RandomIt, typename OutputIt, typename BinaryOp, typename UnaryOp>
+OutputIt par_transform_inclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op, UnaryOp transform){
+    using T = std::decay_t<decltype(transform(*first))>;
+    return par_scan<true>(first, last, d_first, std::optional<T>(), op, transform);
+}
+
+template<typename RandomIt, typename OutputIt, typename BinaryOp, typename UnaryOp, typename T>
+OutputIt par_transform_inclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op, UnaryOp transform, T init){
+    return par_scan<true>(first, last, d_first, std::optional<T>(std::move(init)), op, transform);
+}
+
+template<typename RandomIt, typename OutputIt, typename T, typename BinaryOp, typename UnaryOp>
+OutputIt par_transform_exclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, T init, BinaryOp op, UnaryOp transform){
+    return par_scan<false>(first, last, d_first, std::optional<T>(std::move(init)), op, transform);
+}
+
+template<typename RandomIt, typename OutputIt, typename BinaryOp = std::plus<>>
+OutputIt par_inclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op = BinaryOp()){
+    return par_transform_inclusive_scan(first, last, d_first, op, [](const auto& x){ return x; });
+}
+
+template<typename RandomIt, typename OutputIt, typename BinaryOp, typename T>
+OutputIt par_inclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op, T init){
+    return par_transform_inclusive_scan(first, last, d_first, op, [](const auto& x){ return x; }, std::move(init));
+}
+
+template<typename RandomIt, typename OutputIt, typename T, typename BinaryOp = std::plus<>>
+OutputIt par_exclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, T init, BinaryOp op = BinaryOp()){
+    return par_transform_exclusive_scan(first, last, d_first, std::move(init), op, [](const auto& x){ return x; });
+}
+
+// SIMD numeric kernels - simd_accumulate, simd_inner_product, simd_partial_sum, simd_adjacent_difference
+// Drop-in replacements for the <numeric> algorithms on contiguous int32 / int64 / float / double ranges. The best
+// instruction set (AVX-512, AVX2) is picked at run time, other CPUs, element types and iterators use the std:: version.
+// Integer results are identical to std::. Floating point sums are reassociated across vector lanes, like std::reduce.
+enum class simd_isa { scalar, avx2, avx512 };
+
+// Detected once. STL_SIMD=scalar|avx2 lowers the level, e.g. to compare kernels on the same machine
+simd_isa detect_simd_isa(){
+    static const simd_isa isa = []{
+        simd_isa best = simd_isa::scalar;
+#if defined(__GNUC__) && defined(__x86_64__)
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")) best = simd_isa::avx2;
+        if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+           __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw")) best = simd_isa::avx512;
+#endif
+        if(const char* forced = std::getenv("STL_SIMD")){
+            std::string name = forced;
+            if(name == "scalar")                                  best = simd_isa::scalar;
+            else if(name == "avx2" && best == simd_isa::avx512)   best = simd_isa::avx2;
+        }
+        return best;
+    }();
+    return isa;
+}
+
+template<typename T>
+constexpr bool is_simd_numeric_v = std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::int64_t> ||
+                                   std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+// True for iterators whose elements are known to be contiguous in memory
+template<typename It, typename T = typename std::iterator_traits<It>::value_type>
+constexpr bool is_contiguous_iterator_v = std::is_pointer_v<It> ||
+                                          std::is_same_v<It, typename std::vector<T>::iterator> ||
+                                          std::is_same_v<It, typename std::vector<T>::const_iterator>;
+
+template<typename It>
+constexpr bool is_random_access_iterator_v =
+    std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define STL_HAS_SIMD 1
+
+// Vector of Bytes / sizeof(T) lanes, using the GCC vector extensions. The kernels below are written once against it and
+// inlined into AVX2 (32 byte) and AVX-512 (64 byte) entry points, which is where the actual instructions get chosen.
+template<typename T, std::size_t Bytes>
+struct simd_vector {
+    typedef T type __attribute__((vector_size(Bytes)));
+    static constexpr std::size_t lanes = Bytes / sizeof(T);
+};
+
+// v += v shifted up by K lanes, zeros shifted in - one step of the in-register log-step scan
+template<std::size_t K, typename V, std::size_t... I>
+__attribute__((always_inline)) inline void simd_add_shifted(V& v, std::index_sequence<I...>){
+    v += __builtin_shufflevector(v, V{}, (I >= K ? I - K : sizeof...(I))...);
+}
+
+// Every lane set to the last lane of v
+template<typename V, std::size_t... I>
+__attribute__((always_inline)) inline void simd_broadcast_last(const V& v, V& out, std::index_sequence<I...>){
+    out = __builtin_shufflevector(v, v, (I * 0 + sizeof...(I) - 1)...);
+}
+
+template<typename T, std::size_t Bytes>
+__attribute__((always_inline)) inline T simd_accumulate_kernel(const T* data, std::size_t n, T init){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+
+    // Four independent accumulators hide the add latency
+    V acc[4] = {};
+    std::size_t i = 0;
+    for(; i + 4 * W <= n; i += 4 * W){
+        for(std::size_t k = 0; k < 4; ++k){
+            V v;
+            __builtin_memcpy(&v, data + i + k * W, sizeof(V));
+            acc[k] += v;
+        }
+    }
+    for(; i + W <= n; i += W){
+        V v;
+        __builtin_memcpy(&v, data + i, sizeof(V));
+        acc[0] += v;
+    }
+    V total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    T sum = T(0);
+    for(std::size_t k = 0; k < W; ++k) sum += total[k];
+    for(; i < n; ++i) sum += data[i];
+    return init + sum;
+}
+
+template<typename T, std::size_t Bytes>
+__attribute__((always_inline)) inline T simd_inner_product_kernel(const T* a, const T* b, std::size_t n, T init){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+
+    V acc[4] = {};
+    std::size_t i = 0;
+    for(; i + 4 * W <= n; i += 4 * W){
+        for(std::size_t k = 0; k < 4; ++k){
+            V x, y;
+            __builtin_memcpy(&x, a + i + k * W, sizeof(V));
+            __builtin_memcpy(&y, b + i + k * W, sizeof(V));
+            acc[k] += x * y;
+        }
+    }
+    for(; i + W <= n; i += W){
+        V x, y;
+        __builtin_memcpy(&x, a + i, sizeof(V));
+        __builtin_memcpy(&y, b + i, sizeof(V));
+        acc[0] += x * y;
+    }
+    V total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    T sum = T(0);
+    for(std::size_t k = 0; k < W; ++k) sum += total[k];
+    for(; i < n; ++i) sum += a[i] * b[i];
+    return init + sum;
+}
+
+// Prefix sum: log2(W) shift-and-add steps inside the register, then the running total of the previous
+// vectors is added to every lane. out may be equal to in.
+template<typename T, std::size_t Bytes>
+__attribute__((always_inline)) inline void simd_partial_sum_kernel(const T* in, std::size_t n, T* out){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    constexpr auto lanes = std::make_index_sequence<W>();
+
+    V carry = {};
+    std::size_t i = 0;
+    for(; i + W <= n; i += W){
+        V v;
+        __builtin_memcpy(&v, in + i, sizeof(V));
+        simd_add_shifted<1>(v, lanes);
+        simd_add_shifted<2>(v, lanes);
+        if constexpr (W > 4)  simd_add_shifted<4>(v, lanes);
+        if constexpr (W > 8)  simd_add_shifted<8>(v, lanes);
+        v += carry;
+        __builtin_memcpy(out + i, &v, sizeof(V));
+        simd_broadcast_last(v, carry, lanes);
+    }
+    T running = carry[0];
+    for(; i < n; ++i) out[i] = running += in[i];
+}
+
+// Walks backwards so that out may be equal to in, each block still reads its unmodified left neighbour
+template<typename T, std::size_t Bytes>
+__attribute__((always_inline)) inline void simd_adjacent_difference_kernel(const T* in, std::size_t n, T* out){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    if(n == 0) return;
+
+    std::size_t i = n;
+    for(; i >= W + 1; i -= W){
+        V current, previous;
+        __builtin_memcpy(&current, in + i - W, sizeof(V));
+        __builtin_memcpy(&previous, in + i - W - 1, sizeof(V));
+        current -= previous;
+        __builtin_memcpy(out + i - W, &current, sizeof(V));
+    }
+    for(; i > 1; --i) out[i - 1] = in[i - 1] - in[i - 2];
+    out[0] = in[0];
+}
+
+#define STL_AVX2_TARGET   __attribute__((target("avx2")))
+#define STL_AVX512_TARGET __attribute__((target("avx512f,avx512dq,avx512vl,avx512bw")))
+
+template<typename T> STL_AVX2_TARGET T simd_accumulate_avx2(const T* p, std::size_t n, T init){ return simd_accumulate_kernel<T, 32>(p, n, init); }
+template<typename T> STL_AVX512_TARGET T simd_accumulate_avx512(const T* p, std::size_t n, T init){ return simd_accumulate_kernel<T, 64>(p, n, init); }
+template<typename T> STL_AVX2_TARGET T simd_inner_product_avx2(const T* a, const T* b, std::size_t n, T init){ return simd_inner_product_kernel<T, 32>(a, b, n, init); }
+template<typename T> STL_AVX512_TARGET T simd_inner_product_avx512(const T* a, const T* b, std::size_t n, T init){ return simd_inner_product_kernel<T, 64>(a, b, n, init); }
+template<typename T> STL_AVX2_TARGET void simd_partial_sum_avx2(const T* in, std::size_t n, T* out){ simd_partial_sum_kernel<T, 32>(in, n, out); }
+template<typename T> STL_AVX512_TARGET void simd_partial_sum_avx512(const T* in, std::size_t n, T* out){ simd_partial_sum_kernel<T, 64>(in, n, out); }
+template<typename T> STL_AVX2_TARGET void simd_adjacent_difference_avx2(const T* in, std::size_t n, T* out){ simd_adjacent_difference_kernel<T, 32>(in, n, out); }
+template<typename T> STL_AVX512_TARGET void simd_adjacent_difference_avx512(const T* in, std::size_t n, T* out){ simd_adjacent_difference_kernel<T, 64>(in, n, out); }
+#else
+#define STL_HAS_SIMD 0
+#endif
+
+template<typename InputIt, typename T>
+T simd_accumulate(InputIt first, InputIt last, T init){
+    using V = typename std::iterator_traits<InputIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (std::is_same_v<V, T> && is_simd_numeric_v<T> && is_contiguous_iterator_v<InputIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return init;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: return simd_accumulate_avx512(&*first, n, init);
+            case simd_isa::avx2:   return simd_accumulate_avx2(&*first, n, init);
+            case simd_isa::scalar: break;
+        }
+    }
+#endif
+    return std::accumulate(first, last, init);
+}
+
+template<typename InputIt1, typename InputIt2, typename T>
+T simd_inner_product(InputIt1 first1, InputIt1 last1, InputIt2 first2, T init){
+    using V = typename std::iterator_traits<InputIt1>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (std::is_same_v<V, T> && std::is_same_v<V, typename std::iterator_traits<InputIt2>::value_type> &&
+                  is_simd_numeric_v<T> && is_contiguous_iterator_v<InputIt1> && is_contiguous_iterator_v<InputIt2>){
+        const std::size_t n = last1 - first1;
+        if(n == 0) return init;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: return simd_inner_product_avx512(&*first1, &*first2, n, init);
+            case simd_isa::avx2:   return simd_inner_product_avx2(&*first1, &*first2, n, init);
+            case simd_isa::scalar: break;
+        }
+    }
+#endif
+    return std::inner_product(first1, last1, first2, init);
+}
+
+template<typename InputIt, typename OutputIt>
+OutputIt simd_partial_sum(InputIt first, InputIt last, OutputIt d_first){
+    using V = typename std::iterator_traits<InputIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (std::is_same_v<V, typename std::iterator_traits<OutputIt>::value_type> && is_simd_numeric_v<V> &&
+                  is_contiguous_iterator_v<InputIt> && is_contiguous_iterator_v<OutputIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return d_first;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: simd_partial_sum_avx512(&*first, n, &*d_first); return d_first + n;
+            case simd_isa::avx2:   simd_partial_sum_avx2(&*first, n, &*d_first);   return d_first + n;
+            case simd_isa::scalar: break;
+        }
+    }
+#endif
+    return std::partial_sum(first, last, d_first);
+}
+
+template<typename InputIt, typename OutputIt>
+OutputIt simd_adjacent_difference(InputIt first, InputIt last, OutputIt d_first){
+    using V = typename std::iterator_traits<InputIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (std::is_same_v<V, typename std::iterator_traits<OutputIt>::value_type> && is_simd_numeric_v<V> &&
+                  is_contiguous_iterator_v<InputIt> && is_contiguous_iterator_v<OutputIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return d_first;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: simd_adjacent_difference_avx512(&*first, n, &*d_first); return d_first + n;
+            case simd_isa::avx2:   simd_adjacent_difference_avx2(&*first, n, &*d_first);   return d_first + n;
+            case simd_isa::scalar: break;
+        }
+    }
+#endif
+    return std::adjacent_difference(first, last, d_first);
+}
+
+// Parallel sort - par_sort, par_stable_sort, par_radix_sort
+// Arithmetic values sorted by operator< go through a radix sort: one parallel MSD pass on the highest byte that differs
+// between keys, then every bucket finishes with a serial LSD radix sort on one thread. Other types (or custom
+// comparators) use a parallel samplesort that scatters elements to buckets in input order, which makes it stable when
+// the buckets are finished with std::stable_sort. Both fall back to std::sort / std::stable_sort on small inputs.
+
+template<typename K>
+constexpr bool is_radix_key_v = std::is_arithmetic_v<K> && !std::is_same_v<K, long double> && sizeof(K) <= 8;
+
+// Maps an arithmetic key to an unsigned integer with the same ordering. -0.0 maps like +0.0, since the two compare
+// equal and a stable sort must keep them in input order.
+template<typename K>
+auto radix_key_bits(K key){
+    static_assert(is_radix_key_v<K>, "radix keys must be integers or float / double");
+    using U = std::conditional_t<sizeof(K) <= 4, std::uint32_t, std::uint64_t>;
+    constexpr U sign_bit = U(1) << (sizeof(U) * 8 - 1);
+    if constexpr (std::is_floating_point_v<K>){
+        using F = std::conditional_t<sizeof(K) <= 4, float, double>;
+        F value = key == K(0) ? F(0) : F(key);
+        U bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & sign_bit) ? U(~bits) : U(bits | sign_bit);
+    }
+    else if constexpr (std::is_signed_v<K>) return U(static_cast<std::make_signed_t<U>>(key)) ^ sign_bit;
+    else                                    return U(key);
+}
+
+// Serial LSD radix sort of data on key bits [0, top_bit), one byte per pass. Passes where every key has the same
+// digit are skipped. buffer must hold n items; the result always ends up in data.
+template<typename Item, typename Bits>
+void radix_sort_lsd(Item* data, Item* buffer, std::size_t n, Bits bits, unsigned top_bit){
+    Item* from = data;
+    Item* to = buffer;
+    for(unsigned shift = 0; shift < top_bit; shift += 8){
+        std::size_t count[256] = {};
+        for(std::size_t i = 0; i < n; ++i) ++count[(bits(from[i]) >> shift) & 0xff];
+        if(std::any_of(std::begin(count), std::end(count), [&](std::size_t c){ return c == n; })) continue;
+
+        std::size_t offset = 0;
+        for(auto& c : count) offset += std::exchange(c, offset);
+        for(std::size_t i = 0; i < n; ++i) to[count[(bits(from[i]) >> shift) & 0xff]++] = from[i];
+        std::swap(from, to);
+    }
+    if(from != data) std::copy(from, from + n, data);
+}
+
+// Parallel radix sort of n trivially copyable items by bits(item)
+template<typename Item, typename Bits>
+void radix_sort_items(Item* data, std::size_t n, Bits bits){
+    if(n < 2) return;
+    using U = decltype(bits(*data));
+
+    // Only the bits that differ between keys need sorting
+    const U first_key = bits(data[0]);
+    const U diff = par_transform_reduce(data, data + n, U(0), std::bit_or<U>(), [&](const Item& x){ return U(bits(x) ^ first_key); });
+    if(diff == 0) return;
+    unsigned top_bit = 0;
+    while(top_bit < sizeof(U) * 8 && (diff >> top_bit) != 0) ++top_bit;
+
+    std::vector<Item> buffer(n);
+    auto& pool = default_thread_pool();
+    if(n < (1 << 16) || pool.size() == 1){
+        radix_sort_lsd(data, buffer.data(), n, bits, top_bit);
+        return;
+    }
+
+    // MSD pass on the top 8 differing bits, every chunk keeps its own histogram so the scatter is stable
+    const unsigned shift = top_bit > 8 ? top_bit - 8 : 0;
+    const std::size_t chunks = std::min(pool.size() * 4, n / 4096);
+    const std::size_t chunk = (n + chunks - 1) / chunks;
+    std::vector<std::array<std::size_t, 256>> counts(chunks);
+    pool.parallel_for(chunks, [&](std::size_t c){
+        counts[c].fill(0);
+        for(std::size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) ++counts[c][(bits(data[i]) >> shift) & 0xff];
+    });
+
+    std::array<std::size_t, 257> bucket_start;
+    std::size_t offset = 0;
+    for(std::size_t d = 0; d < 256; ++d){
+        bucket_start[d] = offset;
+        for(auto& count : counts) offset += std::exchange(count[d], offset);
+    }
+    bucket_start[256] = n;
+
+    pool.parallel_for(chunks, [&](std::size_t c){
+        for(std::size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i)
+            buffer[counts[c][(bits(data[i]) >> shift) & 0xff]++] = data[i];
+    });
+
+    // Buckets are independent now, each is LSD sorted on the remaining low bits and copied back
+    pool.parallel_for(256, [&](std::size_t d){
+        const std::size_t begin = bucket_start[d], size = bucket_start[d + 1] - begin;
+        if(size == 0) return;
+        radix_sort_lsd(buffer.data() + begin, data + begin, size, bits, shift);
+        std::copy(buffer.data() + begin, buffer.data() + begin + size, data + begin);
+    });
+}
+
+// par_radix_sort - stable sort of any range by an arithmetic key, e.g. strings by length.
+// Sorts (key, index) pairs and then moves every element to its place once.
+template<typename RandomIt, typename KeyFn>
+void par_radix_sort(RandomIt first, RandomIt last, KeyFn key){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    using U = decltype(radix_key_bits(key(*first)));
+    struct item { U bits; std::size_t index; };
+
+    const std::size_t n = last - first;
+    if(n < 2) return;
+
+    std::vector<item> items(n);
+    parallel_chunks<item>(n, [&](std::size_t, std::size_t begin, std::size_t end){
+        for(std::size_t i = begin; i < end; ++i) items[i] = {radix_key_bits(key(first[i])), i};
+    });
+    radix_sort_items(items.data(), n, [](const item& x){ return x.bits; });
+
+    std::vector<T> sorted(n);
+    parallel_chunks<T>(n, [&](std::size_t, std::size_t begin, std::size_t end){
+        for(std::size_t i = begin; i < end; ++i) sorted[i] = std::move(first[items[i].index]);
+    });
+    parallel_chunks<T>(n, [&](std::size_t, std::size_t begin, std::size_t end){
+        std::move(sorted.begin() + begin, sorted.begin() + end, first + begin);
+    });
+}
+
+// Samplesort: splitters from a fixed-seed sample, elements classified and moved to their bucket in parallel,
+// buckets sorted in parallel. Equal elements always land in the same bucket in input order.
+template<bool Stable, typename RandomIt, typename Compare>
+void par_sample_sort(RandomIt first, RandomIt last, Compare comp){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    auto serial = [&](auto begin, auto end){
+        if constexpr (Stable) std::stable_sort(begin, end, comp);
+        else                  std::sort(begin, end, comp);
+    };
+
+    const std::size_t n = last - first;
+    auto& pool = default_thread_pool();
+    if constexpr (!std::is_default_constructible_v<T>){
+        serial(first, last);
+        return;
+    }
+    else {
+        if(n < (1 << 15) || pool.size() == 1){
+            serial(first, last);
+            return;
+        }
+
+        const std::size_t buckets = std::min<std::size_t>(256, pool.size() * 4);
+        const std::size_t oversample = 32;
+        std::vector<T> sample;
+        sample.reserve(buckets * oversample);
+        std::mt19937_64 rng(n);
+        for(std::size_t i = 0; i < buckets * oversample; ++i) sample.push_back(first[rng() % n]);
+        std::sort(sample.begin(), sample.end(), comp);
+        std::vector<T> splitters;
+        for(std::size_t b = 1; b < buckets; ++b) splitters.push_back(sample[b * oversample]);
+
+        const std::size_t chunks = std::min(pool.size() * 4, n / 1024);
+        const std::size_t chunk = (n + chunks - 1) / chunks;
+        std::vector<std::uint8_t> bucket_of(n);
+        std::vector<std::size_t> counts(chunks * buckets);
+        pool.parallel_for(chunks, [&](std::size_t c){
+            for(std::size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i){
+                bucket_of[i] = std::upper_bound(splitters.begin(), splitters.end(), first[i], comp) - splitters.begin();
+                ++counts[c * buckets + bucket_of[i]];
+            }
+        });
+
+        std::vector<std::size_t> bucket_start(buckets + 1);
+        std::size_t offset = 0;
+        for(std::size_t b = 0; b < buckets; ++b){
+            bucket_start[b] = offset;
+            for(std::size_t c = 0; c < chunks; ++c) offset += std::exchange(counts[c * buckets + b], offset);
+        }
+        bucket_start[buckets] = n;
+
+        std::vector<T> buffer(n);
+        pool.parallel_for(chunks, [&](std::size_t c){
+            for(std::size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i)
+                buffer[counts[c * buckets + bucket_of[i]]++] = std::move(first[i]);
+        });
+
+        pool.parallel_for(buckets, [&](std::size_t b){
+            auto begin = buffer.begin() + bucket_start[b], end = buffer.begin() + bucket_start[b + 1];
+            serial(begin, end);
+            std::move(begin, end, first + bucket_start[b]);
+        });
+    }
+}
+
+// Sorts arithmetic values in place with radix_sort_items, copying through a vector for non-contiguous iterators
+template<typename RandomIt>
+void par_radix_sort_values(RandomIt first, RandomIt last){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    auto bits = [](const T& x){ return radix_key_bits(x); };
+    if constexpr (is_contiguous_iterator_v<RandomIt>){
+        radix_sort_items(&*first, last - first, bits);
+    }
+    else {
+        std::vector<T> values(first, last);
+        radix_sort_items(values.data(), values.size(), bits);
+        std::copy(values.begin(), values.end(), first);
+    }
+}
+
+template<typename Compare, typename T>
+constexpr bool is_default_less_v = std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<T>>;
+
+// par_sort - parallel std::sort
+template<typename RandomIt, typename Compare = std::less<>>
+void par_sort(RandomIt first, RandomIt last, Compare comp = Compare()){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if constexpr (is_radix_key_v<T> && is_default_less_v<Compare, T>) par_radix_sort_values(first, last);
+    else                                                               par_sample_sort<false>(first, last, comp);
+}
+
+// par_stable_sort - parallel std::stable_sort, equal elements keep their order
+template<typename RandomIt, typename Compare = std::less<>>
+void par_stable_sort(RandomIt first, RandomIt last, Compare comp = Compare()){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if constexpr (is_radix_key_v<T> && is_default_less_v<Compare, T>) par_radix_sort_values(first, last);
+    else                                                               par_sample_sort<true>(first, last, comp);
+}
+
+// d-ary heap - dary_make_heap, dary_push_heap, dary_pop_heap, dary_sort_heap, dary_is_heap, dary_is_heap_until
+// Same contracts as the std:: heap algorithms (max-heap with respect to comp, top at *first) for a heap where every
+// node has Arity children: children of i are Arity * i + 1 .. Arity * i + Arity. Arity 2 gives exactly the std:: layout.
+// A wider node makes the heap log2(Arity) times shallower, and all children of a node sit next to each other, so
+// a sift-down step touches one cache line instead of one per level.
+
+template<std::size_t Arity, typename RandomIt, typename Compare>
+void dary_sift_up(RandomIt first, std::size_t hole, Compare& comp){
+    auto value = std::move(first[hole]);
+    while(hole > 0){
+        std::size_t parent = (hole - 1) / Arity;
+        if(!comp(first[parent], value)) break;
+        first[hole] = std::move(first[parent]);
+        hole = parent;
+    }
+    first[hole] = std::move(value);
+}
+
+// Index of the largest of Count siblings. Compares as a tournament (pairs, then pairs of winners) so the selects
+// form a log2(Count) deep dependency chain instead of Count - 1.
+template<std::size_t Count, typename T, typename Compare>
+std::size_t dary_best_child(const T* children, Compare& comp){
+    if constexpr (Count == 1) return 0;
+    else {
+        constexpr std::size_t half = Count / 2;
+        std::size_t left = dary_best_child<half>(children, comp);
+        std::size_t right = half + dary_best_child<Count - half>(children + half, comp);
+        return comp(children[left], children[right]) ? right : left;
+    }
+}
+
+// Fills the hole at 'hole' in a heap of n elements with value. Like libstdc++'s __adjust_heap the hole first walks
+// down to a leaf along the largest children without comparing against value, then value sifts up from there: a popped
+// value almost always belongs near the bottom, so this saves the compare (and its mispredicted branch) on every level.
+template<std::size_t Arity, typename RandomIt, typename Compare, typename T>
+void dary_sift_down(RandomIt first, std::size_t n, std::size_t hole, T value, Compare& comp){
+    const std::size_t top = hole;
+    for(;;){
+        std::size_t child = Arity * hole + 1;
+        if(child >= n) break;
+        // The next level's sibling group is one cache line, fetch it while comparing this one
+        if(Arity * child + 1 < n) __builtin_prefetch(&first[Arity * child + 1]);
+
+        std::size_t best;
+        if(child + Arity <= n) best = child + dary_best_child<Arity>(&first[child], comp);
+        else {
+            best = child;
+            for(std::size_t c = child + 1; c < n; ++c) best = comp(first[best], first[c]) ? c : best;
+        }
+        first[hole] = std::move(first[best]);
+        hole = best;
+    }
+    while(hole > top){
+        std::size_t parent = (hole - 1) / Arity;
+        if(!comp(first[parent], value)) break;
+        first[hole] = std::move(first[parent]);
+        hole = parent;
+    }
+    first[hole] = std::move(value);
+}
+
+template<std::size_t Arity, typename RandomIt, typename Compare = std::less<>>
+void dary_push_heap(RandomIt first, RandomIt last, Compare comp = Compare()){
+    if(last - first > 1) dary_sift_up<Arity>(first, last - first - 1, comp);
+}
+
+template<std::size_t Arity, typename RandomIt, typename Compare = std::less<>>
+void dary_pop_heap(RandomIt first, RandomIt last, Compare comp = Compare()){
+    std::size_t n = last - first;
+    if(n < 2) return;
+    auto value = std::move(first[n - 1]);
+    first[n - 1] = std::move(first[0]);
+    dary_sift_down<Arity>(first, n - 1, 0, std::move(value), comp);
+}
+
+// Floyd's bottom-up construction, O(n)
+template<std::size_t Arity, typename RandomIt, typename Compare = std::less<>>
+void dary_make_heap(RandomIt first, RandomIt last, Compare comp = Compare()){
+    std::size_t n = last - first;
+    if(n < 2) return;
+    for(std::size_t i = (n - 2) / Arity + 1; i-- > 0;)
+        dary_sift_down<Arity>(first, n, i, std::move(first[i]), comp);
+}
+
+template<std::size_t Arity, typename RandomIt, typename Compare = std::less<>>
+void dary_sort_heap(RandomIt first, RandomIt last, Compare comp = Compare()){
+    for(; last - first > 1; --last) dary_pop_heap<Arity>(first, last, comp);
+}
+
+// First element that is larger than its parent, like std::is_heap_until
+template<std::size_t Arity, typename RandomIt, typename Compare = std::less<>>
+RandomIt dary_is_heap_until(RandomIt first, RandomIt last, Compare comp = Compare()){
+    std::size_t n = last - first;
+    for(std::size_t i = 1; i < n; ++i)
+        if(comp(first[(i - 1) / Arity], first[i])) return first + i;
+    return last;
+}
+
+template<std::size_t Arity, typename RandomIt, typename Compare = std::less<>>
+bool dary_is_heap(RandomIt first, RandomIt last, Compare comp = Compare()){
+    return dary_is_heap_until<Arity>(first, last, comp) == last;
+}
+
+// Allocator returning storage aligned to a cache line
+template<typename T, std::size_t Alignment = 64>
+struct cache_aligned_allocator {
+    using value_type = T;
+    template<typename U> struct rebind { using other = cache_aligned_allocator<U, Alignment>; };
+    static constexpr std::align_val_t alignment{std::max(Alignment, alignof(T))};
+
+    cache_aligned_allocator() = default;
+    template<typename U> cache_aligned_allocator(const cache_aligned_allocator<U, Alignment>&){}
+
+    T* allocate(std::size_t n){ return static_cast<T*>(::operator new(n * sizeof(T), alignment)); }
+    void deallocate(T* p, std::size_t){ ::operator delete(p, alignment); }
+
+    template<typename U> bool operator==(const cache_aligned_allocator<U, Alignment>&) const { return true; }
+    template<typename U> bool operator!=(const cache_aligned_allocator<U, Alignment>&) const { return false; }
+};
+
+// dary_heap - priority queue on the d-ary heap algorithms above (top() is the largest element for std::less)
+// Storage is cache line aligned and starts with Arity - 1 unused slots, which puts every sibling group at a multiple
+// of Arity elements, so with Arity * sizeof(T) == 64 (8-ary int64, 16-ary int32) each group is exactly one line.
+template<typename T, std::size_t Arity = 4, typename Compare = std::less<T>>
+class dary_heap {
+    static_assert(Arity >= 2, "a heap node needs at least two children");
+    static constexpr std::size_t padding = std::is_default_constructible_v<T> ? Arity - 1 : 0;
+
+public:
+    explicit dary_heap(Compare comp = Compare()) : comp(comp), storage(padding) {}
+
+    bool empty() const { return size() == 0; }
+    std::size_t size() const { return storage.size() - padding; }
+    void reserve(std::size_t n){ storage.reserve(n + padding); }
+
+    const T& top() const { return storage[padding]; }
+
+    void push(T value){
+        storage.push_back(std::move(value));
+        dary_push_heap<Arity>(begin(), end(), comp);
+    }
+
+    void pop(){
+        dary_pop_heap<Arity>(begin(), end(), comp);
+        storage.pop_back();
+    }
+
+    // Appends all of [first, last). A large batch is cheaper to heapify from scratch than to sift up one by one.
+    template<typename InputIt>
+    void push_many(InputIt first, InputIt last){
+        const std::size_t old_size = size();
+        storage.insert(storage.end(), first, last);
+        const std::size_t added = size() - old_size;
+        if(added * heap_depth(size()) > size()) dary_make_heap<Arity>(begin(), end(), comp);
+        else for(std::size_t i = old_size; i < size(); ++i) dary_push_heap<Arity>(begin(), begin() + i + 1, comp);
+    }
+
+    // Writes the 'count' largest elements to out, largest first, and removes them. A large batch is selected with
+    // nth_element and sorted, then the rest is heapified again.
+    template<typename OutputIt>
+    OutputIt pop_many(std::size_t count, OutputIt out){
+        count = std::min(count, size());
+        if(count * heap_depth(size()) <= size()){
+            for(std::size_t i = 0; i < count; ++i){
+                *out++ = std::move(storage[padding]);
+                pop();
+            }
+            return out;
+        }
+        auto greater = [this](const T& a, const T& b){ return comp(b, a); };
+        std::nth_element(begin(), begin() + count, end(), greater);
+        std::sort(begin(), begin() + count, greater);
+        out = std::move(begin(), begin() + count, out);
+        storage.erase(begin(), begin() + count);
+        dary_make_heap<Arity>(begin(), end(), comp);
+        return out;
+    }
+
+    // Elements in heap order, e.g. for dary_is_heap<Arity>(heap.begin(), heap.end())
+    auto begin() { return storage.begin() + padding; }
+    auto end() { return storage.end(); }
+    auto begin() const { return storage.begin() + padding; }
+    auto end() const { return storage.end(); }
+
+private:
+    static std::size_t heap_depth(std::size_t n){
+        std::size_t depth = 1;
+        for(std::size_t level = Arity; level < n; level *= Arity) ++depth;
+        return depth;
+    }
+
+    Compare comp;
+    std::vector<T, cache_aligned_allocator<T>> storage;
+};
+
+// Search indexes - eytzinger_index, btree_index
+// Immutable copies of a sorted range laid out for searching. lower_bound / upper_bound / equal_range / contains answer
+// with ranks (positions in the sorted input, like std::lower_bound(...) - begin) instead of iterators.
+//  - eytzinger_index stores the keys in BFS order of the implicit binary search tree (children of k are 2k and 2k + 1).
+//    The search is branchless and the 4th level below the current node is one cache line, prefetched ahead.
+//  - btree_index (arithmetic keys) stores one cache line of sorted keys per node and 64 / sizeof(T) + 1 children,
+//    so a search touches log_17(n) lines for int32 and compares a whole node with vector instructions.
+// lower_bound_batch answers many queries in one interleaved pass: all queries of a group descend one level together,
+// so the cache misses of different queries overlap instead of queueing behind each other.
+
+template<typename T, typename Compare = std::less<T>>
+class eytzinger_index {
+public:
+    // [first, last) must be sorted with respect to comp
+    template<typename InputIt>
+    eytzinger_index(InputIt first, InputIt last, Compare comp = Compare()) : comp(comp){
+        std::vector<T> sorted(first, last);
+        n = sorted.size();
+        keys.resize(n + 1);
+        ranks.resize(n + 1);
+        ranks[0] = n;
+        std::size_t next = 0;
+        build(sorted, next, 1);
+    }
+
+    std::size_t size() const { return n; }
+
+    std::size_t lower_bound(const T& x) const { return ranks[descend([&](const T& key){ return comp(key, x); })]; }
+    std::size_t upper_bound(const T& x) const { return ranks[descend([&](const T& key){ return !comp(x, key); })]; }
+    std::pair<std::size_t, std::size_t> equal_range(const T& x) const { return {lower_bound(x), upper_bound(x)}; }
+
+    bool contains(const T& x) const {
+        std::size_t k = descend([&](const T& key){ return comp(key, x); });
+        return k != 0 && !comp(x, keys[k]);
+    }
+
+    // Writes lower_bound(q) for every query q in [first, last) to out
+    template<typename InputIt, typename OutputIt>
+    OutputIt lower_bound_batch(InputIt first, InputIt last, OutputIt out) const {
+        constexpr std::size_t group = 16;
+        std::size_t depth = 0;
+        while((std::size_t(1) << depth) <= n) ++depth;
+
+        std::array<T, group> query;
+        std::array<std::size_t, group> k;
+        while(first != last){
+            std::size_t count = 0;
+            for(; count < group && first != last; ++count, ++first) query[count] = *first;
+            k.fill(1);
+            for(std::size_t level = 0; level < depth; ++level){
+                for(std::size_t q = 0; q < count; ++q){
+                    if(k[q] > n) continue;
+                    k[q] = 2 * k[q] + comp(keys[k[q]], query[q]);
+                    prefetch(k[q] * line);
+                }
+            }
+            for(std::size_t q = 0; q < count; ++q) *out++ = ranks[k[q] >> __builtin_ffsll(~k[q])];
+        }
+        return out;
+    }
+
+private:
+    static constexpr std::size_t line = std::max<std::size_t>(2, 64 / sizeof(T));
+
+    // In-order walk of the implicit tree hands out the sorted keys
+    void build(const std::vector<T>& sorted, std::size_t& next, std::size_t k){
+        if(k > n) return;
+        build(sorted, next, 2 * k);
+        keys[k] = sorted[next];
+        ranks[k] = next++;
+        build(sorted, next, 2 * k + 1);
+    }
+
+    // Goes right while go_right(key), then undoes the trailing right turns (and one left turn) to land on the
+    // last node where the search went left, i.e. the answer. Slot 0 means "past the end".
+    template<typename GoRight>
+    std::size_t descend(GoRight go_right) const {
+        std::size_t k = 1;
+        while(k <= n){
+            prefetch(k * line);
+            k = 2 * k + go_right(keys[k]);
+        }
+        return k >> __builtin_ffsll(~k);
+    }
+
+    void prefetch(std::size_t k) const {
+        if(k < keys.size()) __builtin_prefetch(keys.data() + k);
+    }
+
+    Compare comp;
+    std::size_t n = 0;
+    std::vector<T, cache_aligned_allocator<T>> keys;
+    std::vector<std::size_t> ranks;
+};
+
+template<typename T>
+class btree_index {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 8, "btree_index needs integer or floating point keys");
+    static constexpr std::size_t B = 64 / sizeof(T);              // keys per node, one cache line
+    static constexpr std::size_t W = 16 / sizeof(T);              // lanes per 16 byte vector
+    typedef T vec __attribute__((vector_size(16)));
+
+public:
+    // [first, last) must be sorted ascending. NaN keys are not supported, as a range holding one is not sorted by <.
+    // A NaN query gives the same ranks as std::lower_bound / std::upper_bound (0 and n) and is never contained.
+    template<typename InputIt>
+    btree_index(InputIt first, InputIt last){
+        std::vector<T> sorted(first, last);
+        n = sorted.size();
+        nodes = (n + B - 1) / B;
+        // Unused slots hold the largest value (+inf for floating point), which no real key is greater than. They come
+        // after every real key in order, so a search only ends on one when no real key qualifies, and their rank is n.
+        keys.assign(nodes * B, std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                                    : std::numeric_limits<T>::max());
+        ranks.assign(nodes * B, n);
+        std::size_t next = 0;
+        build(sorted, next, 0);
+    }
+
+    std::size_t size() const { return n; }
+
+    std::size_t lower_bound(T x) const { return rank_of(search<false>(x)); }
+    std::size_t upper_bound(T x) const { return rank_of(search<true>(x)); }
+    std::pair<std::size_t, std::size_t> equal_range(T x) const { return {lower_bound(x), upper_bound(x)}; }
+
+    bool contains(T x) const {
+        std::size_t slot = search<false>(x);
+        return rank_of(slot) < n && keys[slot] == x;
+    }
+
+    template<typename InputIt, typename OutputIt>
+    OutputIt lower_bound_batch(InputIt first, InputIt last, OutputIt out) const {
+        constexpr std::size_t group = 16;
+        std::array<T, group> query;
+        std::array<std::size_t, group> k, result;
+        while(first != last){
+            std::size_t count = 0;
+            for(; count < group && first != last; ++count, ++first) query[count] = *first;
+            k.fill(0);
+            result.fill(n);
+            for(bool active = true; active;){
+                active = false;
+                for(std::size_t q = 0; q < count; ++q){
+                    if(k[q] >= nodes) continue;
+                    std::size_t i = count_before<false>(keys.data() + k[q] * B, query[q]);
+                    if(i < B) result[q] = ranks[k[q] * B + i];
+                    k[q] = child(k[q], i);
+                    if(k[q] < nodes){
+                        __builtin_prefetch(keys.data() + k[q] * B);
+                        active = true;
+                    }
+                }
+            }
+            out = std::copy(result.begin(), result.begin() + count, out);
+        }
+        return out;
+    }
+
+private:
+    static std::size_t child(std::size_t k, std::size_t i){ return k * (B + 1) + i + 1; }
+
+    void build(const std::vector<T>& sorted, std::size_t& next, std::size_t k){
+        if(k >= nodes) return;
+        for(std::size_t i = 0; i < B; ++i){
+            build(sorted, next, child(k, i));
+            if(next < n){
+                keys[k * B + i] = sorted[next];
+                ranks[k * B + i] = next++;
+            }
+        }
+        build(sorted, next, child(k, B));
+    }
+
+    // Number of keys in the node that are < x (or not > x for UpperBound), 16 bytes of keys per compare
+    template<bool UpperBound>
+    static std::size_t count_before(const T* node, T x){
+        vec needle;
+        for(std::size_t l = 0; l < W; ++l) needle[l] = x;
+        decltype(needle < needle) hits = {};
+        for(std::size_t i = 0; i < B; i += W){
+            vec v;
+            __builtin_memcpy(&v, node + i, sizeof(v));
+            if constexpr (UpperBound) hits += ~(needle < v);
+            else                      hits += (v < needle);
+        }
+        // Each hit lane is -1
+        std::int64_t count = 0;
+        for(std::size_t l = 0; l < W; ++l) count -= hits[l];
+        return count;
+    }
+
+    static constexpr std::size_t no_slot = std::numeric_limits<std::size_t>::max();
+
+    std::size_t rank_of(std::size_t slot) const { return slot == no_slot ? n : std::min(ranks[slot], n); }
+
+    // Slot of the first key >= x (> x for UpperBound), no_slot if there is none
+    template<bool UpperBound>
+    std::size_t search(T x) const {
+        std::size_t result = no_slot, k = 0;
+        while(k < nodes){
+            std::size_t i = count_before<UpperBound>(keys.data() + k * B, x);
+            if(i < B) result = k * B + i;
+            k = child(k, i);
+            if(k < nodes) __builtin_prefetch(keys.data() + k * B);
+        }
+        return result;
+    }
+
+    std::size_t n = 0, nodes = 0;
+    std::vector<T, cache_aligned_allocator<T>> keys;
+    std::vector<std::size_t> ranks;
+};
+
+// Flat sets - flat_set and the flat_set_ algorithms
+// flat_set keeps its elements in one sorted, duplicate-free vector: no node per element and iteration is a linear scan.
+// flat_set_intersection / _union / _difference / _symmetric_difference and flat_includes work on any sorted,
+// duplicate-free random access ranges (a flat_set, a sorted unique vector). Compared to the std:: versions:
+//  - when one input is 32x larger than the other, the small one drives the merge and the large one is galloped
+//    (exponential then binary search), so cost grows with the small side
+//  - int32 / int64 intersection and difference compare a whole vector block of each input at once (AVX2 / AVX-512)
+//  - the _count variants return the size of the result without writing it
+
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
+
+template<typename T, typename Compare = std::less<T>>
+class flat_set {
+public:
+    using value_type = T;
+    using iterator = typename std::vector<T>::const_iterator;
+    using const_iterator = iterator;
+
+    explicit flat_set(Compare comp = Compare()) : comp(comp) {}
+
+    template<typename InputIt>
+    flat_set(InputIt first, InputIt last, Compare comp = Compare()) : comp(comp), values(first, last){
+        std::sort(values.begin(), values.end(), comp);
+        values.erase(std::unique(values.begin(), values.end(), [&](const T& a, const T& b){ return !comp(a, b); }), values.end());
+    }
+
+    flat_set(std::initializer_list<T> init, Compare comp = Compare()) : flat_set(init.begin(), init.end(), comp) {}
+
+    // Adopts a vector that is already sorted and duplicate-free, e.g. the output of a flat_set_ algorithm
+    flat_set(sorted_unique_t, std::vector<T> sorted, Compare comp = Compare()) : comp(comp), values(std::move(sorted)) {}
+
+    iterator begin() const { return values.begin(); }
+    iterator end() const { return values.end(); }
+    std::size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+    void clear() { values.clear(); }
+    void reserve(std::size_t n) { values.reserve(n); }
+    const std::vector<T>& data() const { return values; }
+
+    iterator lower_bound(const T& x) const { return std::lower_bound(values.begin(), values.end(), x, comp); }
+    iterator upper_bound(const T& x) const { return std::upper_bound(values.begin(), values.end(), x, comp); }
+    bool contains(const T& x) const { return find(x) != end(); }
+    iterator find(const T& x) const {
+        auto it = lower_bound(x);
+        return it != end() && !comp(x, *it) ? it : end();
+    }
+
+    std::pair<iterator, bool> insert(T value){
+        auto it = lower_bound(value);
+        if(it != end() && !comp(value, *it)) return {it, false};
+        return {values.insert(it, std::move(value)), true};
+    }
+
+    // Bulk insert: the new elements are sorted on their own and merged in once
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last){
+        const std::size_t old_size = values.size();
+        values.insert(values.end(), first, last);
+        std::sort(values.begin() + old_size, values.end(), comp);
+        std::inplace_merge(values.begin(), values.begin() + old_size, values.end(), comp);
+        values.erase(std::unique(values.begin(), values.end(), [&](const T& a, const T& b){ return !comp(a, b); }), values.end());
+    }
+
+    std::size_t erase(const T& x){
+        auto it = find(x);
+        if(it == end()) return 0;
+        values.erase(it);
+        return 1;
+    }
+
+private:
+    Compare comp;
+    std::vector<T> values;
+};
+
+// Output iterator that only counts what is written to it
+class counting_output_iterator {
+public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    std::size_t count = 0;
+
+    counting_output_iterator& operator*(){ return *this; }
+    counting_output_iterator& operator++(){ return *this; }
+    counting_output_iterator& operator++(int){ return *this; }
+    template<typename T> counting_output_iterator& operator=(const T&){ ++count; return *this; }
+};
+
+// First position in [first, last) not less than x, probing 1, 2, 4, ... elements ahead before the binary search
+template<typename RandomIt, typename T, typename Compare>
+RandomIt gallop_lower_bound(RandomIt first, RandomIt last, const T& x, Compare& comp){
+    std::size_t step = 1, size = last - first;
+    std::size_t low = 0;
+    while(step <= size && comp(first[step - 1], x)){
+        low = step;
+        step *= 2;
+    }
+    return std::lower_bound(first + low, first + std::min(step, size), x, comp);
+}
+
+// Shared merge of two sorted, duplicate-free ranges. Emits the elements only in a, only in b and/or in both
+// (taken from a), in sorted order. Skewed sizes gallop through the larger range.
+template<bool OnlyA, bool OnlyB, bool Common, typename It1, typename It2, typename OutputIt, typename Compare>
+OutputIt flat_set_merge(It1 a, It1 a_last, It2 b, It2 b_last, OutputIt out, Compare comp){
+    const std::size_t na = a_last - a, nb = b_last - b;
+    if(na >= 32 * nb || nb >= 32 * na){
+        // Gallop the large side for every element of the small side
+        auto run = [&](auto small, auto small_last, auto large, auto large_last, bool small_is_a){
+            const bool emit_small = small_is_a ? OnlyA : OnlyB, emit_large = small_is_a ? OnlyB : OnlyA;
+            for(; small != small_last; ++small){
+                auto next = gallop_lower_bound(large, large_last, *small, comp);
+                if(emit_large) out = std::copy(large, next, out);
+                large = next;
+                if(large != large_last && !comp(*small, *large)){
+                    if(Common) *out++ = small_is_a ? *small : *large;
+                    ++large;
+                }
+                else if(emit_small) *out++ = *small;
+            }
+            if(emit_large) out = std::copy(large, large_last, out);
+        };
+        if(na < nb) run(a, a_last, b, b_last, true);
+        else        run(b, b_last, a, a_last, false);
+        return out;
+    }
+
+    while(a != a_last && b != b_last){
+        if(comp(*a, *b)){
+            if(OnlyA) *out++ = *a;
+            ++a;
+        }
+        else if(comp(*b, *a)){
+            if(OnlyB) *out++ = *b;
+            ++b;
+        }
+        else {
+            if(Common) *out++ = *a;
+            ++a;
+            ++b;
+        }
+    }
+    if(OnlyA) out = std::copy(a, a_last, out);
+    if(OnlyB) out = std::copy(b, b_last, out);
+    return out;
+}
+
+#if STL_HAS_SIMD
+// Block intersection / difference of duplicate-free sorted arrays: a block of W elements of a is compared with every
+// element of a block of b (one broadcast compare per b element), and the block with the smaller maximum moves on.
+// Difference accumulates the matches of the current a block until it moves on and then emits the unmatched lanes.
+// Writes to out unless it is null, returns the number of elements in the result.
+template<bool Difference, typename T, std::size_t Bytes>
+__attribute__((always_inline)) inline std::size_t simd_set_kernel(const T* a, std::size_t na, const T* b, std::size_t nb, T* out){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    using M = decltype(V{} == V{});
+
+    std::size_t i = 0, j = 0, written = 0;
+    M found = {};
+    auto emit = [&](const V& values, const M& keep){
+        if(out){
+            T kept[W];
+            std::size_t k = 0;
+            for(std::size_t l = 0; l < W; ++l){
+                kept[k] = values[l];
+                k += keep[l] != 0;
+            }
+            std::memcpy(out + written, kept, k * sizeof(T));
+            written += k;
+        }
+        else for(std::size_t l = 0; l < W; ++l) written += keep[l] != 0;
+    };
+
+    while(i + W <= na && j + W <= nb){
+        V va, vb;
+        __builtin_memcpy(&va, a + i, sizeof(V));
+        __builtin_memcpy(&vb, b + j, sizeof(V));
+        M match = {};
+        for(std::size_t r = 0; r < W; ++r) match |= (va == vb[r]);
+
+        const T a_max = a[i + W - 1], b_max = b[j + W - 1];
+        if constexpr (Difference){
+            found |= match;
+            if(a_max <= b_max){
+                emit(va, found == 0);
+                found = M{};
+            }
+        }
+        else emit(va, match);
+        if(a_max <= b_max) i += W;
+        if(b_max <= a_max) j += W;
+    }
+
+    // Scalar finish. For difference, lanes of an unfinished a block that matched an earlier b block are skipped.
+    std::size_t lane = 0;
+    for(; i < na; ++i, ++lane){
+        while(j < nb && b[j] < a[i]) ++j;
+        const bool in_b = (j < nb && b[j] == a[i]) || (Difference && lane < W && found[lane]);
+        if(in_b != Difference){
+            if(out) out[written] = a[i];
+            ++written;
+        }
+    }
+    return written;
+}
+
+template<bool Difference, typename T> STL_AVX2_TARGET
+std::size_t simd_set_avx2(const T* a, std::size_t na, const T* b, std::size_t nb, T* out){ return simd_set_kernel<Difference, T, 32>(a, na, b, nb, out); }
+template<bool Difference, typename T> STL_AVX512_TARGET
+std::size_t simd_set_avx512(const T* a, std::size_t na, const T* b, std::size_t nb, T* out){ return simd_set_kernel<Difference, T, 64>(a, na, b, nb, out); }
+#endif
+
+// Runs the block kernel when both ranges are contiguous int32 / int64 of similar size, the output is a contiguous
+// iterator of the same type (or a null pointer to count only) and the CPU has AVX2. Returns false when the generic
+// merge has to be used instead. On success out is advanced past the result and result holds its size.
+template<bool Difference, typename It1, typename It2, typename OutputIt, typename Compare>
+bool flat_set_simd(It1 a, It1 a_last, It2 b, It2 b_last, OutputIt& out, Compare, std::size_t& result){
+#if STL_HAS_SIMD
+    using T = typename std::iterator_traits<It1>::value_type;
+    if constexpr ((std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::int64_t>) &&
+                  std::is_same_v<T, typename std::iterator_traits<It2>::value_type> && is_default_less_v<Compare, T> &&
+                  is_contiguous_iterator_v<It1> && is_contiguous_iterator_v<It2>){
+        if constexpr (std::is_same_v<T, typename std::iterator_traits<OutputIt>::value_type>){
+            if constexpr (is_contiguous_iterator_v<OutputIt>){
+                const std::size_t na = a_last - a, nb = b_last - b;
+                if(na == 0 || nb == 0 || na >= 32 * nb || nb >= 32 * na) return false;
+                T* dst;
+                if constexpr (std::is_pointer_v<OutputIt>) dst = out;
+                else                                       dst = &*out;
+                switch(detect_simd_isa()){
+                    case simd_isa::avx512: result = simd_set_avx512<Difference>(&*a, na, &*b, nb, dst); break;
+                    case simd_isa::avx2:   result = simd_set_avx2<Difference>(&*a, na, &*b, nb, dst);   break;
+                    case simd_isa::scalar: return false;
+                }
+                if(dst) out = std::next(out, result);
+                return true;
+            }
+        }
+    }
+#endif
+    return false;
+}
+
+template<typename It1, typename It2, typename OutputIt, typename Compare = std::less<>>
+OutputIt flat_set_intersection(It1 a, It1 a_last, It2 b, It2 b_last, OutputIt out, Compare comp = Compare()){
+    std::size_t written = 0;
+    if(flat_set_simd<false>(a, a_last, b, b_last, out, comp, written)) return out;
+    return flat_set_merge<false, false, true>(a, a_last, b, b_last, out, comp);
+}
+
+template<typename It1, typename It2, typename OutputIt, typename Compare = std::less<>>
+OutputIt flat_set_difference(It1 a, It1 a_last, It2 b, It2 b_last, OutputIt out, Compare comp = Compare()){
+    std::size_t written = 0;
+    if(flat_set_simd<true>(a, a_last, b, b_last, out, comp, written)) return out;
+    return flat_set_merge<true, false, false>(a, a_last, b, b_last, out, comp);
+}
+
+template<typename It1, typename It2, typename OutputIt, typename Compare = std::less<>>
+OutputIt flat_set_union(It1 a, It1 a_last, It2 b, It2 b_last, OutputIt out, Compare comp = Compare()){
+    return flat_set_merge<true, true, true>(a, a_last, b, b_last, out, comp);
+}
+
+template<typename It1, typename It2, typename OutputIt, typename Compare = std::less<>>
+OutputIt flat_set_symmetric_difference(It1 a, It1 a_last, It2 b, It2 b_last, OutputIt out, Compare comp = Compare()){
+    return flat_set_merge<true, true, false>(a, a_last, b, b_last, out, comp);
+}
+
+template<typename It1, typename It2, typename Compare = std::less<>>
+std::size_t flat_set_intersection_count(It1 a, It1 a_last, It2 b, It2 b_last, Compare comp = Compare()){
+    std::size_t count = 0;
+    typename std::iterator_traits<It1>::value_type* no_output = nullptr;
+    if(flat_set_simd<false>(a, a_last, b, b_last, no_output, comp, count)) return count;
+    return flat_set_merge<false, false, true>(a, a_last, b, b_last, counting_output_iterator(), comp).count;
+}
+
+template<typename It1, typename It2, typename Compare = std::less<>>
+std::size_t flat_set_difference_count(It1 a, It1 a_last, It2 b, It2 b_last, Compare comp = Compare()){
+    return (a_last - a) - flat_set_intersection_count(a, a_last, b, b_last, comp);
+}
+
+template<typename It1, typename It2, typename Compare = std::less<>>
+std::size_t flat_set_union_count(It1 a, It1 a_last, It2 b, It2 b_last, Compare comp = Compare()){
+    return (a_last - a) + (b_last - b) - flat_set_intersection_count(a, a_last, b, b_last, comp);
+}
+
+template<typename It1, typename It2, typename Compare = std::less<>>
+std::size_t flat_set_symmetric_difference_count(It1 a, It1 a_last, It2 b, It2 b_last, Compare comp = Compare()){
+    return (a_last - a) + (b_last - b) - 2 * flat_set_intersection_count(a, a_last, b, b_last, comp);
+}
+
+// flat_includes - true if every element of b is in a. Gallops through a when b is small, stops at the first miss.
+template<typename It1, typename It2, typename Compare = std::less<>>
+bool flat_includes(It1 a, It1 a_last, It2 b, It2 b_last, Compare comp = Compare()){
+    const std::size_t na = a_last - a, nb = b_last - b;
+    if(nb > na) return false;
+    if(na < 32 * nb) return flat_set_intersection_count(a, a_last, b, b_last, comp) == nb;
+    for(; b != b_last; ++b){
+        a = gallop_lower_bound(a, a_last, *b, comp);
+        if(a == a_last || comp(*b, *a)) return false;
+        ++a;
+    }
+    return true;
+}
+
+// K-way merge - kway_merge, par_kway_merge and bounded_inplace_merge
+// kway_merge merges any number of sorted runs in one pass with a loser tree: the tree keeps the loser of every match,
+// so taking the next element replays only the log2(k) matches on the path of the run it came from.
+// Equal elements come out in run order (run 0 first), the same result as folding the runs with std::merge.
+
+template<typename RandomIt, typename Compare>
+class loser_tree {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+    static constexpr bool cache_keys = std::is_arithmetic_v<value_type> && sizeof(value_type) <= 8;
+
+public:
+    loser_tree(const std::vector<std::pair<RandomIt, RandomIt>>& sources, Compare comp) : comp(comp){
+        for(auto& run : sources){
+            if(run.first == run.second) continue;
+            heads.push_back(run.first);
+            ends.push_back(run.second);
+        }
+        rebuild();
+    }
+
+    bool empty() const { return heads.empty(); }
+    // Position of the smallest remaining element
+    RandomIt top() const { return heads[tree[0]]; }
+
+    void pop(){
+        std::size_t w = tree[0];
+        if(++heads[w] == ends[w]){
+            // A run ran out: drop it and rebuild, which happens once per run
+            heads.erase(heads.begin() + w);
+            ends.erase(ends.begin() + w);
+            rebuild();
+            return;
+        }
+        if constexpr (cache_keys){
+            // The loser keys live in the tree, so the loads of every level are independent of the winner so far and
+            // the outcome of each (unpredictable) match is selected without branching
+            value_type key = *heads[w];
+            for(std::size_t node = (w + leaves) / 2; node >= 1; node /= 2){
+                const std::size_t challenger = tree[node];
+                const value_type challenger_key = keys[node];
+                const bool wins = (challenger < heads.size()) &
+                                  (comp(challenger_key, key) | ((challenger < w) & !comp(key, challenger_key)));
+                tree[node] = select(wins, w, challenger);
+                keys[node] = select(wins, key, challenger_key);
+                w = select(wins, challenger, w);
+                key = select(wins, challenger_key, key);
+            }
+        }
+        else {
+            for(std::size_t node = (w + leaves) / 2; node >= 1; node /= 2){
+                const std::size_t challenger = tree[node];
+                if(challenger < heads.size() && beats(challenger, w)){
+                    tree[node] = w;
+                    w = challenger;
+                }
+            }
+        }
+        tree[0] = w;
+    }
+
+private:
+    // condition ? a : b through a bit mask, because the compiler turns a plain ?: back into an unpredictable branch
+    template<typename V>
+    static V select(bool condition, V a, V b){
+        using bits = std::conditional_t<sizeof(V) == 8, std::uint64_t, std::conditional_t<sizeof(V) == 4, std::uint32_t,
+                     std::conditional_t<sizeof(V) == 2, std::uint16_t, std::uint8_t>>>;
+        bits x, y;
+        std::memcpy(&x, &a, sizeof(V));
+        std::memcpy(&y, &b, sizeof(V));
+        y ^= (x ^ y) & static_cast<bits>(bits(0) - bits(condition));
+        std::memcpy(&b, &y, sizeof(V));
+        return b;
+    }
+
+    // a comes out before b, ties go to the earlier run
+    bool beats(std::size_t a, std::size_t b){
+        return comp(*heads[a], *heads[b]) || (a < b && !comp(*heads[b], *heads[a]));
+    }
+
+    void rebuild(){
+        leaves = 1;
+        while(leaves < heads.size()) leaves *= 2;
+        tree.assign(leaves, 0);
+        if constexpr (cache_keys) keys.assign(leaves, value_type());
+        if(!heads.empty()) tree[0] = build(1);
+    }
+
+    // Leaves past the last run are padding and lose every match
+    std::size_t build(std::size_t node){
+        if(node >= leaves) return node - leaves;
+        std::size_t left = build(2 * node), right = build(2 * node + 1);
+        const bool left_wins = right >= heads.size() || beats(left, right);
+        tree[node] = left_wins ? right : left;
+        if constexpr (cache_keys) if(tree[node] < heads.size()) keys[node] = *heads[tree[node]];
+        return left_wins ? left : right;
+    }
+
+    Compare comp;
+    std::vector<RandomIt> heads, ends;  // current position and end of every non-empty run, in run order
+    std::size_t leaves = 1;
+    std::vector<std::size_t> tree;      // tree[0] = winner, tree[1..leaves) = loser of each match
+    std::vector<value_type> keys;       // current element of each loser, arithmetic types only
+};
+
+template<typename RandomIt, typename OutputIt, typename Compare = std::less<>>
+OutputIt kway_merge(const std::vector<std::pair<RandomIt, RandomIt>>& runs, OutputIt out, Compare comp = Compare()){
+    if(runs.empty()) return out;
+    if(runs.size() == 1) return std::copy(runs[0].first, runs[0].second, out);
+    if(runs.size() == 2) return std::merge(runs[0].first, runs[0].second, runs[1].first, runs[1].second, out, comp);
+
+    loser_tree<RandomIt, Compare> tree(runs, comp);
+    for(; !tree.empty(); tree.pop()) *out++ = *tree.top();
+    return out;
+}
+
+// Co-ranking: position in every run such that exactly 'rank' elements of the merged output come before them.
+// The element at merged position 'rank' is found by binary searching each run for it, counting how many elements
+// of the other runs come before a candidate with lower_bound / upper_bound (upper_bound for earlier runs, which
+// win ties). Cuts at different ranks never overlap, so the slices between them merge independently.
+// Costs O(k^2 log^2 n) comparisons for k runs, small next to the merge itself unless k approaches sqrt(n).
+template<typename RandomIt, typename Compare>
+std::vector<std::size_t> kway_merge_split(const std::vector<std::pair<RandomIt, RandomIt>>& runs, std::size_t rank, Compare comp){
+    const std::size_t k = runs.size();
+    auto rank_of = [&](std::size_t j, std::size_t p){
+        const auto& x = runs[j].first[p];
+        std::size_t before = p;
+        for(std::size_t i = 0; i < k; ++i){
+            if(i < j)      before += std::upper_bound(runs[i].first, runs[i].second, x, comp) - runs[i].first;
+            else if(i > j) before += std::lower_bound(runs[i].first, runs[i].second, x, comp) - runs[i].first;
+        }
+        return before;
+    };
+
+    std::vector<std::size_t> cut(k);
+    for(std::size_t j = 0; j < k; ++j){
+        // Largest p with rank_of(j, p) <= rank
+        std::size_t low = 0, high = runs[j].second - runs[j].first;
+        while(low < high){
+            std::size_t mid = low + (high - low) / 2;
+            if(rank_of(j, mid) <= rank) low = mid + 1;
+            else                        high = mid;
+        }
+        if(low == 0 || rank_of(j, low - 1) != rank) continue;
+
+        const auto& x = runs[j].first[low - 1];
+        for(std::size_t i = 0; i < k; ++i){
+            if(i < j)      cut[i] = std::upper_bound(runs[i].first, runs[i].second, x, comp) - runs[i].first;
+            else if(i > j) cut[i] = std::lower_bound(runs[i].first, runs[i].second, x, comp) - runs[i].first;
+            else           cut[i] = low - 1;
+        }
+        return cut;
+    }
+    // rank is the total size: everything comes before the cut
+    for(std::size_t i = 0; i < k; ++i) cut[i] = runs[i].second - runs[i].first;
+    return cut;
+}
+
+// par_kway_merge - the output is cut into 4 slices per thread by co-ranking and every slice is merged by its own
+// loser tree. The result is identical to kway_merge.
+template<typename RandomIt, typename OutputRandomIt, typename Compare = std::less<>>
+OutputRandomIt par_kway_merge(const std::vector<std::pair<RandomIt, RandomIt>>& runs, OutputRandomIt out, Compare comp = Compare()){
+    std::size_t n = 0;
+    for(auto& run : runs) n += run.second - run.first;
+    auto& pool = default_thread_pool();
+    if(n < (1 << 15) || pool.size() == 1 || runs.size() < 2) return kway_merge(runs, out, comp);
+
+    const std::size_t slices = pool.size() * 4;
+    std::vector<std::vector<std::size_t>> cuts(slices + 1);
+    pool.parallel_for(slices + 1, [&](std::size_t s){ cuts[s] = kway_merge_split(runs, n * s / slices, comp); });
+    pool.parallel_for(slices, [&](std::size_t s){
+        std::vector<std::pair<RandomIt, RandomIt>> slice;
+        for(std::size_t i = 0; i < runs.size(); ++i)
+            if(cuts[s][i] != cuts[s + 1][i]) slice.push_back({runs[i].first + cuts[s][i], runs[i].first + cuts[s + 1][i]});
+        kway_merge(slice, out + n * s / slices, comp);
+    });
+    return out + n;
+}
+
+// bounded_inplace_merge - std::inplace_merge with a caller supplied scratch buffer instead of a hidden allocation.
+// While the shorter side of a merge fits in the buffer it is merged in one linear pass; larger merges are split at
+// the median of the longer side (rotating through the buffer when it is large enough) until the pieces fit.
+// With a buffer of b elements the cost is about n log2(n / b) moves; an empty buffer gives the O(n log n) merge.
+template<typename RandomIt, typename BufferIt>
+RandomIt bounded_rotate(RandomIt first, RandomIt middle, RandomIt last, BufferIt buffer, std::size_t buffer_size){
+    const std::size_t len1 = middle - first, len2 = last - middle;
+    if(len2 <= buffer_size && len2 <= len1){
+        if(len2 == 0) return first;
+        BufferIt buffer_end = std::move(middle, last, buffer);
+        std::move_backward(first, middle, last);
+        return std::move(buffer, buffer_end, first);
+    }
+    if(len1 <= buffer_size){
+        if(len1 == 0) return last;
+        BufferIt buffer_end = std::move(first, middle, buffer);
+        std::move(middle, last, first);
+        return std::move_backward(buffer, buffer_end, last);
+    }
+    return std::rotate(first, middle, last);
+}
+
+template<typename RandomIt, typename BufferIt, typename Compare>
+void bounded_merge(RandomIt first, RandomIt middle, RandomIt last, BufferIt buffer, std::size_t buffer_size, Compare& comp){
+    const std::size_t len1 = middle - first, len2 = last - middle;
+    if(len1 == 0 || len2 == 0) return;
+
+    if(len1 <= len2 && len1 <= buffer_size){
+        // Left side to the buffer, merge forwards
+        BufferIt b = buffer, b_end = std::move(first, middle, buffer);
+        RandomIt out = first;
+        while(b != b_end && middle != last) *out++ = comp(*middle, *b) ? std::move(*middle++) : std::move(*b++);
+        std::move(b, b_end, out);
+        return;
+    }
+    if(len2 <= buffer_size){
+        // Right side to the buffer, merge backwards
+        BufferIt b = buffer, b_end = std::move(middle, last, buffer);
+        RandomIt out = last;
+        while(b != b_end && first != middle)
+            *--out = comp(*(b_end - 1), *(middle - 1)) ? std::move(*--middle) : std::move(*--b_end);
+        std::move_backward(b, b_end, out);
+        return;
+    }
+    if(len1 + len2 == 2){
+        if(comp(*middle, *first)) std::iter_swap(first, middle);
+        return;
+    }
+
+    RandomIt cut1, cut2;
+    if(len1 > len2){
+        cut1 = first + len1 / 2;
+        cut2 = std::lower_bound(middle, last, *cut1, comp);
+    }
+    else {
+        cut2 = middle + len2 / 2;
+        cut1 = std::upper_bound(first, middle, *cut2, comp);
+    }
+    RandomIt new_middle = bounded_rotate(cut1, middle, cut2, buffer, buffer_size);
+    bounded_merge(first, cut1, new_middle, buffer, buffer_size, comp);
+    bounded_merge(new_middle, cut2, last, buffer, buffer_size, comp);
+}
+
+// Uses all of 'buffer' (any size, contents are overwritten) as scratch space
+template<typename RandomIt, typename Compare = std::less<>>
+void bounded_inplace_merge(RandomIt first, RandomIt middle, RandomIt last,
+                           std::vector<typename std::iterator_traits<RandomIt>::value_type>& buffer, Compare comp = Compare()){
+    bounded_merge(first, middle, last, buffer.begin(), buffer.size(), comp);
+}
+
+// Allocates a buffer of exactly buffer_elements up front; throws std::bad_alloc rather than merging more slowly
+template<typename RandomIt, typename Compare = std::less<>>
+void bounded_inplace_merge(RandomIt first, RandomIt middle, RandomIt last, std::size_t buffer_elements, Compare comp = Compare()){
+    std::vector<typename std::iterator_traits<RandomIt>::value_type> buffer(buffer_elements);
+    bounded_merge(first, middle, last, buffer.begin(), buffer.size(), comp);
+}
+
+// Partition - fast_partition, par_partition, par_partition_copy and par_stable_partition
+// Elements are classified 64 at a time into a bit mask, so the moves that follow depend on data, not on branches.
+// A value_predicate (x < value, x == value, ...) on int32 / int64 / float / double is classified with vector compares,
+// and on AVX-512 partition_copy moves the elements with compress-stores; any other predicate is called per element.
+
+enum class compare_op { less, less_equal, greater, greater_equal, equal, not_equal };
+
+template<typename T>
+struct value_predicate {
+    compare_op op;
+    T value;
+
+    bool operator()(const T& x) const {
+        switch(op){
+            case compare_op::less:          return x < value;
+            case compare_op::less_equal:    return x <= value;
+            case compare_op::greater:       return x > value;
+            case compare_op::greater_equal: return x >= value;
+            case compare_op::equal:         return x == value;
+            case compare_op::not_equal:     return x != value;
+        }
+        return false;
+    }
+};
+
+template<typename Pred, typename T>
+constexpr bool is_simd_value_predicate_v = std::is_same_v<Pred, value_predicate<T>> && is_simd_numeric_v<T>;
+
+#if STL_HAS_SIMD
+// Bit i set = p[i] satisfies the predicate, for 64 elements. Uses AVX2 movemask, inlined into the AVX2 and AVX-512
+// entry points.
+template<compare_op Op, typename T> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::uint64_t simd_predicate_mask64_op(const T* p, T value){
+    using V = typename simd_vector<T, 32>::type;
+    constexpr std::size_t W = simd_vector<T, 32>::lanes;
+    const V v_value = V{} + value;
+    std::uint64_t mask = 0;
+    for(std::size_t i = 0; i < 64; i += W){
+        V x;
+        __builtin_memcpy(&x, p + i, sizeof(V));
+        decltype(x < v_value) m;
+        if constexpr (Op == compare_op::less)               m = x < v_value;
+        else if constexpr (Op == compare_op::less_equal)    m = x <= v_value;
+        else if constexpr (Op == compare_op::greater)       m = x > v_value;
+        else if constexpr (Op == compare_op::greater_equal) m = x >= v_value;
+        else if constexpr (Op == compare_op::equal)         m = x == v_value;
+        else                                                m = x != v_value;
+        if constexpr (sizeof(T) == 4) mask |= std::uint64_t(_mm256_movemask_ps((__m256)m)) << i;
+        else                          mask |= std::uint64_t(_mm256_movemask_pd((__m256d)m)) << i;
+    }
+    return mask;
+}
+
+template<typename T> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::uint64_t simd_predicate_mask64_kernel(const T* p, compare_op op, T value){
+    switch(op){
+        case compare_op::less:          return simd_predicate_mask64_op<compare_op::less>(p, value);
+        case compare_op::less_equal:    return simd_predicate_mask64_op<compare_op::less_equal>(p, value);
+        case compare_op::greater:       return simd_predicate_mask64_op<compare_op::greater>(p, value);
+        case compare_op::greater_equal: return simd_predicate_mask64_op<compare_op::greater_equal>(p, value);
+        case compare_op::equal:         return simd_predicate_mask64_op<compare_op::equal>(p, value);
+        case compare_op::not_equal:     return simd_predicate_mask64_op<compare_op::not_equal>(p, value);
+    }
+    return 0;
+}
+
+template<typename T> STL_AVX2_TARGET
+std::uint64_t simd_predicate_mask64_avx2(const T* p, compare_op op, T value){ return simd_predicate_mask64_kernel(p, op, value); }
+
+// Elements satisfying the predicate compress-stored to trues, the others to falses, 64 at a time
+template<typename T> STL_AVX512_TARGET
+std::size_t simd_partition_compress_avx512(const T* in, std::size_t n, compare_op op, T value, T* trues, T* falses){
+    std::size_t t = 0, f = 0;
+    for(std::size_t i = 0; i + 64 <= n; i += 64){
+        const std::uint64_t mask = simd_predicate_mask64_kernel(in + i, op, value);
+        if constexpr (sizeof(T) == 4){
+            for(std::size_t k = 0; k < 64; k += 16){
+                const __m512i x = _mm512_loadu_si512(in + i + k);
+                const __mmask16 m = static_cast<__mmask16>(mask >> k);
+                _mm512_mask_compressstoreu_epi32(trues + t, m, x);
+                _mm512_mask_compressstoreu_epi32(falses + f, static_cast<__mmask16>(~m), x);
+                t += __builtin_popcount(m);
+                f += 16 - __builtin_popcount(m);
+            }
+        }
+        else {
+            for(std::size_t k = 0; k < 64; k += 8){
+                const __m512i x = _mm512_loadu_si512(in + i + k);
+                const __mmask8 m = static_cast<__mmask8>(mask >> k);
+                _mm512_mask_compressstoreu_epi64(trues + t, m, x);
+                _mm512_mask_compressstoreu_epi64(falses + f, static_cast<__mmask8>(~m), x);
+                t += __builtin_popcount(m);
+                f += 8 - __builtin_popcount(m);
+            }
+        }
+    }
+    return t;
+}
+#endif
+
+template<typename T, typename Pred>
+std::uint64_t predicate_mask64(const T* p, Pred& pred){
+#if STL_HAS_SIMD
+    if constexpr (is_simd_value_predicate_v<Pred, T>)
+        if(detect_simd_isa() != simd_isa::scalar) return simd_predicate_mask64_avx2(p, pred.op, pred.value);
+#endif
+    std::uint64_t mask = 0;
+    for(std::size_t i = 0; i < 64; ++i) mask |= std::uint64_t(static_cast<bool>(pred(p[i]))) << i;
+    return mask;
+}
+
+// Stable split of in[0, n) of an arithmetic type: elements satisfying pred go to trues, the rest to falses. Returns the
+// number of trues. trues and falses need room for n elements each; trues may be in itself.
+template<typename T, typename Pred>
+std::size_t partition_compress(const T* in, std::size_t n, Pred& pred, T* trues, T* falses){
+    std::size_t t = 0, f = 0, i = 0;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_value_predicate_v<Pred, T>){
+        if(detect_simd_isa() == simd_isa::avx512){
+            t = simd_partition_compress_avx512(in, n, pred.op, pred.value, trues, falses);
+            i = n / 64 * 64;
+            f = i - t;
+        }
+    }
+#endif
+    for(; i + 64 <= n; i += 64){
+        const std::uint64_t mask = predicate_mask64(in + i, pred);
+        for(std::size_t k = 0; k < 64; ++k){
+            const T x = in[i + k];
+            const bool b = (mask >> k) & 1;
+            trues[t] = x;
+            falses[f] = x;
+            t += b;
+            f += !b;
+        }
+    }
+    for(; i < n; ++i){
+        const T x = in[i];
+        const bool b = pred(x);
+        trues[t] = x;
+        falses[f] = x;
+        t += b;
+        f += !b;
+    }
+    return t;
+}
+
+template<typename RandomIt, typename Pred>
+std::size_t partition_count(RandomIt first, RandomIt last, Pred& pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<RandomIt>){
+        const std::size_t n = last - first;
+        std::size_t count = 0, i = 0;
+        for(; i + 64 <= n; i += 64) count += __builtin_popcountll(predicate_mask64(&first[i], pred));
+        for(; i < n; ++i) count += static_cast<bool>(pred(first[i]));
+        return count;
+    }
+    else return std::count_if(first, last, pred);
+}
+
+// fast_partition - unstable, in place. Works on a block of 64 at each end: the masks of misplaced elements (falses on
+// the left, trues on the right) are paired up and swapped, and a block moves on once it has none left.
+template<typename RandomIt, typename Pred>
+RandomIt fast_partition(RandomIt first, RandomIt last, Pred pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<RandomIt>){
+        if(last - first < 128) return std::partition(first, last, pred);
+        T* const base = &*first;
+        T* l = base;
+        T* r = base + (last - first);
+        std::uint64_t left = 0, right = 0;
+        bool need_left = true, need_right = true;
+        while(r - l >= 128){
+            if(need_left)  left = ~predicate_mask64(l, pred);
+            if(need_right) right = predicate_mask64(r - 64, pred);
+            need_left = need_right = false;
+            while(left && right){
+                std::swap(l[__builtin_ctzll(left)], r[__builtin_ctzll(right) - 64]);
+                left &= left - 1;
+                right &= right - 1;
+            }
+            if(!left){
+                l += 64;
+                need_left = true;
+            }
+            if(!right){
+                r -= 64;
+                need_right = true;
+            }
+        }
+        // Everything before l satisfies pred, everything from r on does not
+        return first + (std::partition(l, r, pred) - base);
+    }
+    else return std::partition(first, last, pred);
+}
+
+// par_partition - unstable. Chunks are partitioned in parallel; then the falses that ended up before the final
+// partition point are swapped with the trues after it, with the swaps split evenly across threads.
+template<typename RandomIt, typename Pred>
+RandomIt par_partition(RandomIt first, RandomIt last, Pred pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    auto& pool = default_thread_pool();
+    if(n < (1 << 15) || pool.size() == 1) return fast_partition(first, last, pred);
+
+    const std::size_t chunk = parallel_chunk_elements<T>();
+    std::vector<std::size_t> mids((n + chunk - 1) / chunk);
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        mids[c] = fast_partition(first + begin, first + end, pred) - first;
+    });
+
+    std::size_t split = 0;
+    for(std::size_t c = 0; c < mids.size(); ++c) split += mids[c] - c * chunk;
+
+    // Misplaced falses: [mid, end) of each chunk below split. Misplaced trues: [begin, mid) above split.
+    // Empty ranges (an all true chunk below split, an all false one above) are left out: the swap loop below steps to
+    // the next range only once per element.
+    std::vector<std::pair<std::size_t, std::size_t>> falses, trues;
+    for(std::size_t c = 0; c < mids.size(); ++c){
+        const std::size_t begin = c * chunk, end = std::min(n, begin + chunk);
+        if(mids[c] < std::min(end, split))   falses.push_back({mids[c], std::min(end, split)});
+        if(std::max(begin, split) < mids[c]) trues.push_back({std::max(begin, split), mids[c]});
+    }
+    auto prefix = [](const std::vector<std::pair<std::size_t, std::size_t>>& ranges){
+        std::vector<std::size_t> start(1, 0);
+        for(auto& range : ranges) start.push_back(start.back() + range.second - range.first);
+        return start;
+    };
+    const std::vector<std::size_t> false_start = prefix(falses), true_start = prefix(trues);
+    const std::size_t misplaced = false_start.back();
+
+    const std::size_t pieces = pool.size() * 4;
+    pool.parallel_for(pieces, [&](std::size_t p){
+        const std::size_t begin = misplaced * p / pieces, end = misplaced * (p + 1) / pieces;
+        if(begin == end) return;
+        std::size_t fi = std::upper_bound(false_start.begin(), false_start.end(), begin) - false_start.begin() - 1;
+        std::size_t ti = std::upper_bound(true_start.begin(), true_start.end(), begin) - true_start.begin() - 1;
+        std::size_t fpos = falses[fi].first + (begin - false_start[fi]);
+        std::size_t tpos = trues[ti].first + (begin - true_start[ti]);
+        for(std::size_t k = begin; k < end; ++k){
+            if(fpos == falses[fi].second) fpos = falses[++fi].first;
+            if(tpos == trues[ti].second)  tpos = trues[++ti].first;
+            std::iter_swap(first + fpos++, first + tpos++);
+        }
+    });
+    return first + split;
+}
+
+// fast_partition_copy - stable partition_copy; arithmetic inputs are split through two small block buffers
+template<typename InputIt, typename OutputIt1, typename OutputIt2, typename Pred>
+std::pair<OutputIt1, OutputIt2> fast_partition_copy(InputIt first, InputIt last, OutputIt1 out_true, OutputIt2 out_false, Pred pred){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<InputIt>){
+        constexpr std::size_t block = 4096;
+        std::vector<T> trues(block), falses(block);
+        for(std::size_t i = 0, n = last - first; i < n; i += block){
+            const std::size_t len = std::min(block, n - i);
+            const std::size_t t = partition_compress(&first[i], len, pred, trues.data(), falses.data());
+            out_true = std::copy(trues.begin(), trues.begin() + t, out_true);
+            out_false = std::copy(falses.begin(), falses.begin() + (len - t), out_false);
+        }
+        return {out_true, out_false};
+    }
+    else return std::partition_copy(first, last, out_true, out_false, pred);
+}
+
+// par_partition_copy - stable. Counts the trues of every chunk, then every chunk writes its share of both outputs at
+// the offsets given by the counts of the chunks before it. pred is called twice per element.
+template<typename RandomIt, typename OutputIt1, typename OutputIt2, typename Pred>
+std::pair<OutputIt1, OutputIt2> par_partition_copy(RandomIt first, RandomIt last, OutputIt1 out_true, OutputIt2 out_false, Pred pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    constexpr bool random_access_outputs =
+        std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<OutputIt1>::iterator_category> &&
+        std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<OutputIt2>::iterator_category>;
+    const std::size_t n = last - first;
+    if constexpr (random_access_outputs){
+        if(n >= (1 << 15) && default_thread_pool().size() > 1){
+            const std::size_t chunk = parallel_chunk_elements<T>();
+            std::vector<std::size_t> counts((n + chunk - 1) / chunk);
+            parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+                counts[c] = partition_count(first + begin, first + end, pred);
+            });
+            std::vector<std::size_t> true_offset(counts.size() + 1, 0);
+            for(std::size_t c = 0; c < counts.size(); ++c) true_offset[c + 1] = true_offset[c] + counts[c];
+            parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+                fast_partition_copy(first + begin, first + end, out_true + true_offset[c], out_false + (begin - true_offset[c]), pred);
+            });
+            return {out_true + true_offset.back(), out_false + (n - true_offset.back())};
+        }
+    }
+    return fast_partition_copy(first, last, out_true, out_false, pred);
+}
+
+// Stable partition of one chunk with a buffer for its falses
+template<typename RandomIt, typename Pred>
+RandomIt stable_partition_chunk(RandomIt first, RandomIt last, Pred& pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    // The falses wait in a buffer of at most one chunk, freed on return; uninitialized for arithmetic types
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<RandomIt>){
+        const std::unique_ptr<T[]> falses(new T[last - first]);
+        T* data = &*first;
+        const std::size_t t = partition_compress(data, last - first, pred, data, falses.get());
+        std::copy(falses.get(), falses.get() + ((last - first) - t), first + t);
+        return first + t;
+    }
+    else {
+        std::vector<T> falses;
+        RandomIt out = first;
+        for(RandomIt it = first; it != last; ++it){
+            if(!pred(*it)){
+                falses.push_back(std::move(*it));
+                continue;
+            }
+            if(out != it) *out = std::move(*it);
+            ++out;
+        }
+        std::move(falses.begin(), falses.end(), out);
+        return out;
+    }
+}
+
+// par_stable_partition - stable_partition without a buffer the size of the input. Chunks are partitioned in parallel,
+// each with a buffer of its own size that is freed when the chunk is done (so at most one per running thread), then
+// neighbouring chunks are joined pairwise by rotating the falses of the left one past the trues of the right one
+// (log2(chunks) rounds, the pairs of a round in parallel).
+template<typename RandomIt, typename Pred>
+RandomIt par_stable_partition(RandomIt first, RandomIt last, Pred pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if(n == 0) return first;
+
+    const std::size_t chunk = parallel_chunk_elements<T>();
+    struct segment { std::size_t begin, mid, end; };
+    std::vector<segment> segments((n + chunk - 1) / chunk);
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        segments[c] = {begin, static_cast<std::size_t>(stable_partition_chunk(first + begin, first + end, pred) - first), end};
+    });
+
+    while(segments.size() > 1){
+        std::vector<segment> joined((segments.size() + 1) / 2);
+        default_thread_pool().parallel_for(joined.size(), [&](std::size_t j){
+            const segment& a = segments[2 * j];
+            if(2 * j + 1 == segments.size()){
+                joined[j] = a;
+                return;
+            }
+            const segment& b = segments[2 * j + 1];
+            std::rotate(first + a.mid, first + b.begin, first + b.mid);
+            joined[j] = {a.begin, a.mid + (b.mid - b.begin), b.end};
+        });
+        segments = std::move(joined);
+    }
+    return first + segments[0].mid;
+}
+
+// Scan kernels - simd_find, simd_count, simd_any_of / all_of / none_of, simd_mismatch, simd_equal, simd_adjacent_find
+// Contiguous ranges of any arithmetic type (char and the other byte types included) are compared a whole vector at a
+// time, and the _find scans stop at the first vector holding a match. A lambda is opaque, so the _if versions
+// vectorize predicate expressions instead: elem % 7 == 0, elem > 0, elem >= 10 && elem < 20, ... built from the
+// placeholder elem. They are ordinary callables too. Constants are converted to the element type, and arithmetic is done
+// in the element type. Any other predicate, type or iterator falls back to the std:: algorithm.
+
+struct predicate_expr {};
+
+template<typename E>
+constexpr bool is_predicate_expr_v = std::is_base_of_v<predicate_expr, E>;
+
+template<typename T>
+constexpr bool is_simd_scan_type_v = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 8;
+
+enum class predicate_op { add, sub, mul, mod, bit_and, equal, not_equal, less, less_equal, greater, greater_equal,
+                          logical_and, logical_or };
+
+#if STL_HAS_SIMD
+// Lane-wise a % b. 8 to 32 bit integers divide in float / double, which hold them exactly and truncate the same way
+template<typename T, typename V>
+__attribute__((always_inline)) inline void simd_mod(const V& a, const V& b, V& out){
+    if constexpr (std::is_integral_v<T> && sizeof(T) <= 4){
+        using F = std::conditional_t<sizeof(T) == 4, double, float>;
+        typedef F FV __attribute__((vector_size(sizeof(V) / sizeof(T) * sizeof(F))));
+        const V q = __builtin_convertvector(__builtin_convertvector(a, FV) / __builtin_convertvector(b, FV), V);
+        out = a - q * b;
+    }
+    else out = a % b;
+}
+#endif
+
+// The element itself
+struct predicate_arg : predicate_expr {
+    static constexpr bool is_condition = false;
+
+    template<typename T> T operator()(const T& x) const { return x; }
+#if STL_HAS_SIMD
+    template<typename T, typename V>
+    __attribute__((always_inline)) void vector(const V& x, V& out) const { out = x; }
+#endif
+};
+
+constexpr predicate_arg elem{};
+
+template<typename C>
+struct predicate_constant : predicate_expr {
+    static constexpr bool is_condition = false;
+    C value;
+
+    template<typename T> T operator()(const T&) const { return static_cast<T>(value); }
+#if STL_HAS_SIMD
+    template<typename T, typename V>
+    __attribute__((always_inline)) void vector(const V&, V& out) const { out = V{} + static_cast<T>(value); }
+#endif
+};
+
+#if STL_HAS_SIMD
+// Evaluates e on the lanes of x as a mask (all ones = true); a value e counts as true when non-zero, as in C++
+template<typename T, typename E, typename V, typename M>
+__attribute__((always_inline)) inline void predicate_vector_mask(const E& e, const V& x, M& out){
+    if constexpr (E::is_condition) e.template vector<T>(x, out);
+    else {
+        V v;
+        e.template vector<T>(x, v);
+        out = v != V{};
+    }
+}
+#endif
+
+template<predicate_op Op, typename L, typename R>
+struct predicate_binary : predicate_expr {
+    static constexpr bool is_logical = Op == predicate_op::logical_and || Op == predicate_op::logical_or;
+    static constexpr bool is_condition = Op >= predicate_op::equal;
+    static_assert(is_logical || (!L::is_condition && !R::is_condition), "only && and || take conditions as operands");
+    L l;
+    R r;
+
+    template<typename T> auto operator()(const T& x) const {
+        if constexpr (Op == predicate_op::logical_and)        return static_cast<bool>(l(x)) && static_cast<bool>(r(x));
+        else if constexpr (Op == predicate_op::logical_or)    return static_cast<bool>(l(x)) || static_cast<bool>(r(x));
+        else {
+            const T a = l(x), b = r(x);
+            if constexpr (Op == predicate_op::add)                return static_cast<T>(a + b);
+            else if constexpr (Op == predicate_op::sub)           return static_cast<T>(a - b);
+            else if constexpr (Op == predicate_op::mul)           return static_cast<T>(a * b);
+            else if constexpr (Op == predicate_op::mod)           return static_cast<T>(a % b);
+            else if constexpr (Op == predicate_op::bit_and)       return static_cast<T>(a & b);
+            else if constexpr (Op == predicate_op::equal)         return a == b;
+            else if constexpr (Op == predicate_op::not_equal)     return a != b;
+            else if constexpr (Op == predicate_op::less)          return a < b;
+            else if constexpr (Op == predicate_op::less_equal)    return a <= b;
+            else if constexpr (Op == predicate_op::greater)       return a > b;
+            else                                                  return a >= b;
+        }
+    }
+
+#if STL_HAS_SIMD
+    // out is a V for arithmetic, a mask vector (decltype(V{} < V{})) for conditions
+    template<typename T, typename V, typename Out>
+    __attribute__((always_inline)) void vector(const V& x, Out& out) const {
+        if constexpr (is_logical){
+            Out a, b;
+            predicate_vector_mask<T>(l, x, a);
+            predicate_vector_mask<T>(r, x, b);
+            if constexpr (Op == predicate_op::logical_and) out = a & b;
+            else                                           out = a | b;
+        }
+        else {
+            V a, b;
+            l.template vector<T>(x, a);
+            r.template vector<T>(x, b);
+            if constexpr (Op == predicate_op::add)                out = a + b;
+            else if constexpr (Op == predicate_op::sub)           out = a - b;
+            else if constexpr (Op == predicate_op::mul)           out = a * b;
+            else if constexpr (Op == predicate_op::mod)           simd_mod<T>(a, b, out);
+            else if constexpr (Op == predicate_op::bit_and)       out = a & b;
+            else if constexpr (Op == predicate_op::equal)         out = a == b;
+            else if constexpr (Op == predicate_op::not_equal)     out = a != b;
+            else if constexpr (Op == predicate_op::less)          out = a < b;
+            else if constexpr (Op == predicate_op::less_equal)    out = a <= b;
+            else if constexpr (Op == predicate_op::greater)       out = a > b;
+            else                                                  out = a >= b;
+        }
+    }
+#endif
+};
+
+template<typename E>
+struct predicate_not : predicate_expr {
+    static constexpr bool is_condition = true;
+    E e;
+
+    template<typename T> bool operator()(const T& x) const { return !e(x); }
+#if STL_HAS_SIMD
+    template<typename T, typename V, typename M>
+    __attribute__((always_inline)) void vector(const V& x, M& out) const {
+        predicate_vector_mask<T>(e, x, out);
+        out = ~out;
+    }
+#endif
+};
+
+template<typename X>
+auto as_predicate_expr(const X& x){
+    if constexpr (is_predicate_expr_v<X>) return x;
+    else {
+        static_assert(std::is_arithmetic_v<X>, "predicate expressions combine elem with arithmetic constants");
+        return predicate_constant<X>{{}, x};
+    }
+}
+
+template<predicate_op Op, typename L, typename R>
+auto make_predicate_binary(const L& l, const R& r){
+    auto a = as_predicate_expr(l);
+    auto b = as_predicate_expr(r);
+    return predicate_binary<Op, decltype(a), decltype(b)>{{}, a, b};
+}
+
+template<typename L, typename R>
+using enable_if_predicate_expr_t = std::enable_if_t<is_predicate_expr_v<L> || is_predicate_expr_v<R>, int>;
+
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator+(const L& l, const R& r){ return make_predicate_binary<predicate_op::add>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator-(const L& l, const R& r){ return make_predicate_binary<predicate_op::sub>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator*(const L& l, const R& r){ return make_predicate_binary<predicate_op::mul>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator%(const L& l, const R& r){ return make_predicate_binary<predicate_op::mod>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator&(const L& l, const R& r){ return make_predicate_binary<predicate_op::bit_and>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator==(const L& l, const R& r){ return make_predicate_binary<predicate_op::equal>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator!=(const L& l, const R& r){ return make_predicate_binary<predicate_op::not_equal>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator<(const L& l, const R& r){ return make_predicate_binary<predicate_op::less>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator<=(const L& l, const R& r){ return make_predicate_binary<predicate_op::less_equal>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator>(const L& l, const R& r){ return make_predicate_binary<predicate_op::greater>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator>=(const L& l, const R& r){ return make_predicate_binary<predicate_op::greater_equal>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator&&(const L& l, const R& r){ return make_predicate_binary<predicate_op::logical_and>(l, r); }
+template<typename L, typename R, enable_if_predicate_expr_t<L, R> = 0>
+auto operator||(const L& l, const R& r){ return make_predicate_binary<predicate_op::logical_or>(l, r); }
+template<typename E, std::enable_if_t<is_predicate_expr_v<E>, int> = 0>
+auto operator!(const E& e){ return predicate_not<E>{{}, e}; }
+
+#if STL_HAS_SIMD
+// One bit per byte of a mask vector, so lane i of a T vector owns bits [i * sizeof(T), (i + 1) * sizeof(T))
+template<std::size_t Bytes, typename M> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::uint64_t simd_byte_mask(const M& m){
+    if constexpr (Bytes == 32) return static_cast<std::uint32_t>(_mm256_movemask_epi8((__m256i)m));
+    else {
+        __m256i lo, hi;
+        __builtin_memcpy(&lo, &m, 32);
+        __builtin_memcpy(&hi, reinterpret_cast<const char*>(&m) + 32, 32);
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(lo)) |
+               std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(hi))) << 32;
+    }
+}
+
+// Index of the first element of p[0, n) for which pred is true (false when Negate), n if there is none
+template<std::size_t Bytes, bool Negate, typename T, typename Pred> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::size_t simd_find_if_kernel(const T* p, std::size_t n, const Pred& pred){
+    using V = typename simd_vector<T, Bytes>::type;
+    using M = decltype(V{} < V{});
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    std::size_t i = 0;
+    // Four vectors per test of the combined mask, the one holding the match is looked for afterwards
+    for(; i + 4 * W <= n; i += 4 * W){
+        M m[4];
+        for(std::size_t k = 0; k < 4; ++k){
+            V x;
+            __builtin_memcpy(&x, p + i + k * W, sizeof(V));
+            predicate_vector_mask<T>(pred, x, m[k]);
+            if constexpr (Negate) m[k] = ~m[k];
+        }
+        if(simd_byte_mask<Bytes>((m[0] | m[1]) | (m[2] | m[3]))){
+            for(std::size_t k = 0; k < 4; ++k)
+                if(const std::uint64_t bits = simd_byte_mask<Bytes>(m[k])) return i + k * W + __builtin_ctzll(bits) / sizeof(T);
+        }
+    }
+    for(; i + W <= n; i += W){
+        V x;
+        __builtin_memcpy(&x, p + i, sizeof(V));
+        M m;
+        predicate_vector_mask<T>(pred, x, m);
+        if constexpr (Negate) m = ~m;
+        if(const std::uint64_t bits = simd_byte_mask<Bytes>(m)) return i + __builtin_ctzll(bits) / sizeof(T);
+    }
+    for(; i < n; ++i)
+        if(static_cast<bool>(pred(p[i])) != Negate) return i;
+    return n;
+}
+
+template<std::size_t Bytes, typename T, typename Pred> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::size_t simd_count_if_kernel(const T* p, std::size_t n, const Pred& pred){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    std::size_t bits = 0, i = 0;
+    for(; i + W <= n; i += W){
+        V x;
+        __builtin_memcpy(&x, p + i, sizeof(V));
+        decltype(x < x) m;
+        predicate_vector_mask<T>(pred, x, m);
+        bits += __builtin_popcountll(simd_byte_mask<Bytes>(m));
+    }
+    std::size_t count = bits / sizeof(T);
+    for(; i < n; ++i) count += static_cast<bool>(pred(p[i]));
+    return count;
+}
+
+// First i with !(a[i] == b[i]), n if none
+template<std::size_t Bytes, typename T> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::size_t simd_mismatch_kernel(const T* a, const T* b, std::size_t n){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    std::size_t i = 0;
+    for(; i + W <= n; i += W){
+        V x, y;
+        __builtin_memcpy(&x, a + i, sizeof(V));
+        __builtin_memcpy(&y, b + i, sizeof(V));
+        const decltype(x < x) m = x != y;
+        if(const std::uint64_t bits = simd_byte_mask<Bytes>(m)) return i + __builtin_ctzll(bits) / sizeof(T);
+    }
+    for(; i < n; ++i)
+        if(!(a[i] == b[i])) return i;
+    return n;
+}
+
+// First i with p[i] == p[i + 1], n if none. The second load is the first one moved along by an element.
+template<std::size_t Bytes, typename T> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::size_t simd_adjacent_find_kernel(const T* p, std::size_t n){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    std::size_t i = 0;
+    for(; i + W + 1 <= n; i += W){
+        V x, y;
+        __builtin_memcpy(&x, p + i, sizeof(V));
+        __builtin_memcpy(&y, p + i + 1, sizeof(V));
+        const decltype(x < x) m = x == y;
+        if(const std::uint64_t bits = simd_byte_mask<Bytes>(m)) return i + __builtin_ctzll(bits) / sizeof(T);
+    }
+    for(; i + 1 < n; ++i)
+        if(p[i] == p[i + 1]) return i;
+    return n;
+}
+
+template<bool Negate, typename T, typename Pred> STL_AVX2_TARGET
+std::size_t simd_find_if_avx2(const T* p, std::size_t n, const Pred& pred){ return simd_find_if_kernel<32, Negate>(p, n, pred); }
+template<bool Negate, typename T, typename Pred> STL_AVX512_TARGET
+std::size_t simd_find_if_avx512(const T* p, std::size_t n, const Pred& pred){ return simd_find_if_kernel<64, Negate>(p, n, pred); }
+template<typename T, typename Pred> STL_AVX2_TARGET
+std::size_t simd_count_if_avx2(const T* p, std::size_t n, const Pred& pred){ return simd_count_if_kernel<32>(p, n, pred); }
+template<typename T, typename Pred> STL_AVX512_TARGET
+std::size_t simd_count_if_avx512(const T* p, std::size_t n, const Pred& pred){ return simd_count_if_kernel<64>(p, n, pred); }
+template<typename T> STL_AVX2_TARGET
+std::size_t simd_mismatch_avx2(const T* a, const T* b, std::size_t n){ return simd_mismatch_kernel<32>(a, b, n); }
+template<typename T> STL_AVX512_TARGET
+std::size_t simd_mismatch_avx512(const T* a, const T* b, std::size_t n){ return simd_mismatch_kernel<64>(a, b, n); }
+template<typename T> STL_AVX2_TARGET
+std::size_t simd_adjacent_find_avx2(const T* p, std::size_t n){ return simd_adjacent_find_kernel<32>(p, n); }
+template<typename T> STL_AVX512_TARGET
+std::size_t simd_adjacent_find_avx512(const T* p, std::size_t n){ return simd_adjacent_find_kernel<64>(p, n); }
+
+// Index of the first element matching pred (failing it when Negate) on the best instruction set, or n + 1 when the
+// CPU has neither, so the caller falls back to the std:: algorithm
+template<bool Negate, typename T, typename Pred>
+std::size_t simd_find_if_index(const T* p, std::size_t n, const Pred& pred){
+    switch(detect_simd_isa()){
+        case simd_isa::avx512: return simd_find_if_avx512<Negate>(p, n, pred);
+        case simd_isa::avx2:   return simd_find_if_avx2<Negate>(p, n, pred);
+        case simd_isa::scalar: break;
+    }
+    return n + 1;
+}
+#endif
+
+template<typename InputIt, typename Pred>
+InputIt simd_find_if(InputIt first, InputIt last, Pred pred){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_scan_type_v<T> && is_predicate_expr_v<Pred> && is_contiguous_iterator_v<InputIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return last;
+        const std::size_t i = simd_find_if_index<false>(&*first, n, pred);
+        if(i <= n) return first + i;
+    }
+#endif
+    return std::find_if(first, last, pred);
+}
+
+template<typename InputIt, typename Pred>
+InputIt simd_find_if_not(InputIt first, InputIt last, Pred pred){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_scan_type_v<T> && is_predicate_expr_v<Pred> && is_contiguous_iterator_v<InputIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return last;
+        const std::size_t i = simd_find_if_index<true>(&*first, n, pred);
+        if(i <= n) return first + i;
+    }
+#endif
+    return std::find_if_not(first, last, pred);
+}
+
+// Vectorized when value converts to the element type and back unchanged, so both compare the same way
+template<typename InputIt, typename U>
+InputIt simd_find(InputIt first, InputIt last, const U& value){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    if constexpr (is_simd_scan_type_v<T> && std::is_arithmetic_v<U>)
+        if(static_cast<U>(static_cast<T>(value)) == value) return simd_find_if(first, last, elem == static_cast<T>(value));
+    return std::find(first, last, value);
+}
+
+template<typename InputIt, typename Pred>
+typename std::iterator_traits<InputIt>::difference_type simd_count_if(InputIt first, InputIt last, Pred pred){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_scan_type_v<T> && is_predicate_expr_v<Pred> && is_contiguous_iterator_v<InputIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return 0;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: return simd_count_if_avx512(&*first, n, pred);
+            case simd_isa::avx2:   return simd_count_if_avx2(&*first, n, pred);
+            case simd_isa::scalar: break;
+        }
+    }
+#endif
+    return std::count_if(first, last, pred);
+}
+
+template<typename InputIt, typename U>
+typename std::iterator_traits<InputIt>::difference_type simd_count(InputIt first, InputIt last, const U& value){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    if constexpr (is_simd_scan_type_v<T> && std::is_arithmetic_v<U>)
+        if(static_cast<U>(static_cast<T>(value)) == value) return simd_count_if(first, last, elem == static_cast<T>(value));
+    return std::count(first, last, value);
+}
+
+template<typename InputIt, typename Pred>
+bool simd_any_of(InputIt first, InputIt last, Pred pred){ return simd_find_if(first, last, pred) != last; }
+
+template<typename InputIt, typename Pred>
+bool simd_all_of(InputIt first, InputIt last, Pred pred){ return simd_find_if_not(first, last, pred) == last; }
+
+template<typename InputIt, typename Pred>
+bool simd_none_of(InputIt first, InputIt last, Pred pred){ return simd_find_if(first, last, pred) == last; }
+
+template<typename InputIt1, typename InputIt2>
+std::pair<InputIt1, InputIt2> simd_mismatch(InputIt1 first1, InputIt1 last1, InputIt2 first2){
+    using T = typename std::iterator_traits<InputIt1>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_scan_type_v<T> && std::is_same_v<T, typename std::iterator_traits<InputIt2>::value_type> &&
+                  is_contiguous_iterator_v<InputIt1> && is_contiguous_iterator_v<InputIt2>){
+        const std::size_t n = last1 - first1;
+        if(n == 0) return {first1, first2};
+        std::size_t i = n + 1;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: i = simd_mismatch_avx512(&*first1, &*first2, n); break;
+            case simd_isa::avx2:   i = simd_mismatch_avx2(&*first1, &*first2, n); break;
+            case simd_isa::scalar: break;
+        }
+        if(i <= n) return {first1 + i, first2 + i};
+    }
+#endif
+    return std::mismatch(first1, last1, first2);
+}
+
+template<typename InputIt1, typename InputIt2>
+bool simd_equal(InputIt1 first1, InputIt1 last1, InputIt2 first2){ return simd_mismatch(first1, last1, first2).first == last1; }
+
+template<typename ForwardIt>
+ForwardIt simd_adjacent_find(ForwardIt first, ForwardIt last){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_scan_type_v<T> && is_contiguous_iterator_v<ForwardIt>){
+        const std::size_t n = last - first;
+        if(n == 0) return last;
+        std::size_t i = n + 1;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: i = simd_adjacent_find_avx512(&*first, n); break;
+            case simd_isa::avx2:   i = simd_adjacent_find_avx2(&*first, n); break;
+            case simd_isa::scalar: break;
+        }
+        if(i <= n) return first + i;
+    }
+#endif
+    return std::adjacent_find(first, last);
+}
+
+// Compaction - fast_remove_if, fast_unique and their _copy forms, the par_ versions, hash_unique and the erase helpers
+// Same contracts as the std:: algorithms (stable, moved-over elements past the returned end are unspecified). Arithmetic
+// elements are dropped 64 at a time through a bit mask: every element is written to the output position and the
+// position only advances for kept ones, so no branch depends on the data. Comparisons with a constant (value_predicate),
+// predicate expressions (elem % 7 == 0) and unique's default equality on int32 / int64 / float / double build the mask
+// with vector compares, and on AVX-512 the kept elements are compress-stored. par_ versions compact cache-sized chunks
+// in parallel and place them with the kept counts of the chunks before them. hash_unique removes duplicates from
+// unsorted ranges and keeps the first occurrence of every element, in input order.
+
+// The "predicate" unique compacts with: drops an element equivalent to the one before it
+template<typename BinaryPred>
+struct adjacent_equal {
+    BinaryPred eq;
+};
+
+template<typename Pred>
+struct is_adjacent_equal : std::false_type {};
+template<typename BinaryPred>
+struct is_adjacent_equal<adjacent_equal<BinaryPred>> : std::true_type {};
+template<typename Pred>
+constexpr bool is_adjacent_equal_v = is_adjacent_equal<Pred>::value;
+
+template<typename T, typename Pred>
+constexpr bool is_simd_compaction_v = is_simd_numeric_v<T> &&
+    (is_simd_value_predicate_v<Pred, T> || is_predicate_expr_v<Pred> ||
+     std::is_same_v<Pred, adjacent_equal<std::equal_to<>>> || std::is_same_v<Pred, adjacent_equal<std::equal_to<T>>>);
+
+// True if the element at p is dropped; for unique this reads p[-1]
+template<typename T, typename Pred>
+bool compaction_drops(const T* p, Pred& pred){
+    if constexpr (is_adjacent_equal_v<Pred>) return pred.eq(p[-1], *p);
+    else return pred(*p);
+}
+
+#if STL_HAS_SIMD
+// Bit i set = p[i] is dropped, for 64 elements
+template<typename T, typename Pred> STL_AVX2_TARGET
+__attribute__((always_inline)) inline std::uint64_t simd_drop_mask64_kernel(const T* p, const Pred& pred){
+    if constexpr (is_simd_value_predicate_v<Pred, T>) return simd_predicate_mask64_kernel(p, pred.op, pred.value);
+    else {
+        using V = typename simd_vector<T, 32>::type;
+        constexpr std::size_t W = simd_vector<T, 32>::lanes;
+        std::uint64_t mask = 0;
+        for(std::size_t i = 0; i < 64; i += W){
+            V x;
+            __builtin_memcpy(&x, p + i, sizeof(V));
+            decltype(x < x) m;
+            if constexpr (is_adjacent_equal_v<Pred>){
+                V before;
+                __builtin_memcpy(&before, p + i - 1, sizeof(V));
+                m = x == before;
+            }
+            else predicate_vector_mask<T>(pred, x, m);
+            if constexpr (sizeof(T) == 4) mask |= std::uint64_t(_mm256_movemask_ps((__m256)m)) << i;
+            else                          mask |= std::uint64_t(_mm256_movemask_pd((__m256d)m)) << i;
+        }
+        return mask;
+    }
+}
+
+template<typename T, typename Pred> STL_AVX2_TARGET
+std::uint64_t simd_drop_mask64_avx2(const T* p, const Pred& pred){ return simd_drop_mask64_kernel(p, pred); }
+
+// Compress-stores the elements of in[0, n / 64 * 64) that are not dropped to out, returns how many. Stores never reach
+// past the element being read, so out may be in.
+template<typename T, typename Pred> STL_AVX512_TARGET
+std::size_t simd_compact_avx512(const T* in, std::size_t n, const Pred& pred, T* out){
+    std::size_t t = 0;
+    for(std::size_t i = 0; i + 64 <= n; i += 64){
+        const std::uint64_t keep = ~simd_drop_mask64_kernel(in + i, pred);
+        if constexpr (sizeof(T) == 4){
+            for(std::size_t k = 0; k < 64; k += 16){
+                const __mmask16 m = static_cast<__mmask16>(keep >> k);
+                _mm512_mask_compressstoreu_epi32(out + t, m, _mm512_loadu_si512(in + i + k));
+                t += __builtin_popcount(m);
+            }
+        }
+        else {
+            for(std::size_t k = 0; k < 64; k += 8){
+                const __mmask8 m = static_cast<__mmask8>(keep >> k);
+                _mm512_mask_compressstoreu_epi64(out + t, m, _mm512_loadu_si512(in + i + k));
+                t += __builtin_popcount(m);
+            }
+        }
+    }
+    return t;
+}
+#endif
+
+template<typename T, typename Pred>
+std::uint64_t drop_mask64(const T* p, Pred& pred){
+#if STL_HAS_SIMD
+    if constexpr (is_simd_compaction_v<T, Pred>)
+        if(detect_simd_isa() != simd_isa::scalar) return simd_drop_mask64_avx2(p, pred);
+#endif
+    std::uint64_t mask = 0;
+    for(std::size_t i = 0; i < 64; ++i) mask |= std::uint64_t(compaction_drops(p + i, pred)) << i;
+    return mask;
+}
+
+// Stable compaction of in[0, n) of an arithmetic type: the elements pred does not drop are written to out, the count is
+// returned. out may be in itself; a separate out needs room for n elements, dropped ones are written there too.
+template<typename T, typename Pred>
+std::size_t compact_compress(const T* in, std::size_t n, Pred& pred, T* out){
+    std::size_t t = 0, i = 0;
+    if constexpr (is_adjacent_equal_v<Pred>){
+        if(n == 0) return 0;
+        out[0] = in[0];
+        t = i = 1;
+    }
+#if STL_HAS_SIMD
+    if constexpr (is_simd_compaction_v<T, Pred>){
+        if(detect_simd_isa() == simd_isa::avx512){
+            t += simd_compact_avx512(in + i, n - i, pred, out + t);
+            i += (n - i) / 64 * 64;
+        }
+    }
+#endif
+    for(; i + 64 <= n; i += 64){
+        const std::uint64_t drop = drop_mask64(in + i, pred);
+        for(std::size_t k = 0; k < 64; ++k){
+            out[t] = in[i + k];
+            t += !((drop >> k) & 1);
+        }
+    }
+    for(; i < n; ++i){
+        const bool drop = compaction_drops(in + i, pred);
+        out[t] = in[i];
+        t += !drop;
+    }
+    return t;
+}
+
+// Number of elements of [first, last) that compaction keeps
+template<typename RandomIt, typename Pred>
+std::size_t compact_count(RandomIt first, RandomIt last, Pred& pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if(n == 0) return 0;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<RandomIt>){
+        const T* p = &*first;
+        std::size_t kept = 0, i = 0;
+        if constexpr (is_adjacent_equal_v<Pred>) kept = i = 1;
+        for(; i + 64 <= n; i += 64) kept += 64 - __builtin_popcountll(drop_mask64(p + i, pred));
+        for(; i < n; ++i) kept += !compaction_drops(p + i, pred);
+        return kept;
+    }
+    else if constexpr (is_adjacent_equal_v<Pred>){
+        std::size_t kept = 1;
+        for(std::size_t i = 1; i < n; ++i) kept += !pred.eq(first[i - 1], first[i]);
+        return kept;
+    }
+    else return n - std::count_if(first, last, pred);
+}
+
+template<typename ForwardIt, typename Pred>
+ForwardIt fast_remove_if(ForwardIt first, ForwardIt last, Pred pred){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<ForwardIt>){
+        if(first == last) return last;
+        T* data = &*first;
+        return first + compact_compress(data, last - first, pred, data);
+    }
+    else return std::remove_if(first, last, pred);
+}
+
+// Compared with vector instructions when value converts to the element type and back unchanged
+template<typename ForwardIt, typename U>
+ForwardIt fast_remove(ForwardIt first, ForwardIt last, const U& value){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (is_simd_numeric_v<T> && std::is_arithmetic_v<U>)
+        if(static_cast<U>(static_cast<T>(value)) == value)
+            return fast_remove_if(first, last, value_predicate<T>{compare_op::equal, static_cast<T>(value)});
+    return fast_remove_if(first, last, [&](const T& x){ return x == value; });
+}
+
+// Arithmetic inputs are compacted through a small block buffer, so out only needs room for the result
+template<typename InputIt, typename OutputIt, typename Pred>
+OutputIt fast_remove_copy_if(InputIt first, InputIt last, OutputIt out, Pred pred){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<InputIt>){
+        constexpr std::size_t block = 4096;
+        std::vector<T> kept(block);
+        for(std::size_t i = 0, n = last - first; i < n; i += block){
+            const std::size_t t = compact_compress(&first[i], std::min(block, n - i), pred, kept.data());
+            out = std::copy(kept.begin(), kept.begin() + t, out);
+        }
+        return out;
+    }
+    else return std::remove_copy_if(first, last, out, pred);
+}
+
+template<typename InputIt, typename OutputIt, typename U>
+OutputIt fast_remove_copy(InputIt first, InputIt last, OutputIt out, const U& value){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    if constexpr (is_simd_numeric_v<T> && std::is_arithmetic_v<U>)
+        if(static_cast<U>(static_cast<T>(value)) == value)
+            return fast_remove_copy_if(first, last, out, value_predicate<T>{compare_op::equal, static_cast<T>(value)});
+    return fast_remove_copy_if(first, last, out, [&](const T& x){ return x == value; });
+}
+
+// pred has to be an equivalence relation, as for std::unique. The default equality is vectorized.
+template<typename ForwardIt, typename BinaryPred = std::equal_to<>>
+ForwardIt fast_unique(ForwardIt first, ForwardIt last, BinaryPred pred = BinaryPred()){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<ForwardIt>){
+        if(first == last) return last;
+        T* data = &*first;
+        adjacent_equal<BinaryPred> duplicate{pred};
+        return first + compact_compress(data, last - first, duplicate, data);
+    }
+    else return std::unique(first, last, pred);
+}
+
+// Every block after the first is compacted together with the element before it, which always comes out first and is
+// skipped
+template<typename InputIt, typename OutputIt, typename BinaryPred = std::equal_to<>>
+OutputIt fast_unique_copy(InputIt first, InputIt last, OutputIt out, BinaryPred pred = BinaryPred()){
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    if constexpr (std::is_arithmetic_v<T> && is_contiguous_iterator_v<InputIt>){
+        constexpr std::size_t block = 4096;
+        std::vector<T> kept(block + 1);
+        adjacent_equal<BinaryPred> duplicate{pred};
+        for(std::size_t i = 0, n = last - first; i < n; i += block){
+            const std::size_t before = i == 0 ? 0 : 1;
+            const std::size_t t = compact_compress(&first[i - before], std::min(block, n - i) + before, duplicate, kept.data());
+            out = std::copy(kept.begin() + before, kept.begin() + t, out);
+        }
+        return out;
+    }
+    else return std::unique_copy(first, last, out, pred);
+}
+
+// Moves the kept slices [begin, end) of the chunks (offsets from first, in chunk order, each inside its own chunk)
+// together at first and returns the new end. The slices before the first one that has to move stay; the rest are moved
+// in parallel to a buffer at their offsets from the prefix sums of the kept counts, and the buffer is moved back in
+// parallel - two passes whatever the drop fraction, with a buffer the size of the kept elements behind the first gap.
+template<typename RandomIt>
+RandomIt par_compact_slices(RandomIt first, const std::vector<std::pair<std::size_t, std::size_t>>& slices){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    std::vector<std::size_t> dest(slices.size() + 1, 0);
+    for(std::size_t c = 0; c < slices.size(); ++c) dest[c + 1] = dest[c] + (slices[c].second - slices[c].first);
+
+    std::size_t moving = 0;
+    while(moving < slices.size() && (slices[moving].first == dest[moving] || slices[moving].first == slices[moving].second))
+        ++moving;
+    if(moving == slices.size()) return first + dest.back();
+
+    const std::size_t base = dest[moving];
+    std::vector<T> buffer(dest.back() - base);
+    default_thread_pool().parallel_for(slices.size() - moving, [&](std::size_t i){
+        const std::size_t c = moving + i;
+        std::move(first + slices[c].first, first + slices[c].second, buffer.begin() + (dest[c] - base));
+    });
+    parallel_chunks<T>(buffer.size(), [&](std::size_t, std::size_t begin, std::size_t end){
+        std::move(buffer.begin() + begin, buffer.begin() + end, first + base + begin);
+    });
+    return first + dest.back();
+}
+
+// par_remove_if - chunks are compacted in parallel, then their kept slices are moved together
+template<typename RandomIt, typename Pred>
+RandomIt par_remove_if(RandomIt first, RandomIt last, Pred pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if(n < (1 << 15) || default_thread_pool().size() == 1) return fast_remove_if(first, last, pred);
+
+    std::vector<std::pair<std::size_t, std::size_t>> slices((n + parallel_chunk_elements<T>() - 1) / parallel_chunk_elements<T>());
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        slices[c] = {begin, static_cast<std::size_t>(fast_remove_if(first + begin, first + end, pred) - first)};
+    });
+    return par_compact_slices(first, slices);
+}
+
+// First position of chunk [begin, end) whose element starts a new group, i.e. past the run continuing the chunk before
+template<typename RandomIt, typename BinaryPred>
+std::size_t unique_chunk_start(RandomIt first, std::size_t begin, std::size_t end, BinaryPred& pred){
+    if(begin == 0) return 0;
+    while(begin < end && pred(first[begin - 1], first[begin])) ++begin;
+    return begin;
+}
+
+// par_unique - the start of every chunk is found before any chunk changes, then as par_remove_if
+template<typename RandomIt, typename BinaryPred = std::equal_to<>>
+RandomIt par_unique(RandomIt first, RandomIt last, BinaryPred pred = BinaryPred()){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if(n < (1 << 15) || default_thread_pool().size() == 1) return fast_unique(first, last, pred);
+
+    std::vector<std::pair<std::size_t, std::size_t>> slices((n + parallel_chunk_elements<T>() - 1) / parallel_chunk_elements<T>());
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        slices[c].first = unique_chunk_start(first, begin, end, pred);
+    });
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t, std::size_t end){
+        slices[c].second = fast_unique(first + slices[c].first, first + end, pred) - first;
+    });
+    return par_compact_slices(first, slices);
+}
+
+// par_remove_copy_if - counts the kept elements of every chunk, then every chunk writes its share of the output at the
+// offset given by the counts of the chunks before it. pred is called twice per element.
+template<typename RandomIt, typename OutputIt, typename Pred>
+OutputIt par_remove_copy_if(RandomIt first, RandomIt last, OutputIt out, Pred pred){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if constexpr (is_random_access_iterator_v<OutputIt>){
+        if(n >= (1 << 15) && default_thread_pool().size() > 1){
+            std::vector<std::size_t> offset((n + parallel_chunk_elements<T>() - 1) / parallel_chunk_elements<T>() + 1, 0);
+            parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+                offset[c + 1] = compact_count(first + begin, first + end, pred);
+            });
+            std::partial_sum(offset.begin(), offset.end(), offset.begin());
+            parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+                fast_remove_copy_if(first + begin, first + end, out + offset[c], pred);
+            });
+            return out + offset.back();
+        }
+    }
+    return fast_remove_copy_if(first, last, out, pred);
+}
+
+template<typename RandomIt, typename OutputIt, typename BinaryPred = std::equal_to<>>
+OutputIt par_unique_copy(RandomIt first, RandomIt last, OutputIt out, BinaryPred pred = BinaryPred()){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if constexpr (is_random_access_iterator_v<OutputIt>){
+        if(n >= (1 << 15) && default_thread_pool().size() > 1){
+            const std::size_t chunks = (n + parallel_chunk_elements<T>() - 1) / parallel_chunk_elements<T>();
+            std::vector<std::size_t> start(chunks), offset(chunks + 1, 0);
+            adjacent_equal<BinaryPred> duplicate{pred};
+            parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+                start[c] = unique_chunk_start(first, begin, end, pred);
+                offset[c + 1] = compact_count(first + start[c], first + end, duplicate);
+            });
+            std::partial_sum(offset.begin(), offset.end(), offset.begin());
+            parallel_chunks<T>(n, [&](std::size_t c, std::size_t, std::size_t end){
+                fast_unique_copy(first + start[c], first + end, out + offset[c], pred);
+            });
+            return out + offset.back();
+        }
+    }
+    return fast_unique_copy(first, last, out, pred);
+}
+
+// Open addressing set of element positions in the SwissTable layout: every slot has a control byte holding 7 bits of its
+// hash (or "empty"), and a probe compares the control bytes of a group of 16 slots with the wanted 7 bits in one SSE2
+// compare, so an element is only compared with the slots whose bits match - about one in a hundred of the others. Groups
+// are probed in triangular steps and the table doubles when 7/8 full. Slots keep the full hash, so growing does not hash
+// elements again. Hashes are scrambled with a Fibonacci multiplier, whose top bits pick the group, folded into the low
+// bits that become the control bits: std::hash of an integer is usually the integer itself, which would put runs of keys
+// into runs of slots.
+class position_set {
+public:
+    static constexpr std::size_t npos = std::size_t(-1);
+    static constexpr std::size_t group_width = 16;
+
+    static std::uint64_t scramble(std::uint64_t hash){
+        hash *= 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 32);
+    }
+
+    // Room for n positions without growing
+    void reserve(std::size_t n){
+        while(n * 8 > slots.size() * 7) grow();
+    }
+
+    std::size_t size() const { return count; }
+
+    // Inserts pos unless is_equal(p) holds for a position p already in the set. Returns p, or pos if it was inserted.
+    template<typename Equal>
+    std::size_t insert(std::uint64_t hash, std::size_t pos, Equal is_equal){
+        hash = scramble(hash);
+        std::size_t empty_slot = 0;
+        const std::size_t found = locate(hash, is_equal, empty_slot);
+        if(found != npos) return found;
+        if((count + 1) * 8 > slots.size() * 7){
+            grow();
+            empty_slot = first_empty(hash);
+        }
+        place(empty_slot, hash, pos);
+        ++count;
+        return pos;
+    }
+
+    // Position p in the set with is_equal(p), npos if there is none
+    template<typename Equal>
+    std::size_t find(std::uint64_t hash, Equal is_equal) const {
+        std::size_t empty_slot = 0;
+        return locate(scramble(hash), is_equal, empty_slot);
+    }
+
+private:
+    struct slot { std::uint64_t hash; std::size_t pos; };
+    static constexpr std::int8_t empty = -128;
+
+    // Bit j set = control byte j of the group at i equals tag
+#if STL_HAS_SIMD
+    using group = __m128i;
+    group load_group(std::size_t i) const { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(&control[i])); }
+    static std::uint32_t group_match(group g, std::int8_t tag){
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(tag))));
+    }
+#else
+    using group = const std::int8_t*;
+    group load_group(std::size_t i) const { return &control[i]; }
+    static std::uint32_t group_match(group g, std::int8_t tag){
+        std::uint32_t mask = 0;
+        for(std::size_t j = 0; j < group_width; ++j) mask |= std::uint32_t(g[j] == tag) << j;
+        return mask;
+    }
+#endif
+
+    // The matching position, or npos and the first empty slot on the probe sequence of hash
+    template<typename Equal>
+    std::size_t locate(std::uint64_t hash, Equal& is_equal, std::size_t& empty_slot) const {
+        const std::int8_t tag = static_cast<std::int8_t>(hash & 0x7f);
+        const std::size_t mask = slots.size() - 1;
+        for(std::size_t i = hash >> shift, step = group_width;; i = (i + step) & mask, step += group_width){
+            const group g = load_group(i);
+            for(std::uint32_t m = group_match(g, tag); m != 0; m &= m - 1){
+                const slot& s = slots[(i + __builtin_ctz(m)) & mask];
+                if(s.hash == hash && is_equal(s.pos)) return s.pos;
+            }
+            if(const std::uint32_t m = group_match(g, empty)){
+                empty_slot = (i + __builtin_ctz(m)) & mask;
+                return npos;
+            }
+        }
+    }
+
+    std::size_t first_empty(std::uint64_t hash) const {
+        const std::size_t mask = slots.size() - 1;
+        for(std::size_t i = hash >> shift, step = group_width;; i = (i + step) & mask, step += group_width)
+            if(const std::uint32_t m = group_match(load_group(i), empty)) return (i + __builtin_ctz(m)) & mask;
+    }
+
+    // The first group_width control bytes are repeated after the last slot, so a group can start at any slot
+    void place(std::size_t i, std::uint64_t hash, std::size_t pos){
+        const std::int8_t tag = static_cast<std::int8_t>(hash & 0x7f);
+        control[i] = tag;
+        if(i < group_width) control[slots.size() + i] = tag;
+        slots[i] = {hash, pos};
+    }
+
+    void grow(){
+        std::vector<slot> old(slots.size() * 2);
+        old.swap(slots);
+        std::vector<std::int8_t> old_control(slots.size() + group_width, empty);
+        old_control.swap(control);
+        --shift;
+        for(std::size_t i = 0; i < old.size(); ++i)
+            if(old_control[i] != empty) place(first_empty(old[i].hash), old[i].hash, old[i].pos);
+    }
+
+    std::vector<slot> slots = std::vector<slot>(group_width);
+    std::vector<std::int8_t> control = std::vector<std::int8_t>(2 * group_width, empty);
+    std::size_t count = 0;
+    unsigned shift = 60;                            // 64 - log2(slots.size())
+};
+
+// hash_unique - removes every element equal to an earlier one, sorted or not, in one pass. The kept elements stay in
+// input order. Extra memory is proportional to the number of distinct elements.
+template<typename RandomIt, typename Hash = std::hash<typename std::iterator_traits<RandomIt>::value_type>,
+         typename KeyEqual = std::equal_to<>>
+RandomIt hash_unique(RandomIt first, RandomIt last, Hash hash = Hash(), KeyEqual eq = KeyEqual()){
+    position_set seen;
+    RandomIt out = first;
+    for(RandomIt it = first; it != last; ++it){
+        const std::size_t pos = out - first;
+        if(seen.insert(hash(*it), pos, [&](std::size_t p){ return eq(first[p], *it); }) != pos) continue;
+        if(out != it) *out = std::move(*it);
+        ++out;
+    }
+    return out;
+}
+
+// Keeps a copy of every distinct element, as the output cannot be read back
+template<typename InputIt, typename OutputIt, typename Hash = std::hash<typename std::iterator_traits<InputIt>::value_type>,
+         typename KeyEqual = std::equal_to<>>
+OutputIt hash_unique_copy(InputIt first, InputIt last, OutputIt out, Hash hash = Hash(), KeyEqual eq = KeyEqual()){
+    std::vector<typename std::iterator_traits<InputIt>::value_type> values;
+    position_set seen;
+    for(; first != last; ++first){
+        if(seen.insert(hash(*first), values.size(), [&](std::size_t p){ return eq(values[p], *first); }) != values.size()) continue;
+        values.push_back(*first);
+        *out++ = values.back();
+    }
+    return out;
+}
+
+// Container forms of the erase-remove idiom, like C++20 std::erase_if. Return the number of elements erased.
+template<typename Container, typename Pred>
+typename Container::size_type fast_erase_if(Container& c, Pred pred){
+    auto it = fast_remove_if(c.begin(), c.end(), pred);
+    const auto erased = static_cast<typename Container::size_type>(std::distance(it, c.end()));
+    c.erase(it, c.end());
+    return erased;
+}
+
+template<typename Container, typename Pred>
+typename Container::size_type par_erase_if(Container& c, Pred pred){
+    auto it = par_remove_if(c.begin(), c.end(), pred);
+    const auto erased = static_cast<typename Container::size_type>(std::distance(it, c.end()));
+    c.erase(it, c.end());
+    return erased;
+}
+
+// Erases consecutive duplicates, all duplicates once c is sorted
+template<typename Container>
+typename Container::size_type par_erase_unique(Container& c){
+    auto it = par_unique(c.begin(), c.end());
+    const auto erased = static_cast<typename Container::size_type>(std::distance(it, c.end()));
+    c.erase(it, c.end());
+    return erased;
+}
+
+template<typename Container>
+typename Container::size_type hash_erase_duplicates(Container& c){
+    auto it = hash_unique(c.begin(), c.end());
+    const auto erased = static_cast<typename Container::size_type>(std::distance(it, c.end()));
+    c.erase(it, c.end());
+    return erased;
+}
+
+// Selection - floyd_rivest_select, par_nth_element, nth_elements, quantiles, top_k, fast_partial_sort_copy
+// floyd_rivest_select has the contract of std::nth_element. Before partitioning a large range it recursively selects
+// in a small sample around the expected position of nth, so the pivot is almost exactly the nth element and the range
+// shrinks to a few sqrt(n) elements after one partition. If that goes wrong too often it finishes with
+// std::nth_element (introselect). par_nth_element brackets nth between two elements of a random sample, keeps the few
+// percent of the range between them with two par_partition passes and selects in that part only.
+
+template<typename RandomIt, typename Compare>
+void floyd_rivest_select_range(RandomIt a, std::ptrdiff_t left, std::ptrdiff_t right, std::ptrdiff_t k, Compare& comp, int budget){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    while(right > left){
+        if(--budget < 0){
+            std::nth_element(a + left, a + k, a + right + 1, comp);
+            return;
+        }
+        if(right - left > 600){
+            // Select in a sample of n^(2/3) elements whose expected rank range brackets k
+            const double n = right - left + 1, i = k - left + 1, z = std::log(n);
+            const double s = 0.5 * std::exp(2 * z / 3);
+            const double sd = 0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+            const std::ptrdiff_t sample_left = std::max(left, static_cast<std::ptrdiff_t>(k - i * s / n + sd));
+            const std::ptrdiff_t sample_right = std::min(right, static_cast<std::ptrdiff_t>(k + (n - i) * s / n + sd));
+            floyd_rivest_select_range(a, sample_left, sample_right, k, comp, budget);
+        }
+        // Hoare partition around a[k]; a[left] and a[right] end up as sentinels for the two scans
+        const T t = a[k];
+        std::ptrdiff_t i = left, j = right;
+        std::iter_swap(a + left, a + k);
+        if(comp(t, a[right])) std::iter_swap(a + right, a + left);
+        while(i < j){
+            std::iter_swap(a + i, a + j);
+            ++i;
+            --j;
+            while(comp(a[i], t)) ++i;
+            while(comp(t, a[j])) --j;
+        }
+        if(!comp(a[left], t) && !comp(t, a[left])) std::iter_swap(a + left, a + j);
+        else {
+            ++j;
+            std::iter_swap(a + j, a + right);
+        }
+        if(j <= k) left = j + 1;
+        if(k <= j) right = j - 1;
+    }
+}
+
+template<typename RandomIt, typename Compare = std::less<>>
+void floyd_rivest_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp = Compare()){
+    const std::ptrdiff_t n = last - first;
+    if(n <= 1 || nth == last) return;
+    int budget = 8;
+    for(std::ptrdiff_t size = n; size > 1; size >>= 1) budget += 2;
+    floyd_rivest_select_range(first, 0, n - 1, nth - first, comp, budget);
+}
+
+template<typename RandomIt, typename Compare = std::less<>>
+void par_nth_element(RandomIt first, RandomIt nth, RandomIt last, Compare comp = Compare()){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    thread_pool& pool = default_thread_pool();
+    while(nth != last){
+        const std::size_t n = last - first;
+        if(n < (1 << 17) || pool.size() == 1) return floyd_rivest_select(first, nth, last, comp);
+
+        // nth lies between sample ranks r - d and r + d with overwhelming probability
+        constexpr std::size_t m = 1 << 14, d = 256;
+        std::vector<T> sample;
+        sample.reserve(m);
+        std::mt19937_64 rng(n);
+        for(std::size_t i = 0; i < m; ++i) sample.push_back(first[rng() % n]);
+        std::sort(sample.begin(), sample.end(), comp);
+        const std::size_t r = static_cast<std::size_t>(nth - first) * m / n;
+        const T lo = sample[r > d ? r - d : 0];
+        const T hi = sample[std::min(m - 1, r + d)];
+
+        // [first, a) < lo <= [a, b) <= hi < [b, last). Either side is a strictly smaller range to retry on.
+        const RandomIt a = r > d ? par_partition(first, last, [&](const T& x){ return comp(x, lo); }) : first;
+        if(nth < a){
+            last = a;
+            continue;
+        }
+        const RandomIt b = r + d < m ? par_partition(a, last, [&](const T& x){ return !comp(hi, x); }) : last;
+        if(nth >= b){
+            first = b;
+            continue;
+        }
+        return floyd_rivest_select(a, nth, b, comp);
+    }
+}
+
+// nth_element for many positions in one pass: afterwards first[r] is the element a full sort would put there, for every
+// rank r in [ranks_first, ranks_last), and the range is partitioned around each of them. The middle rank is selected
+// first and splits both the range and the ranks, so m ranks cost about n log m comparisons instead of m * n.
+template<typename RandomIt, typename RankIt, typename Compare = std::less<>>
+void nth_elements(RandomIt first, RandomIt last, RankIt ranks_first, RankIt ranks_last, Compare comp = Compare()){
+    std::vector<std::size_t> ranks(ranks_first, ranks_last);
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    ranks.erase(std::lower_bound(ranks.begin(), ranks.end(), static_cast<std::size_t>(last - first)), ranks.end());
+
+    struct part { std::size_t begin, end, rank_begin, rank_end; };
+    std::vector<part> todo = {{0, static_cast<std::size_t>(last - first), 0, ranks.size()}};
+    while(!todo.empty()){
+        const part p = todo.back();
+        todo.pop_back();
+        if(p.rank_begin == p.rank_end) continue;
+        const std::size_t mid = p.rank_begin + (p.rank_end - p.rank_begin) / 2, r = ranks[mid];
+        par_nth_element(first + p.begin, first + r, first + p.end, comp);
+        todo.push_back({p.begin, r, p.rank_begin, mid});
+        todo.push_back({r + 1, p.end, mid + 1, p.rank_end});
+    }
+}
+
+// Nearest-rank quantiles: for every q in [q_first, q_last) writes the element of rank ceil(q * n) - 1 to out (q = 0.5,
+// 0.99, 0.999 for p50 / p99 / p999). Reorders the range like nth_elements.
+template<typename RandomIt, typename QuantileIt, typename OutputIt, typename Compare = std::less<>>
+OutputIt quantiles(RandomIt first, RandomIt last, QuantileIt q_first, QuantileIt q_last, OutputIt out, Compare comp = Compare()){
+    const std::size_t n = last - first;
+    if(n == 0) return out;
+    std::vector<std::size_t> ranks;
+    for(QuantileIt q = q_first; q != q_last; ++q){
+        const double rank = std::ceil(*q * static_cast<double>(n)) - 1;
+        ranks.push_back(rank <= 0 ? 0 : std::min(n - 1, static_cast<std::size_t>(rank)));
+    }
+    nth_elements(first, last, ranks.begin(), ranks.end(), comp);
+    for(std::size_t rank : ranks) *out++ = first[rank];
+    return out;
+}
+
+// top_k - the k first elements in Compare order (smallest for std::less, largest for std::greater) of a stream of any
+// length, in memory for 2k elements. Pushes go to a buffer; when it is full it is cut back to the best k with
+// floyd_rivest_select, and the kth element becomes a threshold that rejects most later pushes with one comparison.
+template<typename T, typename Compare = std::less<T>>
+class top_k {
+public:
+    explicit top_k(std::size_t k, Compare comp = Compare()) : k(k), comp(comp) { buffer.reserve(2 * k); }
+
+    void push(T value){
+        if(k == 0 || (has_threshold && !comp(value, threshold))) return;
+        buffer.push_back(std::move(value));
+        if(buffer.size() == 2 * k) shrink();
+    }
+
+    template<typename InputIt>
+    void push(InputIt first, InputIt last){
+        for(; first != last; ++first) push(*first);
+    }
+
+    std::size_t size() const { return std::min(k, buffer.size()); }
+
+    // The current top k, in Compare order
+    const std::vector<T>& sorted(){
+        if(buffer.size() > k) shrink();
+        std::sort(buffer.begin(), buffer.end(), comp);
+        return buffer;
+    }
+
+private:
+    void shrink(){
+        floyd_rivest_select(buffer.begin(), buffer.begin() + (k - 1), buffer.end(), comp);
+        buffer.erase(buffer.begin() + k, buffer.end());
+        threshold = buffer[k - 1];
+        has_threshold = true;
+    }
+
+    std::size_t k;
+    Compare comp;
+    std::vector<T> buffer;
+    T threshold{};
+    bool has_threshold = false;
+};
+
+// partial_sort_copy through top_k: std::partial_sort_copy keeps a heap of d_last - d_first elements and pays log k
+// for most input elements, top_k rejects them with one comparison once the threshold is set
+template<typename InputIt, typename RandomIt, typename Compare = std::less<>>
+RandomIt fast_partial_sort_copy(InputIt first, InputIt last, RandomIt d_first, RandomIt d_last, Compare comp = Compare()){
+    top_k<typename std::iterator_traits<InputIt>::value_type, Compare> best(d_last - d_first, comp);
+    best.push(first, last);
+    const auto& sorted = best.sorted();
+    return std::copy(sorted.begin(), sorted.end(), d_first);
+}
+
+// Arena allocation - arena, arena_allocator, thread_arena, reserve_back_inserter
+// An arena hands out memory by bumping a pointer through large blocks and frees nothing before release() or its
+// destruction, so a std::set filled through std::inserter costs no malloc per node, and freeing it is one pass over the
+// blocks. arena is a std::pmr::memory_resource (std::pmr::set<int> s(&arena)), and arena_allocator<T> uses the same
+// arena without a virtual call per allocation. An arena is not thread safe: give every thread or task its own one, e.g.
+// thread_arena(), which also keeps threads from contending on the locks of the global heap.
+class arena : public std::pmr::memory_resource {
+public:
+    explicit arena(std::size_t block_bytes = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : next_block_bytes(block_bytes), upstream(upstream) {}
+
+    // Starts in buffer (e.g. on the stack) and only goes to upstream once it is full
+    arena(void* buffer, std::size_t bytes, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : current(static_cast<char*>(buffer)), limit(static_cast<char*>(buffer) + bytes),
+          initial(static_cast<char*>(buffer)), initial_bytes(bytes), next_block_bytes(std::max<std::size_t>(bytes, 4096)),
+          upstream(upstream) {}
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+    ~arena() override { release(); }
+
+    void* bump(std::size_t bytes, std::size_t alignment){
+        const std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(current) + alignment - 1) & ~(alignment - 1);
+        if(current != nullptr && p + bytes <= reinterpret_cast<std::uintptr_t>(limit)){
+            current = reinterpret_cast<char*>(p + bytes);
+            used += bytes;
+            return reinterpret_cast<void*>(p);
+        }
+        return bump_new_block(bytes, alignment);
+    }
+
+    // Returns every block to upstream and starts over; everything allocated from the arena is gone
+    void release(){
+        while(blocks != nullptr){
+            block* next = blocks->next;
+            upstream->deallocate(blocks, blocks->bytes, alignof(std::max_align_t));
+            blocks = next;
+        }
+        current = initial;
+        limit = initial + initial_bytes;
+        used = 0;
+    }
+
+    // Bytes handed out since the last release()
+    std::size_t bytes_used() const { return used; }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override { return bump(bytes, alignment); }
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct block {
+        block* next;
+        std::size_t bytes;
+    };
+
+    // Blocks double up to 16 MiB, so the number of upstream calls grows with log(size)
+    void* bump_new_block(std::size_t bytes, std::size_t alignment){
+        const std::size_t needed = sizeof(block) + bytes + alignment;
+        const std::size_t size = std::max(next_block_bytes, needed);
+        next_block_bytes = std::min<std::size_t>(next_block_bytes * 2, std::max<std::size_t>(next_block_bytes, 16 << 20));
+        block* b = static_cast<block*>(upstream->allocate(size, alignof(std::max_align_t)));
+        b->next = blocks;
+        b->bytes = size;
+        blocks = b;
+        current = reinterpret_cast<char*>(b + 1);
+        limit = reinterpret_cast<char*>(b) + size;
+        return bump(bytes, alignment);
+    }
+
+    char* current = nullptr;
+    char* limit = nullptr;
+    char* initial = nullptr;
+    std::size_t initial_bytes = 0;
+    std::size_t next_block_bytes;
+    std::size_t used = 0;
+    block* blocks = nullptr;
+    std::pmr::memory_resource* upstream;
+};
+
+// Allocator drawing from an arena; deallocate does nothing, the memory comes back with the arena's release()
+template<typename T>
+struct arena_allocator {
+    using value_type = T;
+
+    arena_allocator(arena& source) : source(&source) {}
+    template<typename U> arena_allocator(const arena_allocator<U>& other) : source(other.source) {}
+
+    T* allocate(std::size_t n){
+        if(n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(source->bump(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, std::size_t){}
+
+    template<typename U> bool operator==(const arena_allocator<U>& other) const { return source == other.source; }
+    template<typename U> bool operator!=(const arena_allocator<U>& other) const { return source != other.source; }
+
+    arena* source;
+};
+
+// One arena per thread. Nothing is returned before thread_arena().release(), e.g. at the end of every request.
+arena& thread_arena(){
+    static thread_local arena per_thread;
+    return per_thread;
+}
+
+// Number of elements in [first, last) if it can be counted without consuming it, 0 for single pass input iterators.
+// An exact size for copy / move / transform / merge, an upper bound for remove_copy / unique_copy / copy_if.
+template<typename InputIt>
+std::size_t output_size_bound(InputIt first, InputIt last){
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+        return std::distance(first, last);
+    else
+        return 0;
+}
+
+// Upper bound of set_union / set_symmetric_difference / merge of two ranges (set_intersection and set_difference
+// write at most the smaller / first one, pass that to reserve_back_inserter directly)
+template<typename InputIt1, typename InputIt2>
+std::size_t output_size_bound(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2){
+    return output_size_bound(first1, last1) + output_size_bound(first2, last2);
+}
+
+// std::back_inserter that first reserves room for n more elements, so the algorithm writing through it never
+// reallocates (one allocation instead of log2(n) of them, and no element is moved)
+template<typename Container>
+std::back_insert_iterator<Container> reserve_back_inserter(Container& c, std::size_t n){
+    c.reserve(c.size() + n);
+    return std::back_inserter(c);
+}
+
+template<typename Container, typename InputIt>
+std::back_insert_iterator<Container> reserve_back_inserter(Container& c, InputIt first, InputIt last){
+    return reserve_back_inserter(c, output_size_bound(first, last));
+}
+
+template<typename Container, typename InputIt1, typename InputIt2>
+std::back_insert_iterator<Container> reserve_back_inserter(Container& c, InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2){
+    return reserve_back_inserter(c, output_size_bound(first1, last1, first2, last2));
+}
+
+// Raw memory - par_uninitialized_copy / move / fill / default_construct / value_construct, par_destroy, the _n forms,
+// stream_copy_bytes, stream_fill and default_init_allocator
+// Same contracts as the std::uninitialized_ algorithms, for random access ranges. Trivially copyable elements become
+// memcpy / fill. When the destination is larger than the caches, stream_ versions store with non-temporal instructions,
+// which write whole lines without first reading them into cache. Large ranges are split into parallel chunks, which
+// also spreads the page faults of a freshly allocated buffer over the threads. If an element constructor throws, every
+// chunk already built is destroyed again before the first exception is rethrown, so the destination holds no objects.
+
+// Destinations from this size on are written with non-temporal stores
+constexpr std::size_t streaming_store_bytes = 8 << 20;
+
+#if STL_HAS_SIMD
+// dst aligned to the vector size, bytes a multiple of it
+STL_AVX2_TARGET inline void stream_copy_avx2(char* dst, const char* src, std::size_t bytes){
+    for(std::size_t i = 0; i < bytes; i += 32)
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+    _mm_sfence();
+}
+STL_AVX512_TARGET inline void stream_copy_avx512(char* dst, const char* src, std::size_t bytes){
+    for(std::size_t i = 0; i < bytes; i += 64) _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), _mm512_loadu_si512(src + i));
+    _mm_sfence();
+}
+// pattern holds one vector of the repeated value
+STL_AVX2_TARGET inline void stream_fill_avx2(char* dst, const char* pattern, std::size_t bytes){
+    const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern));
+    for(std::size_t i = 0; i < bytes; i += 32) _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), p);
+    _mm_sfence();
+}
+STL_AVX512_TARGET inline void stream_fill_avx512(char* dst, const char* pattern, std::size_t bytes){
+    const __m512i p = _mm512_loadu_si512(pattern);
+    for(std::size_t i = 0; i < bytes; i += 64) _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), p);
+    _mm_sfence();
+}
+
+// Vector size of the non-temporal kernels on this CPU, 0 without any
+inline std::size_t stream_vector_bytes(){
+    switch(detect_simd_isa()){
+        case simd_isa::avx512: return 64;
+        case simd_isa::avx2:   return 32;
+        case simd_isa::scalar: break;
+    }
+    return 0;
+}
+#endif
+
+// memcpy with non-temporal stores: the head up to the first aligned address and the tail are copied normally
+inline void stream_copy_bytes(void* dst, const void* src, std::size_t bytes){
+    char* d = static_cast<char*>(dst);
+    const char* s = static_cast<const char*>(src);
+#if STL_HAS_SIMD
+    const std::size_t vec = stream_vector_bytes();
+    if(vec != 0 && bytes >= 4 * vec){
+        const std::size_t head = (vec - reinterpret_cast<std::uintptr_t>(d) % vec) % vec;
+        std::memcpy(d, s, head);
+        const std::size_t body = (bytes - head) / vec * vec;
+        if(vec == 64) stream_copy_avx512(d + head, s + head, body);
+        else          stream_copy_avx2(d + head, s + head, body);
+        std::memcpy(d + head + body, s + head + body, bytes - head - body);
+        return;
+    }
+#endif
+    std::memcpy(d, s, bytes);
+}
+
+// std::fill of a trivially copyable T with non-temporal stores. Needs a power of two sizeof(T) up to 64 and dst aligned
+// to it, so that every aligned vector starts at an element boundary; other types use std::fill.
+template<typename T>
+void stream_fill(T* dst, std::size_t count, const T& value){
+    static_assert(std::is_trivially_copyable_v<T>, "stream_fill writes the bytes of value");
+#if STL_HAS_SIMD
+    const std::size_t vec = stream_vector_bytes();
+    constexpr bool whole_elements = sizeof(T) <= 64 && (sizeof(T) & (sizeof(T) - 1)) == 0;
+    if(whole_elements && vec != 0 && count * sizeof(T) >= 4 * vec && reinterpret_cast<std::uintptr_t>(dst) % sizeof(T) == 0){
+        const std::size_t head = (vec - reinterpret_cast<std::uintptr_t>(dst) % vec) % vec / sizeof(T);
+        std::fill(dst, dst + head, value);
+        alignas(64) char pattern[64];
+        for(std::size_t b = 0; b < vec; b += sizeof(T)) std::memcpy(pattern + b, &value, sizeof(T));
+        const std::size_t body = (count - head) * sizeof(T) / vec * vec;
+        char* start = reinterpret_cast<char*>(dst + head);
+        if(vec == 64) stream_fill_avx512(start, pattern, body);
+        else          stream_fill_avx2(start, pattern, body);
+        std::fill(dst + head + body / sizeof(T), dst + count, value);
+        return;
+    }
+#endif
+    std::fill(dst, dst + count, value);
+}
+
+// Runs construct(begin, end) on parallel chunks of the n destination elements. If chunks throw, the ones that
+// completed are destroyed (a throwing std::uninitialized_ call has already cleaned up its own chunk) and the first
+// exception is rethrown.
+template<typename T, typename ForwardIt, typename Construct>
+void par_construct_chunks(ForwardIt d_first, std::size_t n, Construct construct){
+    const std::size_t chunk = parallel_chunk_elements<T>();
+    std::vector<char> built((n + chunk - 1) / chunk, 0);
+    try {
+        parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+            construct(begin, end);
+            built[c] = 1;
+        });
+    }
+    catch(...){
+        parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+            if(built[c]) std::destroy(d_first + begin, d_first + end);
+        });
+        throw;
+    }
+}
+
+template<typename InputIt, typename ForwardIt>
+ForwardIt par_uninitialized_copy(InputIt first, InputIt last, ForwardIt d_first){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (is_random_access_iterator_v<InputIt> && is_random_access_iterator_v<ForwardIt>){
+        const std::size_t n = last - first;
+        if constexpr (std::is_trivially_copyable_v<T> && std::is_same_v<T, typename std::iterator_traits<InputIt>::value_type> &&
+                      is_contiguous_iterator_v<InputIt> && is_contiguous_iterator_v<ForwardIt>){
+            if(n == 0) return d_first;
+            const T* src = &*first;
+            T* dst = &*d_first;
+            const bool stream = n * sizeof(T) >= streaming_store_bytes;
+            parallel_chunks<T>(n, [&](std::size_t, std::size_t begin, std::size_t end){
+                if(stream) stream_copy_bytes(dst + begin, src + begin, (end - begin) * sizeof(T));
+                else       std::memcpy(dst + begin, src + begin, (end - begin) * sizeof(T));
+            });
+        }
+        else {
+            par_construct_chunks<T>(d_first, n, [&](std::size_t begin, std::size_t end){
+                std::uninitialized_copy(first + begin, first + end, d_first + begin);
+            });
+        }
+        return d_first + n;
+    }
+    else return std::uninitialized_copy(first, last, d_first);
+}
+
+template<typename InputIt, typename Size, typename ForwardIt>
+ForwardIt par_uninitialized_copy_n(InputIt first, Size count, ForwardIt d_first){
+    if constexpr (is_random_access_iterator_v<InputIt>) return par_uninitialized_copy(first, first + count, d_first);
+    else return std::uninitialized_copy_n(first, count, d_first);
+}
+
+// Moved-from sources stay moved-from if a constructor throws, as with std::uninitialized_move. Moving a trivially
+// copyable element is a copy, which keeps the memcpy path.
+template<typename InputIt, typename ForwardIt>
+ForwardIt par_uninitialized_move(InputIt first, InputIt last, ForwardIt d_first){
+    if constexpr (std::is_trivially_copyable_v<typename std::iterator_traits<InputIt>::value_type>)
+        return par_uninitialized_copy(first, last, d_first);
+    else
+        return par_uninitialized_copy(std::make_move_iterator(first), std::make_move_iterator(last), d_first);
+}
+
+template<typename InputIt, typename Size, typename ForwardIt>
+std::pair<InputIt, ForwardIt> par_uninitialized_move_n(InputIt first, Size count, ForwardIt d_first){
+    if constexpr (is_random_access_iterator_v<InputIt>) return {first + count, par_uninitialized_move(first, first + count, d_first)};
+    else return std::uninitialized_move_n(first, count, d_first);
+}
+
+template<typename ForwardIt, typename T>
+void par_uninitialized_fill(ForwardIt first, ForwardIt last, const T& value){
+    using V = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (is_random_access_iterator_v<ForwardIt>){
+        const std::size_t n = last - first;
+        if constexpr (std::is_trivially_copyable_v<V> && is_contiguous_iterator_v<ForwardIt>){
+            if(n == 0) return;
+            const V v = value;
+            V* dst = &*first;
+            const bool stream = n * sizeof(V) >= streaming_store_bytes;
+            parallel_chunks<V>(n, [&](std::size_t, std::size_t begin, std::size_t end){
+                if(stream) stream_fill(dst + begin, end - begin, v);
+                else       std::fill(dst + begin, dst + end, v);
+            });
+        }
+        else {
+            par_construct_chunks<V>(first, n, [&](std::size_t begin, std::size_t end){
+                std::uninitialized_fill(first + begin, first + end, value);
+            });
+        }
+    }
+    else std::uninitialized_fill(first, last, value);
+}
+
+template<typename ForwardIt, typename Size, typename T>
+ForwardIt par_uninitialized_fill_n(ForwardIt first, Size count, const T& value){
+    if constexpr (is_random_access_iterator_v<ForwardIt>){
+        par_uninitialized_fill(first, first + count, value);
+        return first + count;
+    }
+    else return std::uninitialized_fill_n(first, count, value);
+}
+
+// Trivial types are left as they are, no memory is touched
+template<typename ForwardIt>
+void par_uninitialized_default_construct(ForwardIt first, ForwardIt last){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (std::is_trivially_default_constructible_v<T>) return;
+    else if constexpr (is_random_access_iterator_v<ForwardIt>){
+        par_construct_chunks<T>(first, last - first, [&](std::size_t begin, std::size_t end){
+            std::uninitialized_default_construct(first + begin, first + end);
+        });
+    }
+    else std::uninitialized_default_construct(first, last);
+}
+
+template<typename ForwardIt, typename Size>
+ForwardIt par_uninitialized_default_construct_n(ForwardIt first, Size count){
+    if constexpr (is_random_access_iterator_v<ForwardIt>){
+        par_uninitialized_default_construct(first, first + count);
+        return first + count;
+    }
+    else return std::uninitialized_default_construct_n(first, count);
+}
+
+// Arithmetic, enum and pointer elements are zero bytes once value-initialized, so they are filled with zeroes
+template<typename ForwardIt>
+void par_uninitialized_value_construct(ForwardIt first, ForwardIt last){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr ((std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>) && is_contiguous_iterator_v<ForwardIt>)
+        par_uninitialized_fill(first, last, T());
+    else if constexpr (is_random_access_iterator_v<ForwardIt>){
+        par_construct_chunks<T>(first, last - first, [&](std::size_t begin, std::size_t end){
+            std::uninitialized_value_construct(first + begin, first + end);
+        });
+    }
+    else std::uninitialized_value_construct(first, last);
+}
+
+template<typename ForwardIt, typename Size>
+ForwardIt par_uninitialized_value_construct_n(ForwardIt first, Size count){
+    if constexpr (is_random_access_iterator_v<ForwardIt>){
+        par_uninitialized_value_construct(first, first + count);
+        return first + count;
+    }
+    else return std::uninitialized_value_construct_n(first, count);
+}
+
+template<typename ForwardIt>
+void par_destroy(ForwardIt first, ForwardIt last){
+    using T = typename std::iterator_traits<ForwardIt>::value_type;
+    if constexpr (std::is_trivially_destructible_v<T>) return;
+    else if constexpr (is_random_access_iterator_v<ForwardIt>){
+        parallel_chunks<T>(last - first, [&](std::size_t, std::size_t begin, std::size_t end){
+            std::destroy(first + begin, first + end);
+        });
+    }
+    else std::destroy(first, last);
+}
+
+template<typename ForwardIt, typename Size>
+ForwardIt par_destroy_n(ForwardIt first, Size count){
+    if constexpr (is_random_access_iterator_v<ForwardIt>){
+        par_destroy(first, first + count);
+        return first + count;
+    }
+    else return std::destroy_n(first, count);
+}
+
+// Allocator whose construct() without arguments default-initializes: std::vector<int, default_init_allocator<int>>
+// v(n) and v.resize(n) leave the new ints unwritten instead of zeroing them first
+template<typename T, typename Base = std::allocator<T>>
+struct default_init_allocator : Base {
+    using Base::Base;
+    template<typename U> struct rebind {
+        using other = default_init_allocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+    };
+
+    template<typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>){ ::new(static_cast<void*>(p)) U; }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args){
+        std::allocator_traits<Base>::construct(static_cast<Base&>(*this), p, std::forward<Args>(args)...);
+    }
+};
+
+// Block moves - fast_reverse, par_reverse, fast_swap_ranges, par_swap_ranges, fast_rotate, par_rotate, par_copy,
+// par_copy_backward, par_move, par_move_backward
+// Same contracts as the std:: versions, for random access ranges. Trivially copyable elements are moved as raw bytes:
+// reverse swaps whole vectors from both ends and reverses their lanes in registers, swap_ranges swaps whole vectors.
+// fast_rotate copies the shorter side to a stack buffer when it fits and otherwise shrinks the problem with block swaps
+// (Gries-Mills), which stream through memory instead of following std::rotate's element cycles. The par_ versions run
+// on cache-sized chunks; par_rotate is three par_reverse passes. par_copy / par_move of trivially copyable elements store
+// with non-temporal instructions past streaming_store_bytes, and overlapping source and destination ranges (allowed by
+// memmove, and by std::copy in one direction) are copied in waves no wider than the distance between them.
+
+#if STL_HAS_SIMD
+// Reverses the order of the lanes of v
+template<typename V, std::size_t... I>
+__attribute__((always_inline)) inline void simd_reverse_lanes(V& v, std::index_sequence<I...>){
+    v = __builtin_shufflevector(v, v, (sizeof...(I) - 1 - I)...);
+}
+
+// Swaps lo[j] and hi[-1 - j] for j < count, whole vectors at a time; returns how many were swapped
+template<typename U, std::size_t Bytes>
+__attribute__((always_inline)) inline std::size_t simd_reverse_swap_kernel(char* lo, char* hi, std::size_t count){
+    using V = typename simd_vector<U, Bytes>::type;
+    constexpr std::size_t W = simd_vector<U, Bytes>::lanes;
+    std::size_t i = 0;
+    for(; i + W <= count; i += W){
+        V a, b;
+        __builtin_memcpy(&a, lo + i * sizeof(U), sizeof(V));
+        __builtin_memcpy(&b, hi - (i + W) * sizeof(U), sizeof(V));
+        simd_reverse_lanes(a, std::make_index_sequence<W>());
+        simd_reverse_lanes(b, std::make_index_sequence<W>());
+        __builtin_memcpy(lo + i * sizeof(U), &b, sizeof(V));
+        __builtin_memcpy(hi - (i + W) * sizeof(U), &a, sizeof(V));
+    }
+    return i;
+}
+
+// Swaps the bytes of a and b, whole vectors at a time; returns how many were swapped
+template<std::size_t Bytes>
+__attribute__((always_inline)) inline std::size_t simd_swap_bytes_kernel(char* a, char* b, std::size_t bytes){
+    using V = typename simd_vector<unsigned char, Bytes>::type;
+    std::size_t i = 0;
+    for(; i + 2 * Bytes <= bytes; i += 2 * Bytes){
+        V x0, x1, y0, y1;
+        __builtin_memcpy(&x0, a + i, Bytes);
+        __builtin_memcpy(&x1, a + i + Bytes, Bytes);
+        __builtin_memcpy(&y0, b + i, Bytes);
+        __builtin_memcpy(&y1, b + i + Bytes, Bytes);
+        __builtin_memcpy(a + i, &y0, Bytes);
+        __builtin_memcpy(a + i + Bytes, &y1, Bytes);
+        __builtin_memcpy(b + i, &x0, Bytes);
+        __builtin_memcpy(b + i + Bytes, &x1, Bytes);
+    }
+    return i;
+}
+
+template<typename U> STL_AVX2_TARGET std::size_t simd_reverse_swap_avx2(char* lo, char* hi, std::size_t count){ return simd_reverse_swap_kernel<U, 32>(lo, hi, count); }
+template<typename U> STL_AVX512_TARGET std::size_t simd_reverse_swap_avx512(char* lo, char* hi, std::size_t count){ return simd_reverse_swap_kernel<U, 64>(lo, hi, count); }
+STL_AVX2_TARGET inline std::size_t simd_swap_bytes_avx2(char* a, char* b, std::size_t bytes){ return simd_swap_bytes_kernel<32>(a, b, bytes); }
+STL_AVX512_TARGET inline std::size_t simd_swap_bytes_avx512(char* a, char* b, std::size_t bytes){ return simd_swap_bytes_kernel<64>(a, b, bytes); }
+#endif
+
+// Element types reversed and swapped as lanes of an unsigned integer of their size
+template<typename T>
+constexpr bool is_simd_block_move_v = std::is_trivially_copyable_v<T> &&
+                                      (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+// Swaps lo[j] and hi[-1 - j] for j < count - one chunk of a reverse
+template<typename RandomIt>
+void reverse_swap(RandomIt lo, RandomIt hi, std::size_t count){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    std::size_t i = 0;
+#if STL_HAS_SIMD
+    if constexpr (is_simd_block_move_v<T> && is_contiguous_iterator_v<RandomIt>){
+        using U = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::conditional_t<sizeof(T) == 4, std::uint32_t,
+                  std::conditional_t<sizeof(T) == 2, std::uint16_t, std::uint8_t>>>;
+        char* l = reinterpret_cast<char*>(&*lo);
+        char* h = reinterpret_cast<char*>(&*(hi - 1)) + sizeof(T);
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: i = simd_reverse_swap_avx512<U>(l, h, count); break;
+            case simd_isa::avx2:   i = simd_reverse_swap_avx2<U>(l, h, count);   break;
+            case simd_isa::scalar: break;
+        }
+    }
+#endif
+    for(; i < count; ++i) std::iter_swap(lo + i, hi - 1 - i);
+}
+
+template<typename RandomIt>
+void fast_reverse(RandomIt first, RandomIt last){
+    if constexpr (is_random_access_iterator_v<RandomIt>){
+        if(last - first > 1) reverse_swap(first, last, (last - first) / 2);
+    }
+    else std::reverse(first, last);
+}
+
+template<typename RandomIt>
+void par_reverse(RandomIt first, RandomIt last){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if(last - first < 2) return;
+    parallel_chunks<T>((last - first) / 2, [&](std::size_t, std::size_t begin, std::size_t end){
+        reverse_swap(first + begin, last - begin, end - begin);
+    });
+}
+
+template<typename RandomIt1, typename RandomIt2>
+RandomIt2 fast_swap_ranges(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2){
+    using T = typename std::iterator_traits<RandomIt1>::value_type;
+#if STL_HAS_SIMD
+    if constexpr (std::is_trivially_copyable_v<T> && std::is_same_v<T, typename std::iterator_traits<RandomIt2>::value_type> &&
+                  is_contiguous_iterator_v<RandomIt1> && is_contiguous_iterator_v<RandomIt2>){
+        const std::size_t n = last1 - first1;
+        if(n == 0) return first2;
+        char* a = reinterpret_cast<char*>(&*first1);
+        char* b = reinterpret_cast<char*>(&*first2);
+        std::size_t done = 0;
+        switch(detect_simd_isa()){
+            case simd_isa::avx512: done = simd_swap_bytes_avx512(a, b, n * sizeof(T)); break;
+            case simd_isa::avx2:   done = simd_swap_bytes_avx2(a, b, n * sizeof(T));   break;
+            case simd_isa::scalar: break;
+        }
+        // The vector part ends on a byte boundary, so the tail is swapped bytewise
+        for(; done < n * sizeof(T); ++done) std::swap(a[done], b[done]);
+        return first2 + n;
+    }
+#endif
+    return std::swap_ranges(first1, last1, first2);
+}
+
+template<typename RandomIt1, typename RandomIt2>
+RandomIt2 par_swap_ranges(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2){
+    using T = typename std::iterator_traits<RandomIt1>::value_type;
+    parallel_chunks<T>(last1 - first1, [&](std::size_t, std::size_t begin, std::size_t end){
+        fast_swap_ranges(first1 + begin, first1 + end, first2 + begin);
+    });
+    return first2 + (last1 - first1);
+}
+
+// Largest shorter side fast_rotate moves through a stack buffer
+constexpr std::size_t rotate_buffer_bytes = 4096;
+
+template<typename RandomIt>
+RandomIt fast_rotate(RandomIt first, RandomIt middle, RandomIt last){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if constexpr (std::is_trivially_copyable_v<T> && is_contiguous_iterator_v<RandomIt>){
+        const RandomIt result = first + (last - middle);
+        if(first == middle || middle == last) return first == middle ? last : first;
+        T* f = &*first;
+        std::size_t left = middle - first, right = last - middle;
+        // Gries-Mills: swap the shorter side with the far end of the longer one, which puts it in its final place
+        while(std::min(left, right) * sizeof(T) > rotate_buffer_bytes){
+            if(left <= right){
+                fast_swap_ranges(f, f + left, f + right);
+                right -= left;
+            }
+            else {
+                fast_swap_ranges(f, f + right, f + left);
+                f += right;
+                left -= right;
+            }
+        }
+        alignas(64) unsigned char buffer[rotate_buffer_bytes];
+        if(left <= right){
+            std::memcpy(buffer, f, left * sizeof(T));
+            std::memmove(f, f + left, right * sizeof(T));
+            std::memcpy(f + right, buffer, left * sizeof(T));
+        }
+        else {
+            std::memcpy(buffer, f + left, right * sizeof(T));
+            std::memmove(f + right, f, left * sizeof(T));
+            std::memcpy(f, buffer, right * sizeof(T));
+        }
+        return result;
+    }
+    else return std::rotate(first, middle, last);
+}
+
+template<typename RandomIt>
+RandomIt par_rotate(RandomIt first, RandomIt middle, RandomIt last){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if(first == middle || middle == last) return first == middle ? last : first;
+    if(static_cast<std::size_t>(last - first) <= 2 * parallel_chunk_elements<T>() || default_thread_pool().size() == 1)
+        return fast_rotate(first, middle, last);
+    par_reverse(first, middle);
+    par_reverse(middle, last);
+    par_reverse(first, last);
+    return first + (last - middle);
+}
+
+// Copies n elements from src to dst with copy(d, s, count) on disjoint pieces in parallel. Ranges overlapping at a
+// distance of at least a chunk are copied in waves of that distance, in the direction that only overwrites elements
+// already read; closer overlaps are left to overlapping(), which copies everything serially.
+template<typename T, typename S, typename CopyDisjoint, typename CopyOverlapping>
+void par_copy_blocks(T* dst, S* src, std::size_t n, CopyDisjoint copy, CopyOverlapping overlapping){
+    const auto d = reinterpret_cast<std::uintptr_t>(dst), s = reinterpret_cast<std::uintptr_t>(src);
+    const std::size_t distance = (d < s ? s - d : d - s) / sizeof(T);
+    if(distance == 0 || n == 0) return;
+    if(distance < n && distance < parallel_chunk_elements<T>()){
+        overlapping(d < s);
+        return;
+    }
+    const std::size_t wave = std::min(distance, n);
+    for(std::size_t done = 0; done < n; done += wave){
+        const std::size_t count = std::min(wave, n - done);
+        const std::size_t at = d < s ? done : n - done - count;
+        parallel_chunks<T>(count, [&](std::size_t, std::size_t begin, std::size_t end){
+            copy(dst + at + begin, src + at + begin, end - begin);
+        });
+    }
+}
+
+// The copy of [src, src + n) to [dst, dst + n) behind par_copy / par_move and their _backward forms
+template<bool Move, typename T, typename S>
+void par_copy_contiguous(T* dst, S* src, std::size_t n){
+    if constexpr (std::is_trivially_copyable_v<T>){
+        const bool stream = n * sizeof(T) >= streaming_store_bytes;
+        par_copy_blocks(dst, src, n, [stream](T* d, S* s, std::size_t count){
+            if(stream) stream_copy_bytes(d, s, count * sizeof(T));
+            else       std::memcpy(d, s, count * sizeof(T));
+        }, [&](bool){ std::memmove(dst, src, n * sizeof(T)); });
+    }
+    else if constexpr (Move){
+        par_copy_blocks(dst, src, n, [](T* d, S* s, std::size_t count){ std::move(s, s + count, d); }, [&](bool forward){
+            if(forward) std::move(src, src + n, dst);
+            else        std::move_backward(src, src + n, dst + n);
+        });
+    }
+    else {
+        par_copy_blocks(dst, src, n, [](T* d, S* s, std::size_t count){ std::copy(s, s + count, d); }, [&](bool forward){
+            if(forward) std::copy(src, src + n, dst);
+            else        std::copy_backward(src, src + n, dst + n);
+        });
+    }
+}
+
+template<typename InputIt, typename OutputIt>
+constexpr bool is_contiguous_copy_v = is_contiguous_iterator_v<InputIt> && is_contiguous_iterator_v<OutputIt> &&
+    std::is_same_v<typename std::iterator_traits<InputIt>::value_type, typename std::iterator_traits<OutputIt>::value_type>;
+
+template<typename InputIt, typename OutputIt>
+OutputIt par_copy(InputIt first, InputIt last, OutputIt d_first){
+    if constexpr (is_contiguous_copy_v<InputIt, OutputIt>){
+        if(first == last) return d_first;
+        par_copy_contiguous<false>(&*d_first, &*first, last - first);
+        return d_first + (last - first);
+    }
+    else return std::copy(first, last, d_first);
+}
+
+template<typename BidirIt1, typename BidirIt2>
+BidirIt2 par_copy_backward(BidirIt1 first, BidirIt1 last, BidirIt2 d_last){
+    if constexpr (is_contiguous_copy_v<BidirIt1, BidirIt2>){
+        if(first == last) return d_last;
+        par_copy_contiguous<false>(&*(d_last - (last - first)), &*first, last - first);
+        return d_last - (last - first);
+    }
+    else return std::copy_backward(first, last, d_last);
+}
+
+template<typename InputIt, typename OutputIt>
+OutputIt par_move(InputIt first, InputIt last, OutputIt d_first){
+    if constexpr (is_contiguous_copy_v<InputIt, OutputIt>){
+        if(first == last) return d_first;
+        par_copy_contiguous<true>(&*d_first, &*first, last - first);
+        return d_first + (last - first);
+    }
+    else return std::move(first, last, d_first);
+}
+
+template<typename BidirIt1, typename BidirIt2>
+BidirIt2 par_move_backward(BidirIt1 first, BidirIt1 last, BidirIt2 d_last){
+    if constexpr (is_contiguous_copy_v<BidirIt1, BidirIt2>){
+        if(first == last) return d_last;
+        par_copy_contiguous<true>(&*(d_last - (last - first)), &*first, last - first);
+        return d_last - (last - first);
+    }
+    else return std::move_backward(first, last, d_last);
+}
+
+// Pipelines - pipe(first, last) / pipe(container) with map, filter and replace_if stages
+// A pipeline is lazy: its stages are composed into one function that takes an element through all of them, and nothing
+// runs before a sink (for_each, reduce, count, copy, collect) pulls the input through it. No stage writes an
+// intermediate vector, so a chain of any length reads the input once and keeps each element in registers from stage to
+// stage. The par_ sinks run the same fused loop on cache-sized chunks on the thread pool: par_reduce folds each chunk
+// from its first output on and then folds init with the chunk results in chunk order, so the result does not depend on
+// the thread count; par_copy and par_collect keep the input order.
+
+struct pipe_source {
+    static constexpr bool filters = false;
+    template<typename In> using output = In;
+
+    template<typename X, typename Sink>
+    void operator()(X&& x, Sink&& sink) const { sink(std::forward<X>(x)); }
+};
+
+template<typename Prev, typename F>
+struct pipe_map {
+    Prev prev;
+    F f;
+    static constexpr bool filters = Prev::filters;
+    template<typename In> using output = std::decay_t<std::invoke_result_t<const F&, typename Prev::template output<In>>>;
+
+    template<typename X, typename Sink>
+    void operator()(X&& x, Sink&& sink) const {
+        prev(std::forward<X>(x), [&](auto&& y){ sink(f(std::forward<decltype(y)>(y))); });
+    }
+};
+
+template<typename Prev, typename Pred>
+struct pipe_filter {
+    Prev prev;
+    Pred pred;
+    static constexpr bool filters = true;
+    template<typename In> using output = typename Prev::template output<In>;
+
+    template<typename X, typename Sink>
+    void operator()(X&& x, Sink&& sink) const {
+        prev(std::forward<X>(x), [&](auto&& y){ if(pred(y)) sink(std::forward<decltype(y)>(y)); });
+    }
+};
+
+template<typename Prev, typename Pred, typename T>
+struct pipe_replace_if {
+    Prev prev;
+    Pred pred;
+    T value;
+    static constexpr bool filters = Prev::filters;
+    template<typename In> using output = typename Prev::template output<In>;
+
+    template<typename X, typename Sink>
+    void operator()(X&& x, Sink&& sink) const {
+        prev(std::forward<X>(x), [&](auto&& y){
+            using V = std::decay_t<decltype(y)>;
+            sink(pred(y) ? static_cast<V>(value) : static_cast<V>(std::forward<decltype(y)>(y)));
+        });
+    }
+};
+
+template<typename RandomIt, typename Stage = pipe_source>
+class pipeline {
+    using input_type = typename std::iterator_traits<RandomIt>::value_type;
+
+public:
+    using value_type = typename Stage::template output<input_type>;
+
+    pipeline(RandomIt first, RandomIt last, Stage stage = Stage()) : first(first), last(last), stage(std::move(stage)) {}
+
+    // Stages - each returns a new pipeline, nothing is evaluated
+    template<typename F>
+    auto map(F f) const { return next(pipe_map<Stage, F>{stage, std::move(f)}); }
+
+    template<typename Pred>
+    auto filter(Pred pred) const { return next(pipe_filter<Stage, Pred>{stage, std::move(pred)}); }
+
+    template<typename Pred, typename T>
+    auto replace_if(Pred pred, const T& value) const { return next(pipe_replace_if<Stage, Pred, T>{stage, std::move(pred), value}); }
+
+    // Sinks - one pass over the input
+    template<typename F>
+    F for_each(F f) const {
+        run(0, size(), f);
+        return f;
+    }
+
+    template<typename T, typename BinaryOp = std::plus<>>
+    T reduce(T init, BinaryOp op = BinaryOp()) const {
+        run(0, size(), [&](auto&& y){ init = op(std::move(init), std::forward<decltype(y)>(y)); });
+        return init;
+    }
+
+    std::size_t count() const {
+        std::size_t count = 0;
+        run(0, size(), [&](auto&&){ ++count; });
+        return count;
+    }
+
+    template<typename OutputIt>
+    OutputIt copy(OutputIt out) const {
+        run(0, size(), [&](auto&& y){ *out++ = std::forward<decltype(y)>(y); });
+        return out;
+    }
+
+    std::vector<value_type> collect() const {
+        std::vector<value_type> values;
+        if constexpr (!Stage::filters) values.reserve(size());
+        copy(std::back_inserter(values));
+        return values;
+    }
+
+    // Parallel sinks. par_for_each calls f from several threads at once, on chunks in no particular order.
+    template<typename F>
+    void par_for_each(F f) const {
+        parallel_chunks<input_type>(size(), [&](std::size_t, std::size_t begin, std::size_t end){ run(begin, end, f); });
+    }
+
+    // Every chunk folds its first output into the following ones, chunks without output are skipped
+    template<typename T, typename BinaryOp = std::plus<>>
+    T par_reduce(T init, BinaryOp op = BinaryOp()) const {
+        const std::size_t n = size();
+        std::vector<std::optional<T>> partials((n + parallel_chunk_elements<input_type>() - 1) / parallel_chunk_elements<input_type>());
+        parallel_chunks<input_type>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+            std::size_t i = begin;
+            for(; i < end && !partials[c]; ++i) run(i, i + 1, [&](auto&& y){ partials[c].emplace(std::forward<decltype(y)>(y)); });
+            if(!partials[c]) return;
+            T acc = std::move(*partials[c]);
+            run(i, end, [&](auto&& y){ acc = op(std::move(acc), std::forward<decltype(y)>(y)); });
+            partials[c] = std::move(acc);
+        });
+        for(auto& p : partials)
+            if(p) init = op(std::move(init), std::move(*p));
+        return init;
+    }
+
+    // Without a filter every chunk writes straight to its place in out; otherwise every chunk collects its output in a
+    // buffer of its own, and the buffers are moved to out at the offsets given by the sizes of the ones before them
+    template<typename RandomOutputIt>
+    RandomOutputIt par_copy(RandomOutputIt out) const {
+        const std::size_t n = size();
+        if constexpr (!Stage::filters){
+            parallel_chunks<input_type>(n, [&](std::size_t, std::size_t begin, std::size_t end){
+                RandomOutputIt o = out + begin;
+                run(begin, end, [&](auto&& y){ *o = std::forward<decltype(y)>(y); ++o; });
+            });
+            return out + n;
+        }
+        else {
+            auto buffers = chunk_outputs();
+            std::vector<std::size_t> offset(buffers.size() + 1, 0);
+            for(std::size_t c = 0; c < buffers.size(); ++c) offset[c + 1] = offset[c] + buffers[c].size();
+            default_thread_pool().parallel_for(buffers.size(), [&](std::size_t c){
+                std::move(buffers[c].begin(), buffers[c].end(), out + offset[c]);
+            });
+            return out + offset.back();
+        }
+    }
+
+    std::vector<value_type> par_collect() const {
+        if constexpr (!Stage::filters){
+            std::vector<value_type> values(size());
+            par_copy(values.begin());
+            return values;
+        }
+        else {
+            auto buffers = chunk_outputs();
+            std::size_t total = 0;
+            for(auto& b : buffers) total += b.size();
+            std::vector<value_type> values;
+            values.reserve(total);
+            for(auto& b : buffers) values.insert(values.end(), std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+            return values;
+        }
+    }
+
+private:
+    template<typename NextStage>
+    pipeline<RandomIt, NextStage> next(NextStage s) const { return {first, last, std::move(s)}; }
+
+    std::size_t size() const { return last - first; }
+
+    template<typename Sink>
+    void run(std::size_t begin, std::size_t end, Sink&& sink) const {
+        for(std::size_t i = begin; i < end; ++i) stage(first[i], sink);
+    }
+
+    std::vector<std::vector<value_type>> chunk_outputs() const {
+        const std::size_t n = size();
+        std::vector<std::vector<value_type>> buffers((n + parallel_chunk_elements<input_type>() - 1) / parallel_chunk_elements<input_type>());
+        parallel_chunks<input_type>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+            buffers[c].resize(end - begin);
+            std::size_t k = 0;
+            run(begin, end, [&](auto&& y){ buffers[c][k++] = std::forward<decltype(y)>(y); });
+            buffers[c].resize(k);
+        });
+        return buffers;
+    }
+
+    RandomIt first, last;
+    Stage stage;
+};
+
+template<typename RandomIt>
+pipeline<RandomIt> pipe(RandomIt first, RandomIt last){ return {first, last}; }
+
+template<typename Container>
+auto pipe(Container& c){ return pipe(std::begin(c), std::end(c)); }
+
+// Permutation test - fast_is_permutation
+// Same result as std::is_permutation with ==, in linear or n log n time instead of quadratic. After the common prefix,
+// both ranges are reduced to an order-independent checksum (the wrapping sum of a mixed hash of every element, in
+// parallel on large ranges), which rejects almost every non-permutation in one pass. Then the rest is decided by
+// - an array of counts for 8 and 16 bit integers, and for wider integers whose values span less than the range length
+// - sorting copies of both ranges with par_sort (a radix sort) for other arithmetic types
+// - a hash table counting the occurrences of every distinct element for other types with a std::hash
+// - sorting copies for types that only have operator<; anything else goes to std::is_permutation.
+// NaN compares unequal to everything, so a floating point range holding one is never a permutation.
+
+inline std::uint64_t mix_hash64(std::uint64_t x){
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+template<typename T>
+constexpr bool is_hashable_v = std::is_default_constructible_v<std::hash<T>>;
+
+template<typename T, typename = void>
+struct is_less_comparable : std::false_type {};
+template<typename T>
+struct is_less_comparable<T, std::void_t<decltype(std::declval<const T&>() < std::declval<const T&>())>> : std::true_type {};
+
+// Equal elements hash equally: -0.0 is hashed as 0.0
+template<typename T>
+std::uint64_t permutation_hash(const T& x){
+    if constexpr (std::is_floating_point_v<T> && sizeof(T) <= 8){
+        const T y = x == T(0) ? T(0) : x;
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &y, sizeof(T));
+        return mix_hash64(bits);
+    }
+    else if constexpr (std::is_integral_v<T>) return mix_hash64(static_cast<std::uint64_t>(x));
+    else return mix_hash64(std::hash<T>()(x));
+}
+
+template<typename RandomIt>
+std::uint64_t permutation_checksum(RandomIt first, RandomIt last){
+    auto hash = [](const auto& x){ return permutation_hash(x); };
+    if(last - first >= (1 << 15)) return par_transform_reduce(first, last, std::uint64_t(0), std::plus<>(), hash);
+    return std::transform_reduce(first, last, std::uint64_t(0), std::plus<>(), hash);
+}
+
+// Integers of the first range lie in [lo, lo + span). Counts up for the first range and down for the second.
+template<typename RandomIt1, typename RandomIt2, typename T>
+bool counting_is_permutation(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, T lo, std::uint64_t span){
+    const std::size_t n = last1 - first1;
+    std::vector<std::size_t> counts(span, 0);
+    for(std::size_t i = 0; i < n; ++i) ++counts[static_cast<std::uint64_t>(first1[i]) - static_cast<std::uint64_t>(lo)];
+    for(std::size_t i = 0; i < n; ++i){
+        const std::uint64_t slot = static_cast<std::uint64_t>(first2[i]) - static_cast<std::uint64_t>(lo);
+        if(slot >= span || counts[slot]-- == 0) return false;
+    }
+    return true;
+}
+
+template<typename RandomIt1, typename RandomIt2>
+bool sorted_is_permutation(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2){
+    std::vector<typename std::iterator_traits<RandomIt1>::value_type> a(first1, last1), b(first2, first2 + (last1 - first1));
+    par_sort(a.begin(), a.end());
+    par_sort(b.begin(), b.end());
+    return simd_equal(a.begin(), a.end(), b.begin());
+}
+
+// Occurrences are counted per distinct element, at the position of its first occurrence in the first range
+template<typename RandomIt1, typename RandomIt2>
+bool hashed_is_permutation(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2){
+    using T = typename std::iterator_traits<RandomIt1>::value_type;
+    const std::size_t n = last1 - first1;
+    std::hash<T> hash;
+    position_set distinct;
+    std::vector<std::size_t> counts(n, 0);
+    for(std::size_t i = 0; i < n; ++i)
+        ++counts[distinct.insert(hash(first1[i]), i, [&](std::size_t p){ return first1[p] == first1[i]; })];
+    for(std::size_t i = 0; i < n; ++i){
+        const std::size_t p = distinct.find(hash(first2[i]), [&](std::size_t q){ return first1[q] == first2[i]; });
+        if(p == position_set::npos || counts[p]-- == 0) return false;
+    }
+    return true;
+}
+
+template<typename ForwardIt1, typename ForwardIt2>
+bool fast_is_permutation(ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2){
+    using T = typename std::iterator_traits<ForwardIt1>::value_type;
+    if constexpr (is_random_access_iterator_v<ForwardIt1> && is_random_access_iterator_v<ForwardIt2> &&
+                  std::is_same_v<T, typename std::iterator_traits<ForwardIt2>::value_type>){
+        std::tie(first1, first2) = simd_mismatch(first1, last1, first2);
+        const std::size_t n = last1 - first1;
+        if(n == 0) return true;
+        const ForwardIt2 last2 = first2 + n;
+
+        if constexpr (std::is_floating_point_v<T>){
+            auto is_nan = [](const T& x){ return x != x; };
+            if(std::any_of(first1, last1, is_nan) || std::any_of(first2, last2, is_nan)) return false;
+        }
+        if constexpr (is_hashable_v<T>)
+            if(permutation_checksum(first1, last1) != permutation_checksum(first2, last2)) return false;
+
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= 2)
+            return counting_is_permutation(first1, last1, first2, std::numeric_limits<T>::min(), std::uint64_t(1) << (8 * sizeof(T)));
+        else if constexpr (std::is_integral_v<T>){
+            const auto range = std::minmax_element(first1, last1);
+            const std::uint64_t span = static_cast<std::uint64_t>(*range.second) - static_cast<std::uint64_t>(*range.first);
+            if(span < n) return counting_is_permutation(first1, last1, first2, *range.first, span + 1);
+            return sorted_is_permutation(first1, last1, first2);
+        }
+        else if constexpr (std::is_arithmetic_v<T>) return sorted_is_permutation(first1, last1, first2);
+        else if constexpr (is_hashable_v<T>) return hashed_is_permutation(first1, last1, first2);
+        else if constexpr (is_less_comparable<T>::value) return sorted_is_permutation(first1, last1, first2);
+        else return std::is_permutation(first1, last1, first2);
+    }
+    else return std::is_permutation(first1, last1, first2);
+}
+
+template<typename ForwardIt1, typename ForwardIt2>
+bool fast_is_permutation(ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2, ForwardIt2 last2){
+    if constexpr (is_random_access_iterator_v<ForwardIt1> && is_random_access_iterator_v<ForwardIt2>){
+        if(last1 - first1 != last2 - first2) return false;
+        return fast_is_permutation(first1, last1, first2);
+    }
+    else return std::is_permutation(first1, last1, first2, last2);
+}
+
+// Random sampling - wyrand, philox4x32, uniform_below, fast_shuffle, par_shuffle, fast_sample, reservoir_sampler,
+// weighted_sample
+// wyrand and philox4x32 are counter-based generators: the nth output is a hash of n (and the seed), so a generator can
+// jump anywhere in its sequence in O(1), and independent streams for chunks of work are just different start points.
+// Both satisfy UniformRandomBitGenerator with 64 bit outputs and work with the std:: algorithms and distributions.
+// wyrand costs one 64 x 64 -> 128 bit multiply per output; philox4x32 (10 rounds, as in Random123) is slower but
+// passes the stricter statistical test suites and is the usual choice for parallel simulations.
+// par_shuffle is reproducible: its result depends only on the seed and the range length, never on the thread count.
+
+struct wyrand {
+    using result_type = std::uint64_t;
+
+    explicit wyrand(std::uint64_t seed = 0) : state(seed) {}
+
+    // Generator number 'id' of a seed, e.g. one per chunk of a parallel algorithm
+    static wyrand stream(std::uint64_t seed, std::uint64_t id){ return wyrand(mix_hash64(seed ^ mix_hash64(id + 0x9E3779B97F4A7C15ull))); }
+
+    static constexpr result_type min(){ return 0; }
+    static constexpr result_type max(){ return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()(){
+        state += 0xa0761d6478bd642full;
+        const __uint128_t m = static_cast<__uint128_t>(state) * (state ^ 0xe7037ed1a0b428dbull);
+        return static_cast<std::uint64_t>(m >> 64) ^ static_cast<std::uint64_t>(m);
+    }
+
+    void discard(std::uint64_t count){ state += count * 0xa0761d6478bd642full; }
+
+    std::uint64_t state;
+};
+
+class philox4x32 {
+public:
+    using result_type = std::uint64_t;
+
+    // The 128 bit counter is (stream, output block), so every stream of a seed is a separate sequence of 2^64 blocks
+    explicit philox4x32(std::uint64_t seed = 0, std::uint64_t stream = 0)
+        : key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+          stream_words{static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)} {}
+
+    static constexpr result_type min(){ return 0; }
+    static constexpr result_type max(){ return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()(){
+        if(position % 2 == 0) refill(position / 2);
+        return buffer[position++ % 2];
+    }
+
+    void discard(std::uint64_t count){
+        position += count;
+        if(position % 2 == 1) refill(position / 2);
+    }
+
+    // Philox4x32-10 of one counter value
+    static std::array<std::uint32_t, 4> block(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key){
+        std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3], k0 = key[0], k1 = key[1];
+        for(int round = 0; round < 10; ++round){
+            const std::uint64_t p0 = std::uint64_t(0xD2511F53u) * c0;
+            const std::uint64_t p1 = std::uint64_t(0xCD9E8D57u) * c2;
+            c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<std::uint32_t>(p1);
+            c3 = static_cast<std::uint32_t>(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        return {c0, c1, c2, c3};
+    }
+
+private:
+    void refill(std::uint64_t index){
+        const auto words = block({static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32), stream_words[0], stream_words[1]}, key);
+        buffer[0] = words[0] | std::uint64_t(words[1]) << 32;
+        buffer[1] = words[2] | std::uint64_t(words[3]) << 32;
+    }
+
+    std::array<std::uint32_t, 2> key;
+    std::array<std::uint32_t, 2> stream_words;
+    std::uint64_t position = 0;                     // outputs taken so far
+    std::uint64_t buffer[2] = {0, 0};
+};
+
+// Uniform integer in [0, bound) from a 64 bit generator: Lemire's multiply-and-shift, which only divides in the rare case
+// that needs a rejection test, instead of the division (or two) per call of std::uniform_int_distribution
+template<typename URBG>
+std::uint64_t uniform_below(URBG& rng, std::uint64_t bound){
+    static_assert(URBG::min() == 0 && URBG::max() == std::numeric_limits<std::uint64_t>::max(), "needs 64 random bits per call");
+    __uint128_t m = static_cast<__uint128_t>(rng()) * bound;
+    if(static_cast<std::uint64_t>(m) < bound){
+        const std::uint64_t threshold = (0 - bound) % bound;
+        while(static_cast<std::uint64_t>(m) < threshold) m = static_cast<__uint128_t>(rng()) * bound;
+    }
+    return static_cast<std::uint64_t>(m >> 64);
+}
+
+// Uniform double in (0, 1), never 0 so that its logarithm is finite
+template<typename URBG>
+double uniform_open01(URBG& rng){ return ((rng() >> 11) + 0.5) * 0x1.0p-53; }
+
+// fast_shuffle - Fisher-Yates with uniform_below, for wyrand / philox4x32
+template<typename RandomIt, typename URBG>
+void fast_shuffle(RandomIt first, RandomIt last, URBG&& rng){
+    for(std::size_t i = last - first; i > 1; --i) std::iter_swap(first + (i - 1), first + uniform_below(rng, i));
+}
+
+// par_shuffle - every element is sent to a uniformly random bucket (buckets of about a chunk), then every bucket is
+// shuffled. The input is split into at most 256 blocks that pick buckets in parallel, each with its own wyrand stream:
+// one pass counts the elements per (block, bucket), a second pass replays the same streams and scatters the elements to
+// their offsets. Buckets are then shuffled and moved back in parallel. Small ranges use fast_shuffle.
+template<typename RandomIt>
+void par_shuffle(RandomIt first, RandomIt last, std::uint64_t seed){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if(n < (1 << 16)){
+        fast_shuffle(first, last, wyrand(seed));
+        return;
+    }
+
+    const std::size_t chunks = (n + parallel_chunk_elements<T>() - 1) / parallel_chunk_elements<T>();
+    const std::size_t blocks = std::min<std::size_t>(256, chunks), buckets = std::min<std::size_t>(1024, chunks);
+    std::vector<std::size_t> offsets(blocks * buckets, 0);      // counts, then scatter positions, block-major
+    auto& pool = default_thread_pool();
+    pool.parallel_for(blocks, [&](std::size_t b){
+        wyrand rng = wyrand::stream(seed, b);
+        std::size_t* counts = &offsets[b * buckets];
+        for(std::size_t i = n * b / blocks, end = n * (b + 1) / blocks; i < end; ++i) ++counts[uniform_below(rng, buckets)];
+    });
+
+    std::vector<std::size_t> bucket_start(buckets + 1, 0);
+    for(std::size_t k = 0, sum = 0; k < buckets; ++k){
+        bucket_start[k] = sum;
+        for(std::size_t b = 0; b < blocks; ++b){
+            const std::size_t count = offsets[b * buckets + k];
+            offsets[b * buckets + k] = sum;
+            sum += count;
+        }
+    }
+    bucket_start[buckets] = n;
+
+    std::vector<T, default_init_allocator<T>> scattered(n);
+    pool.parallel_for(blocks, [&](std::size_t b){
+        wyrand rng = wyrand::stream(seed, b);
+        std::size_t* next = &offsets[b * buckets];
+        for(std::size_t i = n * b / blocks, end = n * (b + 1) / blocks; i < end; ++i)
+            scattered[next[uniform_below(rng, buckets)]++] = std::move(first[i]);
+    });
+    pool.parallel_for(buckets, [&](std::size_t k){
+        fast_shuffle(scattered.begin() + bucket_start[k], scattered.begin() + bucket_start[k + 1], wyrand::stream(seed, blocks + k));
+        std::move(scattered.begin() + bucket_start[k], scattered.begin() + bucket_start[k + 1], first + bucket_start[k]);
+    });
+}
+
+// reservoir_sampler - uniform sample of k elements from a stream of unknown length (Li's Algorithm L). After the
+// reservoir is full, the number of elements to skip until the next replacement is drawn directly, so a stream of n
+// elements costs O(k (1 + log(n / k))) random numbers instead of one per element. The sample is in no particular order.
+// With a reference URBG (e.g. wyrand&) the sampler draws from the caller's generator instead of its own copy.
+template<typename T, typename URBG = wyrand>
+class reservoir_sampler {
+public:
+    reservoir_sampler(std::size_t k, URBG rng = URBG()) : k(k), rng(std::forward<URBG>(rng)) { reservoir.reserve(k); }
+
+    void push(T value){
+        ++count;
+        if(count <= k){
+            reservoir.push_back(std::move(value));
+            if(count == k) advance();
+        }
+        else if(count == next){
+            reservoir[uniform_below(rng, k)] = std::move(value);
+            advance();
+        }
+    }
+
+    // Skipped elements of a random access range are not visited at all
+    template<typename InputIt>
+    void push(InputIt first, InputIt last){
+        while(first != last){
+            if(count >= k && next > count + 1){
+                const std::uint64_t skip = next - count - 1;
+                if constexpr (is_random_access_iterator_v<InputIt>){
+                    const std::uint64_t step = std::min<std::uint64_t>(skip, last - first);
+                    first += step;
+                    count += step;
+                }
+                else {
+                    for(std::uint64_t s = 0; s < skip && first != last; ++s, ++first) ++count;
+                }
+                if(first == last) break;
+            }
+            push(*first);
+            ++first;
+        }
+    }
+
+    const std::vector<T>& sample() const { return reservoir; }
+    std::uint64_t seen() const { return count; }
+
+private:
+    // Draws the position of the next element to enter the reservoir
+    void advance(){
+        if(k == 0){
+            next = std::numeric_limits<std::uint64_t>::max();
+            return;
+        }
+        w *= std::exp(std::log(uniform_open01(rng)) / k);
+        const double skip = std::floor(std::log(uniform_open01(rng)) / std::log1p(-w));
+        next = skip < 1e18 ? count + static_cast<std::uint64_t>(skip) + 1 : std::numeric_limits<std::uint64_t>::max();
+    }
+
+    std::size_t k;
+    URBG rng;
+    std::vector<T> reservoir;
+    std::uint64_t count = 0, next = 0;
+    double w = 1;
+};
+
+// fast_sample - k elements of [first, last), each subset equally likely, written in input order like std::sample with
+// forward iterators. Random access input draws k distinct positions with Floyd's algorithm and sorts them, O(k log k)
+// however long the range; other input goes through a reservoir_sampler (not in input order, out must be random access).
+template<typename InputIt, typename OutputIt, typename URBG>
+OutputIt fast_sample(InputIt first, InputIt last, OutputIt out, std::size_t k, URBG&& rng){
+    if constexpr (is_random_access_iterator_v<InputIt>){
+        const std::size_t n = last - first;
+        k = std::min(k, n);
+        position_set drawn;
+        std::vector<std::size_t> positions;
+        positions.reserve(k);
+        for(std::size_t j = n - k; j < n; ++j){
+            std::size_t t = uniform_below(rng, j + 1);
+            if(drawn.find(mix_hash64(t), [&](std::size_t p){ return p == t; }) != position_set::npos) t = j;
+            drawn.insert(mix_hash64(t), t, [&](std::size_t p){ return p == t; });
+            positions.push_back(t);
+        }
+        std::sort(positions.begin(), positions.end());
+        for(std::size_t p : positions) *out++ = first[p];
+        return out;
+    }
+    else {
+        reservoir_sampler<typename std::iterator_traits<InputIt>::value_type, std::remove_reference_t<URBG>&> sampler(k, rng);
+        sampler.push(first, last);
+        return std::copy(sampler.sample().begin(), sampler.sample().end(), out);
+    }
+}
+
+// weighted_sample - k elements without replacement, element i chosen with probability proportional to weights[i] at
+// every draw; elements of weight 0 are never chosen. Efraimidis-Spirakis with exponential jumps: every element gets the
+// key log(u) / w and the k largest keys win. Once k elements are held, the total weight to skip until the next one
+// beats the smallest key is drawn directly, so most elements cost one subtraction. Written in draw order.
+template<typename InputIt, typename WeightIt, typename OutputIt, typename URBG>
+OutputIt weighted_sample(InputIt first, InputIt last, WeightIt weights, OutputIt out, std::size_t k, URBG&& rng){
+    using item = std::pair<double, typename std::iterator_traits<InputIt>::value_type>;
+    auto larger_key = [](const item& a, const item& b){ return a.first > b.first; };
+    std::vector<item> heap;                                     // min-heap on the key
+    heap.reserve(k);
+    double jump = 0;
+    for(; first != last && k > 0; ++first, ++weights){
+        const double w = static_cast<double>(*weights);
+        if(!(w > 0)) continue;
+        if(heap.size() < k){
+            heap.push_back({std::log(uniform_open01(rng)) / w, *first});
+            std::push_heap(heap.begin(), heap.end(), larger_key);
+            if(heap.size() == k) jump = std::log(uniform_open01(rng)) / heap.front().first;
+            continue;
+        }
+        jump -= w;
+        if(jump > 0) continue;
+        // The key of this element, drawn on the condition that it beats the smallest key t: u in (e^(t w), 1)
+        const double beaten = std::exp(heap.front().first * w);
+        const double key = std::log(beaten + (1 - beaten) * uniform_open01(rng)) / w;
+        std::pop_heap(heap.begin(), heap.end(), larger_key);
+        heap.back() = {key, *first};
+        std::push_heap(heap.begin(), heap.end(), larger_key);
+        jump = std::log(uniform_open01(rng)) / heap.front().first;
+    }
+    std::sort(heap.begin(), heap.end(), larger_key);
+    for(auto& h : heap) *out++ = std::move(h.second);
+    return out;
+}
+
+// Sorting networks - sorting_network_v, merge_network_v, selection_network_v, median_network_v, network_sort,
+// network_merge, network_partial_sort, network_median, network_minmax, network_sorted, batch_network_sort,
+// batch_network_partial_sort
+// A sorting network is a fixed list of compare-exchange steps that sorts any input of its size. The networks are built at
+// compile time (Batcher's merge exchange for up to 32 elements, odd-even merge for two sorted runs) and the selection and
+// median networks keep only the comparators that lead to the wanted outputs. Applying one is fully unrolled and
+// branchless for trivially copyable elements: no loop, no recursion and no mispredicted branch, which is where
+// std::sort loses its time on a handful of elements. Everything works in constant expressions. The batch_ versions sort
+// many small arrays at once: the rows of one block are transposed into SIMD registers, one register per position, so
+// every comparator sorts a whole register's worth of rows with one min and one max.
+
+struct comparator { std::uint8_t i, j; };
+
+// A network under construction, at most 512 comparators on at most 64 wires
+struct network_builder {
+    std::array<comparator, 512> comparators{};
+    std::size_t size = 0;
+
+    constexpr void add(std::size_t i, std::size_t j){
+        comparators[size++] = {static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(j)};
+    }
+};
+
+// Knuth's Algorithm M (merge exchange), Batcher's odd-even merge sort for any n
+constexpr network_builder make_sorting_network(std::size_t n){
+    network_builder net;
+    std::size_t t = 0;
+    while((std::size_t(1) << t) < n) ++t;
+    for(std::size_t p = t == 0 ? 0 : std::size_t(1) << (t - 1); p > 0; p >>= 1){
+        std::size_t q = std::size_t(1) << (t - 1), r = 0, d = p;
+        while(true){
+            for(std::size_t i = 0; i + d < n; ++i)
+                if((i & p) == r) net.add(i, i + d);
+            if(q == p) break;
+            d = q - p;
+            q >>= 1;
+            r = p;
+        }
+    }
+    return net;
+}
+
+constexpr void add_odd_even_merge(network_builder& net, std::size_t lo, std::size_t n, std::size_t r){
+    const std::size_t step = r * 2;
+    if(step < n){
+        add_odd_even_merge(net, lo, n, step);
+        add_odd_even_merge(net, lo + r, n, step);
+        for(std::size_t i = lo + r; i + r < lo + n; i += step) net.add(i, i + r);
+    }
+    else net.add(lo, lo + r);
+}
+
+// Merges sorted [0, a) and [a, a + b). Built for two runs of the next power of two p, the first run right-aligned, i.e.
+// after p - a smallest-possible elements, and the second followed by largest-possible ones. Those padding elements
+// never move, so every comparator touching them is dropped.
+constexpr network_builder make_merge_network(std::size_t a, std::size_t b){
+    network_builder padded, net;
+    std::size_t p = 1;
+    while(p < a || p < b) p *= 2;
+    if(a == 0 || b == 0) return net;
+    add_odd_even_merge(padded, 0, 2 * p, 1);
+    const std::size_t begin = p - a, end = p + b;
+    for(std::size_t c = 0; c < padded.size; ++c){
+        const comparator x = padded.comparators[c];
+        if(x.i >= begin && x.j < end) net.add(x.i - begin, x.j - begin);
+    }
+    return net;
+}
+
+// Keeps the comparators that decide the wires in 'outputs' (a bit mask): walking backwards, a comparator is needed if it
+// writes a wire that is needed later, and then both of its inputs are needed
+constexpr network_builder prune_network(const network_builder& full, std::uint64_t outputs){
+    std::array<bool, 512> keep{};
+    std::size_t kept = 0;
+    for(std::size_t c = full.size; c-- > 0;){
+        const comparator x = full.comparators[c];
+        if((outputs >> x.i & 1) || (outputs >> x.j & 1)){
+            keep[c] = true;
+            ++kept;
+            outputs |= std::uint64_t(1) << x.i | std::uint64_t(1) << x.j;
+        }
+    }
+    network_builder net;
+    for(std::size_t c = 0; c < full.size; ++c)
+        if(keep[c]) net.add(full.comparators[c].i, full.comparators[c].j);
+    return net;
+}
+
+template<std::size_t Count>
+constexpr std::array<comparator, Count> finish_network(const network_builder& net){
+    std::array<comparator, Count> result{};
+    for(std::size_t c = 0; c < Count; ++c) result[c] = net.comparators[c];
+    return result;
+}
+
+template<std::size_t N>
+inline constexpr network_builder sorting_network_builder_v = make_sorting_network(N);
+template<std::size_t A, std::size_t B>
+inline constexpr network_builder merge_network_builder_v = make_merge_network(A, B);
+template<std::size_t K, std::size_t N>
+inline constexpr network_builder selection_network_builder_v =
+    prune_network(sorting_network_builder_v<N>, K >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << K) - 1);
+template<std::size_t N>
+inline constexpr network_builder median_network_builder_v = prune_network(sorting_network_builder_v<N>, std::uint64_t(1) << (N / 2));
+
+// The comparators of each network, as std::array<comparator, count>
+template<std::size_t N>
+inline constexpr auto sorting_network_v = finish_network<sorting_network_builder_v<N>.size>(sorting_network_builder_v<N>);
+template<std::size_t A, std::size_t B>
+inline constexpr auto merge_network_v = finish_network<merge_network_builder_v<A, B>.size>(merge_network_builder_v<A, B>);
+template<std::size_t K, std::size_t N>
+inline constexpr auto selection_network_v = finish_network<selection_network_builder_v<K, N>.size>(selection_network_builder_v<K, N>);
+template<std::size_t N>
+inline constexpr auto median_network_v = finish_network<median_network_builder_v<N>.size>(median_network_builder_v<N>);
+
+// Orders a and b. Trivially copyable elements are selected without a branch (cmov / min / max), others swapped.
+template<typename T, typename Compare>
+constexpr void compare_exchange(T& a, T& b, Compare& comp){
+    if constexpr (std::is_trivially_copyable_v<T>){
+        const bool swap = comp(b, a);
+        const T lo = swap ? b : a;
+        const T hi = swap ? a : b;
+        a = lo;
+        b = hi;
+    }
+    else if(comp(b, a)) std::iter_swap(&a, &b);
+}
+
+template<const auto& Net, typename RandomIt, typename Compare, std::size_t... I>
+constexpr void apply_network(RandomIt first, Compare& comp, std::index_sequence<I...>){
+    (compare_exchange(first[Net[I].i], first[Net[I].j], comp), ...);
+}
+
+template<const auto& Net, typename RandomIt, typename Compare>
+constexpr void apply_network(RandomIt first, Compare comp){
+    apply_network<Net>(first, comp, std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(Net)>>>());
+}
+
+// Sorts [first, first + N)
+template<std::size_t N, typename RandomIt, typename Compare = std::less<>>
+constexpr void network_sort(RandomIt first, Compare comp = Compare()){
+    static_assert(N <= 32, "sorting networks are built for up to 32 elements");
+    apply_network<sorting_network_v<N>>(first, comp);
+}
+
+// Merges the sorted runs [first, first + A) and [first + A, first + A + B)
+template<std::size_t A, std::size_t B, typename RandomIt, typename Compare = std::less<>>
+constexpr void network_merge(RandomIt first, Compare comp = Compare()){
+    static_assert(A <= 32 && B <= 32, "merge networks are built for runs of up to 32 elements");
+    apply_network<merge_network_v<A, B>>(first, comp);
+}
+
+// The K smallest of [first, first + N) sorted into [first, first + K), the rest in no particular order
+template<std::size_t K, std::size_t N, typename RandomIt, typename Compare = std::less<>>
+constexpr void network_partial_sort(RandomIt first, Compare comp = Compare()){
+    static_assert(K <= N && N <= 32, "sorting networks are built for up to 32 elements");
+    apply_network<selection_network_v<K, N>>(first, comp);
+}
+
+// Element N / 2 of the sorted order, like nth_element at first + N / 2. The range is left partially reordered.
+template<std::size_t N, typename RandomIt, typename Compare = std::less<>>
+constexpr typename std::iterator_traits<RandomIt>::value_type network_median(RandomIt first, Compare comp = Compare()){
+    static_assert(N >= 1 && N <= 32, "sorting networks are built for up to 32 elements");
+    apply_network<median_network_v<N>>(first, comp);
+    return first[N / 2];
+}
+
+// Smallest and largest of [first, first + N) in 3N / 2 comparisons: pairs are ordered first, then the smaller of each pair
+// competes for the minimum and the larger for the maximum
+template<std::size_t N, typename RandomIt, typename Compare = std::less<>>
+constexpr auto network_minmax(RandomIt first, Compare comp = Compare()){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    static_assert(N >= 1, "minmax of an empty range");
+    T lo = first[0], hi = first[0];
+    std::size_t i = N % 2 == 0 ? 0 : 1;
+    for(; i + 1 < N; i += 2){
+        T a = first[i], b = first[i + 1];
+        compare_exchange(a, b, comp);
+        lo = comp(a, lo) ? a : lo;
+        hi = comp(hi, b) ? b : hi;
+    }
+    return std::pair<T, T>(lo, hi);
+}
+
+// Sorted copy of an array, e.g. a constexpr lookup table
+template<typename T, std::size_t N, typename Compare = std::less<>>
+constexpr std::array<T, N> network_sorted(std::array<T, N> a, Compare comp = Compare()){
+    network_sort<N>(a.begin(), comp);
+    return a;
+}
+
+#if STL_HAS_SIMD
+// compare_exchange of every lane: a gets the lane-wise minimum, b the maximum
+template<typename V>
+__attribute__((always_inline)) inline void simd_compare_exchange(V& a, V& b){
+    const V lo = b < a ? b : a;
+    const V hi = b < a ? a : b;
+    a = lo;
+    b = hi;
+}
+
+// One register per position of W rows
+template<const auto& Net, typename V, std::size_t... I>
+__attribute__((always_inline)) inline void simd_apply_network(V* lanes, std::index_sequence<I...>){
+    (simd_compare_exchange(lanes[Net[I].i], lanes[Net[I].j]), ...);
+}
+
+// Applies Net to every row of N elements in blocks of one register of rows; returns the rows done
+template<const auto& Net, std::size_t N, typename T, std::size_t Bytes>
+__attribute__((always_inline)) inline std::size_t simd_batch_network_kernel(T* rows, std::size_t count){
+    using V = typename simd_vector<T, Bytes>::type;
+    constexpr std::size_t W = simd_vector<T, Bytes>::lanes;
+    std::size_t r = 0;
+    for(; r + W <= count; r += W){
+        V lanes[N];
+        for(std::size_t k = 0; k < N; ++k)
+            for(std::size_t w = 0; w < W; ++w) lanes[k][w] = rows[(r + w) * N + k];
+        simd_apply_network<Net>(lanes, std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(Net)>>>());
+        for(std::size_t w = 0; w < W; ++w)
+            for(std::size_t k = 0; k < N; ++k) rows[(r + w) * N + k] = lanes[k][w];
+    }
+    return r;
+}
+
+template<const auto& Net, std::size_t N, typename T> STL_AVX2_TARGET
+std::size_t simd_batch_network_avx2(T* rows, std::size_t count){ return simd_batch_network_kernel<Net, N, T, 32>(rows, count); }
+template<const auto& Net, std::size_t N, typename T> STL_AVX512_TARGET
+std::size_t simd_batch_network_avx512(T* rows, std::size_t count){ return simd_batch_network_kernel<Net, N, T, 64>(rows, count); }
+#endif
+
+// Applies Net to each of the count rows of N elements stored back to back, in parallel chunks of rows
+template<const auto& Net, std::size_t N, typename T>
+void batch_apply_network(T* rows, std::size_t count){
+    parallel_chunks<std::array<T, N>>(count, [&](std::size_t, std::size_t begin, std::size_t end){
+        std::size_t r = begin;
+#if STL_HAS_SIMD
+        if constexpr (is_simd_numeric_v<T>){
+            switch(detect_simd_isa()){
+                case simd_isa::avx512: r += simd_batch_network_avx512<Net, N>(rows + r * N, end - r); break;
+                case simd_isa::avx2:   r += simd_batch_network_avx2<Net, N>(rows + r * N, end - r);   break;
+                case simd_isa::scalar: break;
+            }
+        }
+#endif
+        for(; r < end; ++r) apply_network<Net>(rows + r * N, std::less<>());
+    });
+}
+
+// Sorts each of the count rows of N elements stored back to back in rows
+template<std::size_t N, typename T>
+void batch_network_sort(T* rows, std::size_t count){
+    static_assert(N <= 32, "sorting networks are built for up to 32 elements");
+    batch_apply_network<sorting_network_v<N>, N>(rows, count);
+}
+
+// network_partial_sort<K, N> of each row, e.g. the best K candidates of every row
+template<std::size_t K, std::size_t N, typename T>
+void batch_network_partial_sort(T* rows, std::size_t count){
+    static_assert(K <= N && N <= 32, "sorting networks are built for up to 32 elements");
+    batch_apply_network<selection_network_v<K, N>, N>(rows, count);
+}
+
+// Instrumentation - counted, counting_compare, counting_iterator, counting_allocator, instrument_scope, instrument_report,
+// allocation_limit
+// Counts what an algorithm does to its elements and to the heap. counted<T> elements count their comparisons, copies and
+// moves, counting_compare counts the calls of a comparator, counting_iterator counts the bytes read or written through
+// it, and the global operator new counts allocations. An instrument_scope records the counts, cycles and time between
+// its construction and destruction into an instrument_report, which writes JSON or CSV. Counters are shared by all
+// threads and only move while a scope is open, so a par_ algorithm is counted as a whole, and code outside scopes pays
+// one relaxed load per count. allocation_limit makes larger allocations fail inside scopes, which shows what stable_sort
+// or inplace_merge cost without their buffer. Compiled with -DSTL_INSTRUMENT=0 the wrappers only forward, operator new
+// is not replaced, and reports hold timings with zero counts.
+
+#ifndef STL_INSTRUMENT
+#define STL_INSTRUMENT 1
+#endif
+
+enum class instrument_counter : unsigned {
+    comparisons, copies, moves, allocations, failed_allocations, bytes_allocated, bytes_touched, count
+};
+
+constexpr const char* instrument_counter_names[] = {
+    "comparisons", "copies", "moves", "allocations", "failed_allocations", "bytes_allocated", "bytes_touched"
+};
+
+struct op_counts {
+    std::array<std::uint64_t, static_cast<std::size_t>(instrument_counter::count)> values{};
+
+    std::uint64_t operator[](instrument_counter c) const { return values[static_cast<std::size_t>(c)]; }
+
+    op_counts operator-(const op_counts& other) const {
+        op_counts result;
+        for(std::size_t i = 0; i < values.size(); ++i) result.values[i] = values[i] - other.values[i];
+        return result;
+    }
+};
+
+struct instrument_state {
+    std::atomic<int> open_scopes{0};
+    std::atomic<std::size_t> allocation_limit{std::numeric_limits<std::size_t>::max()};
+    std::atomic<std::uint64_t> counters[static_cast<std::size_t>(instrument_counter::count)] = {};
+};
+
+// Constant-initialized, so operator new can count before main
+inline instrument_state& instrument_globals(){
+    static instrument_state state;
+    return state;
+}
+
+inline void instrument_count(instrument_counter c, std::uint64_t amount = 1){
+#if STL_INSTRUMENT
+    instrument_state& state = instrument_globals();
+    if(state.open_scopes.load(std::memory_order_relaxed) != 0)
+        state.counters[static_cast<std::size_t>(c)].fetch_add(amount, std::memory_order_relaxed);
+#else
+    (void)c;
+    (void)amount;
+#endif
+}
+
+// Counts an allocation of 'bytes'. False, counted as a failed allocation, if it is over the allocation_limit.
+inline bool instrument_allocation(std::size_t bytes){
+#if STL_INSTRUMENT
+    instrument_state& state = instrument_globals();
+    if(state.open_scopes.load(std::memory_order_relaxed) == 0) return true;
+    if(bytes > state.allocation_limit.load(std::memory_order_relaxed)){
+        instrument_count(instrument_counter::failed_allocations);
+        return false;
+    }
+    instrument_count(instrument_counter::allocations);
+    instrument_count(instrument_counter::bytes_allocated, bytes);
+#else
+    (void)bytes;
+#endif
+    return true;
+}
+
+inline op_counts instrument_snapshot(){
+    op_counts counts;
+    instrument_state& state = instrument_globals();
+    for(std::size_t i = 0; i < counts.values.size(); ++i) counts.values[i] = state.counters[i].load(std::memory_order_relaxed);
+    return counts;
+}
+
+// Time stamp counter where there is one (reference cycles, not affected by frequency scaling), nanoseconds otherwise
+inline std::uint64_t cycle_count(){
+#if defined(__GNUC__) && defined(__x86_64__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Element wrapper counting comparisons, copies and moves. Construction from a T is not counted.
+template<typename T>
+class counted {
+public:
+    counted() = default;
+    counted(const T& value) : value(value) {}
+    counted(const counted& other) : value(other.value) { instrument_count(instrument_counter::copies); }
+    counted(counted&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : value(std::move(other.value)) {
+        instrument_count(instrument_counter::moves);
+    }
+
+    counted& operator=(const counted& other){
+        value = other.value;
+        instrument_count(instrument_counter::copies);
+        return *this;
+    }
+    counted& operator=(counted&& other) noexcept(std::is_nothrow_move_assignable_v<T>){
+        value = std::move(other.value);
+        instrument_count(instrument_counter::moves);
+        return *this;
+    }
+
+    const T& get() const { return value; }
+
+    friend bool operator<(const counted& a, const counted& b){ instrument_count(instrument_counter::comparisons); return a.value < b.value; }
+    friend bool operator>(const counted& a, const counted& b){ instrument_count(instrument_counter::comparisons); return b.value < a.value; }
+    friend bool operator<=(const counted& a, const counted& b){ instrument_count(instrument_counter::comparisons); return !(b.value < a.value); }
+    friend bool operator>=(const counted& a, const counted& b){ instrument_count(instrument_counter::comparisons); return !(a.value < b.value); }
+    friend bool operator==(const counted& a, const counted& b){ instrument_count(instrument_counter::comparisons); return a.value == b.value; }
+    friend bool operator!=(const counted& a, const counted& b){ instrument_count(instrument_counter::comparisons); return !(a.value == b.value); }
+
+    friend std::ostream& operator<<(std::ostream& os, const counted& c){ return os << c.value; }
+
+private:
+    T value{};
+};
+
+// Comparator wrapper counting its calls
+template<typename Compare = std::less<>>
+struct counting_compare {
+    Compare comp;
+
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        instrument_count(instrument_counter::comparisons);
+        return comp(a, b);
+    }
+};
+
+// Iterator wrapper counting sizeof(value_type) bytes touched per dereference. Has the category of It.
+template<typename It>
+class counting_iterator {
+public:
+    using iterator_category = typename std::iterator_traits<It>::iterator_category;
+    using value_type = typename std::iterator_traits<It>::value_type;
+    using difference_type = typename std::iterator_traits<It>::difference_type;
+    using pointer = typename std::iterator_traits<It>::pointer;
+    using reference = typename std::iterator_traits<It>::reference;
+
+    counting_iterator() = default;
+    explicit counting_iterator(It it) : it(it) {}
+
+    It base() const { return it; }
+
+    reference operator*() const { touch(); return *it; }
+    It operator->() const { touch(); return it; }
+    reference operator[](difference_type n) const { touch(); return it[n]; }
+
+    counting_iterator& operator++(){ ++it; return *this; }
+    counting_iterator operator++(int){ return counting_iterator(it++); }
+    counting_iterator& operator--(){ --it; return *this; }
+    counting_iterator operator--(int){ return counting_iterator(it--); }
+    counting_iterator& operator+=(difference_type n){ it += n; return *this; }
+    counting_iterator& operator-=(difference_type n){ it -= n; return *this; }
+
+    friend counting_iterator operator+(counting_iterator a, difference_type n){ return a += n; }
+    friend counting_iterator operator+(difference_type n, counting_iterator a){ return a += n; }
+    friend counting_iterator operator-(counting_iterator a, difference_type n){ return a -= n; }
+    friend difference_type operator-(const counting_iterator& a, const counting_iterator& b){ return a.it - b.it; }
+
+    friend bool operator==(const counting_iterator& a, const counting_iterator& b){ return a.it == b.it; }
+    friend bool operator!=(const counting_iterator& a, const counting_iterator& b){ return a.it != b.it; }
+    friend bool operator<(const counting_iterator& a, const counting_iterator& b){ return a.it < b.it; }
+    friend bool operator>(const counting_iterator& a, const counting_iterator& b){ return a.it > b.it; }
+    friend bool operator<=(const counting_iterator& a, const counting_iterator& b){ return a.it <= b.it; }
+    friend bool operator>=(const counting_iterator& a, const counting_iterator& b){ return a.it >= b.it; }
+
+private:
+    static void touch(){ instrument_count(instrument_counter::bytes_touched, sizeof(value_type)); }
+
+    It it{};
+};
+
+// Allocations of one container, counted whether or not a scope is open. Not thread safe, like the container.
+struct allocation_stats {
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+    std::size_t bytes = 0;                  // allocated in total
+    std::size_t live_bytes = 0;
+    std::size_t peak_bytes = 0;             // largest live_bytes
+};
+
+// Allocator wrapper recording into an allocation_stats, e.g. std::vector<int, counting_allocator<int>> v(stats)
+template<typename T, typename Base = std::allocator<T>>
+struct counting_allocator : Base {
+    using value_type = T;
+    template<typename U> struct rebind {
+        using other = counting_allocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+    };
+
+    counting_allocator(allocation_stats& stats, const Base& base = Base()) : Base(base), stats(&stats) {}
+    template<typename U, typename B>
+    counting_allocator(const counting_allocator<U, B>& other) : Base(static_cast<const B&>(other)), stats(other.stats) {}
+
+    T* allocate(std::size_t n){
+        T* p = std::allocator_traits<Base>::allocate(*this, n);
+        ++stats->allocations;
+        stats->bytes += n * sizeof(T);
+        stats->live_bytes += n * sizeof(T);
+        stats->peak_bytes = std::max(stats->peak_bytes, stats->live_bytes);
+        return p;
+    }
+    void deallocate(T* p, std::size_t n){
+        ++stats->deallocations;
+        stats->live_bytes -= n * sizeof(T);
+        std::allocator_traits<Base>::deallocate(*this, p, n);
+    }
+
+    template<typename U, typename B> bool operator==(const counting_allocator<U, B>& other) const {
+        return stats == other.stats && static_cast<const Base&>(*this) == static_cast<const B&>(other);
+    }
+    template<typename U, typename B> bool operator!=(const counting_allocator<U, B>& other) const { return !(*this == other); }
+
+    allocation_stats* stats;
+};
+
+struct instrument_record {
+    std::string name;
+    std::size_t n;
+    op_counts counts;
+    std::uint64_t cycles;
+    double ns;
+};
+
+class instrument_report {
+public:
+    void add(instrument_record record){
+        std::lock_guard<std::mutex> lock(mutex);
+        list.push_back(std::move(record));
+    }
+
+    const std::vector<instrument_record>& records() const { return list; }
+
+    // [{"name": "sort", "n": 1000, "comparisons": 12345, ..., "cycles": 67890, "ns": 12345.0}, ...]
+    void write_json(std::ostream& os) const {
+        os << "[";
+        for(std::size_t r = 0; r < list.size(); ++r){
+            os << (r == 0 ? "\n" : ",\n") << "  {\"name\": \"";
+            for(char c : list[r].name){
+                if(c == '"' || c == '\\') os << '\\';
+                os << c;
+            }
+            os << "\", \"n\": " << list[r].n;
+            for(std::size_t i = 0; i < list[r].counts.values.size(); ++i)
+                os << ", \"" << instrument_counter_names[i] << "\": " << list[r].counts.values[i];
+            os << ", \"cycles\": " << list[r].cycles << ", \"ns\": " << std::fixed << std::setprecision(1) << list[r].ns << "}";
+        }
+        os << "\n]\n";
+    }
+
+    // One header line, then one line per record. Names are quoted.
+    void write_csv(std::ostream& os) const {
+        os << "name,n";
+        for(auto* name : instrument_counter_names) os << "," << name;
+        os << ",cycles,ns\n";
+        for(auto& record : list){
+            os << "\"";
+            for(char c : record.name){
+                if(c == '"') os << '"';
+                os << c;
+            }
+            os << "\"," << record.n;
+            for(auto value : record.counts.values) os << "," << value;
+            os << "," << record.cycles << "," << std::fixed << std::setprecision(1) << record.ns << "\n";
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<instrument_record> list;
+};
+
+// Records what happens from construction to destruction as one record of 'report'. n is the input size.
+class instrument_scope {
+public:
+    instrument_scope(instrument_report& report, std::string name, std::size_t n = 0)
+        : report(report), name(std::move(name)), n(n) {
+        instrument_globals().open_scopes.fetch_add(1, std::memory_order_relaxed);
+        start = instrument_snapshot();
+        start_time = std::chrono::steady_clock::now();
+        start_cycles = cycle_count();
+    }
+
+    ~instrument_scope(){
+        const std::uint64_t cycles = cycle_count() - start_cycles;
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_time;
+        report.add({std::move(name), n, counts(), cycles, elapsed.count()});
+        instrument_globals().open_scopes.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    instrument_scope(const instrument_scope&) = delete;
+    instrument_scope& operator=(const instrument_scope&) = delete;
+
+    // Counted so far
+    op_counts counts() const { return instrument_snapshot() - start; }
+
+private:
+    instrument_report& report;
+    std::string name;
+    std::size_t n;
+    op_counts start;
+    std::chrono::steady_clock::time_point start_time;
+    std::uint64_t start_cycles;
+};
+
+// While alive, allocations of more than 'bytes' inside scopes fail with std::bad_alloc
+class allocation_limit {
+public:
+    explicit allocation_limit(std::size_t bytes) : previous(instrument_globals().allocation_limit.exchange(bytes)) {}
+    ~allocation_limit(){ instrument_globals().allocation_limit.store(previous); }
+
+    allocation_limit(const allocation_limit&) = delete;
+    allocation_limit& operator=(const allocation_limit&) = delete;
+
+private:
+    std::size_t previous;
+};
+
+#if STL_INSTRUMENT
+// Replacements of the global operator new / delete that count into the open scopes. The array, nothrow and sized forms
+// of the standard library forward to these, so std::get_temporary_buffer (stable_sort, inplace_merge) is counted too.
+__attribute__((noinline)) void* operator new(std::size_t bytes){
+    if(!instrument_allocation(bytes)) throw std::bad_alloc();
+    for(;;){
+        if(void* p = std::malloc(bytes == 0 ? 1 : bytes)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if(handler == nullptr){
+            instrument_count(instrument_counter::failed_allocations);
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+__attribute__((noinline)) void* operator new(std::size_t bytes, std::align_val_t alignment){
+    if(!instrument_allocation(bytes)) throw std::bad_alloc();
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    for(;;){
+        if(void* p = std::aligned_alloc(align, (std::max<std::size_t>(bytes, 1) + align - 1) / align * align)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if(handler == nullptr){
+            instrument_count(instrument_counter::failed_allocations);
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+
+// External memory - mapped_file, record_writer, external_sort, external_merge, external_set_intersection,
+// external_set_difference
+// Sorted files of fixed-width records (any trivially copyable T, stored back to back in native byte order) that do not
+// fit in memory. Inputs are mapped read-only and walked in windows: the next window is read ahead with MADV_WILLNEED and
+// the pages behind are dropped with MADV_DONTNEED, so resident memory stays around the window however large the files.
+// Windows are cut at values (every input at the same pivot), so equivalent records are never split between two
+// windows and the results are the same as the std:: algorithms on the whole files. external_sort sorts runs of half
+// the memory budget with par_sort (the other half is the sort's scratch space), writes them to temporary files and
+// merges them with kway_merge, in several passes when there are more than max_fan_in runs. Errors throw
+// std::system_error.
+
+#if defined(__unix__) || defined(__APPLE__)
+#define STL_HAS_MMAP 1
+#else
+#define STL_HAS_MMAP 0
+#endif
+
+#if STL_HAS_MMAP
+struct external_config {
+    std::size_t memory_bytes = std::size_t(1) << 30;    // run buffer of external_sort, plus the sort's scratch space
+    std::size_t window_bytes = std::size_t(64) << 20;   // of all inputs together, resident at a time while merging
+    std::size_t io_buffer_bytes = std::size_t(1) << 20; // output buffer
+    std::size_t max_fan_in = 64;                        // runs merged in one pass
+    std::string temp_dir;                               // for the runs of external_sort; empty = next to the output
+};
+
+// Read-only mapping of a whole file
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& path){
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+        struct stat info;
+        if(::fstat(fd, &info) != 0){
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "stat " + path);
+        }
+        bytes = static_cast<std::size_t>(info.st_size);
+        if(bytes != 0){
+            void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if(p == MAP_FAILED){
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap " + path);
+            }
+            base = static_cast<char*>(p);
+        }
+        ::close(fd);
+    }
+
+    mapped_file(mapped_file&& other) noexcept : base(std::exchange(other.base, nullptr)), bytes(std::exchange(other.bytes, 0)) {}
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        std::swap(base, other.base);
+        std::swap(bytes, other.bytes);
+        return *this;
+    }
+    ~mapped_file(){ if(base != nullptr) ::munmap(base, bytes); }
+
+    const char* data() const { return base; }
+    std::size_t size() const { return bytes; }
+
+    // The file as records of T; throws if its size is not a multiple of sizeof(T)
+    template<typename T>
+    std::pair<const T*, const T*> records() const {
+        static_assert(std::is_trivially_copyable_v<T>, "records are read as raw bytes");
+        if(bytes % sizeof(T) != 0) throw std::runtime_error("file size is not a multiple of the record size");
+        const T* first = reinterpret_cast<const T*>(base);
+        return {first, first + bytes / sizeof(T)};
+    }
+
+    // madvise on the pages overlapping [offset, offset + length)
+    void advise(std::size_t offset, std::size_t length, int advice) const {
+        if(base == nullptr || offset >= bytes) return;
+        const std::size_t page = page_size();
+        const std::size_t begin = offset / page * page, end = std::min(bytes, offset + length);
+        if(end > begin) ::madvise(base + begin, end - begin, advice);
+    }
+
+    void sequential() const { advise(0, bytes, MADV_SEQUENTIAL); }
+    void will_need(std::size_t offset, std::size_t length) const { advise(offset, length, MADV_WILLNEED); }
+
+    // Drops the pages inside [offset, offset + length); they are read from the file again if touched
+    void release(std::size_t offset, std::size_t length) const {
+        const std::size_t page = page_size();
+        const std::size_t begin = (offset + page - 1) / page * page, end = (offset + length) / page * page;
+        if(base != nullptr && end > begin && end <= bytes) ::madvise(base + begin, end - begin, MADV_DONTNEED);
+    }
+
+    static std::size_t page_size(){
+        static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+private:
+    char* base = nullptr;
+    std::size_t bytes = 0;
+};
+
+// Buffered writer of records to a new file (an existing one is truncated)
+template<typename T>
+class record_writer {
+public:
+    explicit record_writer(const std::string& path, std::size_t buffer_bytes = std::size_t(1) << 20)
+        : path(path), buffer(std::max<std::size_t>(1, buffer_bytes / sizeof(T))) {
+        static_assert(std::is_trivially_copyable_v<T>, "records are written as raw bytes");
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    record_writer(const record_writer&) = delete;
+    record_writer& operator=(const record_writer&) = delete;
+
+    // Best effort; call close() to see errors
+    ~record_writer(){
+        if(fd < 0) return;
+        try { flush(); } catch(...) {}
+        ::close(fd);
+    }
+
+    void push(const T& record){
+        if(count == buffer.size()) flush();
+        buffer[count++] = record;
+    }
+
+    // Large blocks skip the buffer
+    void write(const T* records, std::size_t n){
+        if(n < buffer.size()){
+            for(std::size_t i = 0; i < n; ++i) push(records[i]);
+            return;
+        }
+        flush();
+        write_bytes(reinterpret_cast<const char*>(records), n * sizeof(T));
+        written += n;
+    }
+
+    void flush(){
+        write_bytes(reinterpret_cast<const char*>(buffer.data()), count * sizeof(T));
+        written += count;
+        count = 0;
+    }
+
+    void close(){
+        flush();
+        const int result = ::close(fd);
+        fd = -1;
+        if(result != 0) throw std::system_error(errno, std::generic_category(), "close " + path);
+    }
+
+    // Records written so far
+    std::uint64_t size() const { return written + count; }
+
+    class iterator {
+    public:
+        using iterator_category = std::output_iterator_tag;
+        using value_type = void;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = void;
+
+        explicit iterator(record_writer& writer) : writer(&writer) {}
+        iterator& operator*(){ return *this; }
+        iterator& operator++(){ return *this; }
+        iterator& operator++(int){ return *this; }
+        iterator& operator=(const T& record){ writer->push(record); return *this; }
+
+    private:
+        record_writer* writer;
+    };
+
+    iterator out(){ return iterator(*this); }
+
+private:
+    void write_bytes(const char* p, std::size_t n){
+        while(n > 0){
+            const ssize_t done = ::write(fd, p, n);
+            if(done < 0){
+                if(errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "write " + path);
+            }
+            p += done;
+            n -= static_cast<std::size_t>(done);
+        }
+    }
+
+    std::string path;
+    std::vector<T> buffer;
+    std::size_t count = 0;
+    std::uint64_t written = 0;
+    int fd = -1;
+};
+
+// Calls step(slices) on consecutive slices of the sorted inputs, at most 'window' records of each unless they are all
+// equivalent. Slices are cut before the same pivot in every input, so equivalent records are always in the same step.
+template<typename T, typename Compare, typename Step>
+void for_each_window(const std::vector<mapped_file>& files, std::size_t window, Compare& comp, Step step){
+    const std::size_t k = files.size();
+    std::vector<const T*> first(k), pos(k), end(k);
+    for(std::size_t i = 0; i < k; ++i){
+        std::tie(first[i], end[i]) = files[i].template records<T>();
+        pos[i] = first[i];
+        files[i].sequential();
+        files[i].will_need(0, window * sizeof(T));
+    }
+
+    std::vector<std::pair<const T*, const T*>> slices(k);
+    std::vector<const T*> cut(k);
+    for(;;){
+        // Smallest record at 'window' past the position of an input; everything before it fits the windows
+        const T* pivot = nullptr;
+        for(std::size_t i = 0; i < k; ++i)
+            if(std::size_t(end[i] - pos[i]) > window && (pivot == nullptr || comp(pos[i][window], *pivot))) pivot = pos[i] + window;
+
+        if(pivot == nullptr) cut = end;
+        else {
+            const T value = *pivot;
+            bool progress = false;
+            for(std::size_t i = 0; i < k; ++i){
+                cut[i] = std::lower_bound(pos[i], pos[i] + std::min<std::size_t>(end[i] - pos[i], window + 1), value, comp);
+                progress |= cut[i] != pos[i];
+            }
+            // Every input starts with a run of records equivalent to the pivot, which goes whole
+            if(!progress) for(std::size_t i = 0; i < k; ++i) cut[i] = std::upper_bound(pos[i], end[i], value, comp);
+        }
+
+        for(std::size_t i = 0; i < k; ++i){
+            slices[i] = {pos[i], cut[i]};
+            files[i].will_need((cut[i] - first[i]) * sizeof(T), window * sizeof(T));
+        }
+        step(slices);
+        for(std::size_t i = 0; i < k; ++i){
+            files[i].release((pos[i] - first[i]) * sizeof(T), (cut[i] - pos[i]) * sizeof(T));
+            pos[i] = cut[i];
+        }
+        if(pivot == nullptr) return;
+    }
+}
+
+// Merges the sorted files 'inputs' into 'output'; returns the number of records written
+template<typename T, typename Compare = std::less<>>
+std::uint64_t external_kway_merge(const std::vector<std::string>& inputs, const std::string& output,
+                                  const external_config& config = external_config(), Compare comp = Compare()){
+    std::vector<mapped_file> files;
+    for(auto& path : inputs) files.emplace_back(path);
+    const std::size_t window = std::max<std::size_t>(1, config.window_bytes / sizeof(T) / std::max<std::size_t>(1, files.size()));
+
+    record_writer<T> writer(output, config.io_buffer_bytes);
+    std::vector<T> merged;
+    for_each_window<T>(files, window, comp, [&](const std::vector<std::pair<const T*, const T*>>& slices){
+        std::size_t n = 0;
+        for(auto& slice : slices) n += slice.second - slice.first;
+        merged.resize(n);
+        par_kway_merge(slices, merged.begin(), comp);
+        writer.write(merged.data(), n);
+    });
+    writer.close();
+    return writer.size();
+}
+
+// Sorts the records of 'input' into 'output' (which may be the same file) with bounded memory
+template<typename T, typename Compare = std::less<>>
+std::uint64_t external_sort(const std::string& input, const std::string& output,
+                            const external_config& config = external_config(), Compare comp = Compare()){
+    // Temporary files, removed however the sort ends
+    struct run_files {
+        std::vector<std::string> paths;
+        ~run_files(){ for(auto& path : paths) ::unlink(path.c_str()); }
+    } runs;
+
+    std::string prefix = config.temp_dir.empty() ? output : config.temp_dir + "/" + output.substr(output.find_last_of('/') + 1);
+    prefix += ".run" + std::to_string(::getpid()) + ".";
+    std::size_t next_run = 0;
+
+    {
+        mapped_file in(input);
+        const auto records = in.template records<T>();
+        const std::size_t n = records.second - records.first;
+        const std::size_t run_size = std::max<std::size_t>(1, config.memory_bytes / 2 / sizeof(T));
+        in.sequential();
+
+        std::vector<T> buffer;
+        for(std::size_t begin = 0; begin < n || begin == 0; begin += run_size){
+            const std::size_t end = std::min(n, begin + run_size);
+            in.will_need(end * sizeof(T), run_size * sizeof(T));
+            buffer.assign(records.first + begin, records.first + end);
+            in.release(begin * sizeof(T), (end - begin) * sizeof(T));
+            par_sort(buffer.begin(), buffer.end(), comp);
+
+            // A single run is the result
+            if(begin == 0 && end == n){
+                record_writer<T> writer(output, config.io_buffer_bytes);
+                writer.write(buffer.data(), buffer.size());
+                writer.close();
+                return n;
+            }
+            runs.paths.push_back(prefix + std::to_string(next_run++));
+            record_writer<T> writer(runs.paths.back(), config.io_buffer_bytes);
+            writer.write(buffer.data(), buffer.size());
+            writer.close();
+        }
+    }
+
+    // Merge passes until one pass can merge everything into the output
+    const std::size_t fan_in = std::max<std::size_t>(2, config.max_fan_in);
+    std::size_t first = 0;
+    while(runs.paths.size() - first > fan_in){
+        const std::size_t last = runs.paths.size();
+        for(std::size_t group = first; group < last; group += fan_in){
+            std::vector<std::string> inputs(runs.paths.begin() + group, runs.paths.begin() + std::min(last, group + fan_in));
+            runs.paths.push_back(prefix + std::to_string(next_run++));
+            external_kway_merge<T>(inputs, runs.paths.back(), config, comp);
+            for(auto& path : inputs) ::unlink(path.c_str());
+        }
+        first = last;
+    }
+    return external_kway_merge<T>(std::vector<std::string>(runs.paths.begin() + first, runs.paths.end()), output, config, comp);
+}
+
+// Runs op(first1, last1, first2, last2, out) of a std:: set algorithm window by window over two sorted files
+template<typename T, typename Compare, typename Op>
+std::uint64_t external_set_operation(const std::string& a, const std::string& b, const std::string& output,
+                                     const external_config& config, Compare& comp, Op op){
+    std::vector<mapped_file> files;
+    files.emplace_back(a);
+    files.emplace_back(b);
+    record_writer<T> writer(output, config.io_buffer_bytes);
+    for_each_window<T>(files, std::max<std::size_t>(1, config.window_bytes / sizeof(T) / 2), comp,
+                       [&](const std::vector<std::pair<const T*, const T*>>& slices){
+        op(slices[0].first, slices[0].second, slices[1].first, slices[1].second, writer.out());
+    });
+    writer.close();
+    return writer.size();
+}
+
+// std::merge of two sorted files
+template<typename T, typename Compare = std::less<>>
+std::uint64_t external_merge(const std::string& a, const std::string& b, const std::string& output,
+                             const external_config& config = external_config(), Compare comp = Compare()){
+    return external_kway_merge<T>({a, b}, output, config, comp);
+}
+
+// std::set_intersection of two sorted files: records of a that have an equivalent in b
+template<typename T, typename Compare = std::less<>>
+std::uint64_t external_set_intersection(const std::string& a, const std::string& b, const std::string& output,
+                                        const external_config& config = external_config(), Compare comp = Compare()){
+    return external_set_operation<T>(a, b, output, config, comp, [&](auto... args){ std::set_intersection(args..., comp); });
+}
+
+// std::set_difference of two sorted files: records of a without an equivalent in b, e.g. the keys removed between two
+// snapshots
+template<typename T, typename Compare = std::less<>>
+std::uint64_t external_set_difference(const std::string& a, const std::string& b, const std::string& output,
+                                      const external_config& config = external_config(), Compare comp = Compare()){
+    return external_set_operation<T>(a, b, output, config, comp, [&](auto... args){ std::set_difference(args..., comp); });
+}
+#endif
+
+// String sorting - string_sort, stable_sort_by_length, string_table, merge_string_tables, fast_lexicographical_compare,
+// fast_mismatch
+// string_sort orders strings like std::sort with operator<, without dereferencing two heap blocks per comparison: it
+// caches the next 8 bytes of every string as a big-endian integer, sorts by that integer (radix sort on large groups),
+// and only the groups whose 8 bytes are all equal go on, recursively, to the next 8 bytes (MSD radix sort). Strings that
+// end inside the 8 bytes come first in their group, shortest first. The sort works on (prefix, view, index) items; the
+// strings themselves are only moved at the end, out to a buffer in sorted order and back, two moves each.
+// string_table packs many strings into one character buffer as (offset, length) entries, so a table of a hundred
+// million keys is two allocations, and sorting or merging tables only moves the 16 byte entries.
+
+// 8 bytes of s from 'depth' on, zero padded, as an integer that orders like the bytes (unsigned, as in std::string)
+inline std::uint64_t string_prefix(std::string_view s, std::size_t depth){
+    unsigned char bytes[8] = {};
+    if(depth < s.size()) std::memcpy(bytes, s.data() + depth, std::min<std::size_t>(8, s.size() - depth));
+    std::uint64_t prefix = 0;
+    for(unsigned char b : bytes) prefix = prefix << 8 | b;
+    return prefix;
+}
+
+struct string_item {
+    std::uint64_t prefix;
+    std::string_view text;
+    std::size_t index;                      // position before sorting
+};
+
+// Sorts items whose texts agree on their first 'depth' bytes
+inline void string_msd_sort(string_item* items, std::size_t n, std::size_t depth){
+    if(n < 32){
+        for(std::size_t i = 1; i < n; ++i){
+            string_item x = items[i];
+            std::size_t j = i;
+            for(; j > 0 && x.text.substr(depth) < items[j - 1].text.substr(depth); --j) items[j] = items[j - 1];
+            items[j] = x;
+        }
+        return;
+    }
+
+    for(std::size_t i = 0; i < n; ++i) items[i].prefix = string_prefix(items[i].text, depth);
+    if(n >= (1 << 16)) radix_sort_items(items, n, [](const string_item& x){ return x.prefix; });
+    else std::sort(items, items + n, [](const string_item& a, const string_item& b){ return a.prefix < b.prefix; });
+
+    // Groups of equal prefixes: strings that end within these 8 bytes first, by length, then the rest one level down
+    std::vector<std::pair<std::size_t, std::size_t>> deeper;
+    for(std::size_t begin = 0, end; begin < n; begin = end){
+        end = begin + 1;
+        while(end < n && items[end].prefix == items[begin].prefix) ++end;
+        if(end - begin < 2) continue;
+        string_item* rest = std::partition(items + begin, items + end, [&](const string_item& x){ return x.text.size() <= depth + 8; });
+        std::sort(items + begin, rest, [](const string_item& a, const string_item& b){ return a.text.size() < b.text.size(); });
+        if(items + end - rest > 1) deeper.push_back({static_cast<std::size_t>(rest - items), end});
+    }
+    auto recurse = [&](std::size_t g){ string_msd_sort(items + deeper[g].first, deeper[g].second - deeper[g].first, depth + 8); };
+    if(n >= (1 << 16)) default_thread_pool().parallel_for(deeper.size(), recurse);
+    else for(std::size_t g = 0; g < deeper.size(); ++g) recurse(g);
+}
+
+// Same result as std::sort(first, last) for ranges of std::string (or anything with data() and size() of chars)
+template<typename RandomIt>
+void string_sort(RandomIt first, RandomIt last){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    if(n < 32){
+        std::sort(first, last);
+        return;
+    }
+    std::vector<string_item> items(n);
+    for(std::size_t i = 0; i < n; ++i) items[i] = {0, std::string_view(first[i].data(), first[i].size()), i};
+    string_msd_sort(items.data(), n, 0);
+
+    std::vector<T> sorted;
+    sorted.reserve(n);
+    for(auto& item : items) sorted.push_back(std::move(first[item.index]));
+    std::move(sorted.begin(), sorted.end(), first);
+}
+
+// Same result as std::stable_sort by size(): a counting sort on the lengths, one pass to count and one to move
+template<typename RandomIt>
+void stable_sort_by_length(RandomIt first, RandomIt last){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const std::size_t n = last - first;
+    std::size_t longest = 0;
+    for(auto it = first; it != last; ++it) longest = std::max<std::size_t>(longest, it->size());
+    // Lengths spread far wider than the count are better sorted by comparison
+    if(longest > 4 * n + 256){
+        std::stable_sort(first, last, [](const T& a, const T& b){ return a.size() < b.size(); });
+        return;
+    }
+    std::vector<std::size_t> start(longest + 2, 0);
+    for(auto it = first; it != last; ++it) ++start[it->size() + 1];
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    std::vector<T> sorted(n);
+    for(auto it = first; it != last; ++it) sorted[start[it->size()]++] = std::move(*it);
+    std::move(sorted.begin(), sorted.end(), first);
+}
+
+class string_table {
+public:
+    void reserve(std::size_t strings, std::size_t bytes){
+        entries.reserve(strings);
+        chars.reserve(bytes);
+    }
+
+    void push_back(std::string_view s){
+        entries.push_back({chars.size(), s.size()});
+        chars.append(s);
+    }
+
+    std::string_view operator[](std::size_t i) const { return std::string_view(chars.data() + entries[i].offset, entries[i].size); }
+    std::size_t size() const { return entries.size(); }
+    std::size_t bytes() const { return chars.size(); }
+
+    // Sorts the entries; the characters stay where they are
+    void sort(){
+        std::vector<string_item> items(entries.size());
+        for(std::size_t i = 0; i < items.size(); ++i) items[i] = {0, (*this)[i], i};
+        string_msd_sort(items.data(), items.size(), 0);
+        std::vector<entry> sorted(entries.size());
+        for(std::size_t i = 0; i < items.size(); ++i) sorted[i] = entries[items[i].index];
+        entries.swap(sorted);
+    }
+
+    bool is_sorted() const {
+        for(std::size_t i = 1; i < size(); ++i) if((*this)[i] < (*this)[i - 1]) return false;
+        return true;
+    }
+
+private:
+    friend string_table merge_string_tables(const string_table& a, const string_table& b);
+
+    struct entry {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    std::string chars;
+    std::vector<entry> entries;
+};
+
+// std::merge of two sorted tables into a new one, equal strings of a first. Most comparisons are decided by the cached
+// first 8 bytes of both strings, without touching the characters.
+string_table merge_string_tables(const string_table& a, const string_table& b){
+    string_table merged;
+    merged.reserve(a.size() + b.size(), a.bytes() + b.bytes());
+    std::size_t i = 0, j = 0;
+    std::uint64_t pa = i < a.size() ? string_prefix(a[i], 0) : 0, pb = j < b.size() ? string_prefix(b[j], 0) : 0;
+    while(i < a.size() && j < b.size()){
+        const bool take_b = pb < pa || (pb == pa && b[j] < a[i]);
+        if(take_b){
+            merged.push_back(b[j]);
+            if(++j < b.size()) pb = string_prefix(b[j], 0);
+        }
+        else {
+            merged.push_back(a[i]);
+            if(++i < a.size()) pa = string_prefix(a[i], 0);
+        }
+    }
+    for(; i < a.size(); ++i) merged.push_back(a[i]);
+    for(; j < b.size(); ++j) merged.push_back(b[j]);
+    return merged;
+}
+
+// Same result as std::mismatch / std::lexicographical_compare. Contiguous ranges of an arithmetic type (std::string,
+// std::vector<char>, byte buffers) find the first difference with simd_mismatch, a whole vector of bytes at a time, and
+// then compare that one element, so signed char keeps its signed order.
+template<typename InputIt1, typename InputIt2>
+std::pair<InputIt1, InputIt2> fast_mismatch(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2){
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<InputIt1>::iterator_category> &&
+                  std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<InputIt2>::iterator_category>){
+        const auto n = std::min<std::ptrdiff_t>(last1 - first1, last2 - first2);
+        return simd_mismatch(first1, first1 + n, first2);
+    }
+    else return std::mismatch(first1, last1, first2, last2);
+}
+
+template<typename InputIt1, typename InputIt2>
+bool fast_lexicographical_compare(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2){
+    const auto diff = fast_mismatch(first1, last1, first2, last2);
+    if(diff.second == last2) return false;
+    return diff.first == last1 || *diff.first < *diff.second;
+}
+
+// Hash grouping - hash_count, par_hash_unique, hash_find_duplicate, hash_membership
+// The hashed counterparts of sorting first and then calling equal_range, count, unique or adjacent_find: group-by counts,
+// distinct elements, the first repeated element and membership tests in one pass over unsorted input, on position_set.
+// Large inputs are built in parallel: every element is hashed once, positions are scattered into partitions by bits of
+// the hash that position_set does not use to pick slots, and every partition gets its own table on the thread pool, so
+// no table is shared between threads. A partition keeps its positions in input order, so the first occurrence of every
+// element is the one the sequential pass finds, and results are the same, in input order, on any number of threads.
+
+constexpr std::size_t hash_parallel_threshold = 1 << 16;
+
+inline std::size_t hash_partition(std::uint64_t hash, std::size_t partitions){
+    return (position_set::scramble(hash) >> 7) & (partitions - 1);
+}
+
+// One position_set per partition of the hashes. visit(i, p) is called for every position i, with p the first position
+// of an element equal to first[i]; in input order within a partition, for different partitions concurrently.
+template<typename RandomIt, typename Hash, typename KeyEqual, typename Visit>
+std::vector<position_set> build_hash_partitions(RandomIt first, std::size_t n, Hash& hash, KeyEqual& eq, Visit visit){
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if(n < hash_parallel_threshold || default_thread_pool().size() == 1){
+        std::vector<position_set> tables(1);
+        for(std::size_t i = 0; i < n; ++i)
+            visit(i, tables[0].insert(hash(first[i]), i, [&](std::size_t p){ return eq(first[p], first[i]); }));
+        return tables;
+    }
+
+    // About 16K elements per partition, so a table stays in L2 while it is built. The hashes are scattered with their
+    // positions, so building a table reads its partition sequentially.
+    std::size_t partitions = 16;
+    while(partitions < 256 && partitions * 16384 < n) partitions *= 2;
+    const std::size_t chunk = parallel_chunk_elements<T>();
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+    struct hashed_position { std::uint64_t hash; std::size_t pos; };
+    std::vector<std::uint64_t> hashes(n);
+    std::vector<hashed_position> order(n);
+    std::vector<std::size_t> next(chunks * partitions, 0), start(partitions + 1, 0);
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        std::size_t* count = &next[c * partitions];
+        for(std::size_t i = begin; i < end; ++i){
+            hashes[i] = hash(first[i]);
+            ++count[hash_partition(hashes[i], partitions)];
+        }
+    });
+    // Partition major, chunk minor offsets keep every partition in input order
+    for(std::size_t p = 0, sum = 0; p < partitions; ++p){
+        start[p] = sum;
+        for(std::size_t c = 0; c < chunks; ++c){
+            const std::size_t count = next[c * partitions + p];
+            next[c * partitions + p] = sum;
+            sum += count;
+        }
+    }
+    start[partitions] = n;
+    parallel_chunks<T>(n, [&](std::size_t c, std::size_t begin, std::size_t end){
+        std::size_t* out = &next[c * partitions];
+        for(std::size_t i = begin; i < end; ++i) order[out[hash_partition(hashes[i], partitions)]++] = {hashes[i], i};
+    });
+
+    std::vector<position_set> tables(partitions);
+    default_thread_pool().parallel_for(partitions, [&](std::size_t p){
+        for(std::size_t k = start[p]; k < start[p + 1]; ++k){
+            const auto [h, i] = order[k];
+            visit(i, tables[p].insert(h, i, [&](std::size_t q){ return eq(first[q], first[i]); }));
+        }
+    });
+    return tables;
+}
+
+// counts[i] = the number of elements equal to first[i] if i is the first of them, 0 otherwise
+template<typename RandomIt, typename Hash, typename KeyEqual>
+std::vector<std::size_t> hash_first_counts(RandomIt first, std::size_t n, Hash& hash, KeyEqual& eq){
+    std::vector<std::size_t> counts(n, 0);
+    build_hash_partitions(first, n, hash, eq, [&](std::size_t, std::size_t p){ ++counts[p]; });
+    return counts;
+}
+
+// hash_count - every distinct element with its number of occurrences, in order of first occurrence (group by + count)
+template<typename RandomIt, typename Hash = std::hash<typename std::iterator_traits<RandomIt>::value_type>,
+         typename KeyEqual = std::equal_to<>>
+std::vector<std::pair<typename std::iterator_traits<RandomIt>::value_type, std::size_t>>
+hash_count(RandomIt first, RandomIt last, Hash hash = Hash(), KeyEqual eq = KeyEqual()){
+    const std::size_t n = last - first;
+    const std::vector<std::size_t> counts = hash_first_counts(first, n, hash, eq);
+    std::vector<std::pair<typename std::iterator_traits<RandomIt>::value_type, std::size_t>> groups;
+    for(std::size_t i = 0; i < n; ++i)
+        if(counts[i] != 0) groups.emplace_back(first[i], counts[i]);
+    return groups;
+}
+
+// par_hash_unique - same result as hash_unique, built in partitions on the thread pool for large ranges
+template<typename RandomIt, typename Hash = std::hash<typename std::iterator_traits<RandomIt>::value_type>,
+         typename KeyEqual = std::equal_to<>>
+RandomIt par_hash_unique(RandomIt first, RandomIt last, Hash hash = Hash(), KeyEqual eq = KeyEqual()){
+    const std::size_t n = last - first;
+    if(n < hash_parallel_threshold || default_thread_pool().size() == 1) return hash_unique(first, last, hash, eq);
+    const std::vector<std::size_t> counts = hash_first_counts(first, n, hash, eq);
+    RandomIt out = first;
+    for(std::size_t i = 0; i < n; ++i){
+        if(counts[i] == 0) continue;
+        if(out != first + i) *out = std::move(first[i]);
+        ++out;
+    }
+    return out;
+}
+
+// hash_find_duplicate - the first element equal to an earlier one, last if all are distinct. adjacent_find for unsorted
+// input: stops at the first repeat, so it does not build the whole table when there is an early one.
+template<typename RandomIt, typename Hash = std::hash<typename std::iterator_traits<RandomIt>::value_type>,
+         typename KeyEqual = std::equal_to<>>
+RandomIt hash_find_duplicate(RandomIt first, RandomIt last, Hash hash = Hash(), KeyEqual eq = KeyEqual()){
+    position_set seen;
+    const std::size_t n = last - first;
+    for(std::size_t i = 0; i < n; ++i)
+        if(seen.insert(hash(first[i]), i, [&](std::size_t p){ return eq(first[p], first[i]); }) != i) return first + i;
+    return last;
+}
+
+// hash_membership - writes, for every query, whether it equals an element of [first, last). Queries are answered in
+// parallel when there are many and the output is random access.
+template<typename RandomIt, typename QueryIt, typename OutputIt,
+         typename Hash = std::hash<typename std::iterator_traits<RandomIt>::value_type>, typename KeyEqual = std::equal_to<>>
+OutputIt hash_membership(RandomIt first, RandomIt last, QueryIt queries_first, QueryIt queries_last, OutputIt out,
+                         Hash hash = Hash(), KeyEqual eq = KeyEqual()){
+    using Q = typename std::iterator_traits<QueryIt>::value_type;
+    const std::vector<position_set> tables = build_hash_partitions(first, last - first, hash, eq, [](std::size_t, std::size_t){});
+    auto contains = [&](const Q& q){
+        const std::uint64_t h = hash(q);
+        return tables[tables.size() == 1 ? 0 : hash_partition(h, tables.size())].find(h, [&](std::size_t p){ return eq(first[p], q); })
+               != position_set::npos;
+    };
+    if constexpr (is_random_access_iterator_v<QueryIt> && is_random_access_iterator_v<OutputIt>){
+        const std::size_t m = queries_last - queries_first;
+        if(m >= hash_parallel_threshold){
+            parallel_chunks<Q>(m, [&](std::size_t, std::size_t begin, std::size_t end){
+                for(std::size_t j = begin; j < end; ++j) out[j] = contains(queries_first[j]);
+            });
+            return out + m;
+        }
+    }
+    for(; queries_first != queries_last; ++queries_first) *out++ = contains(*queries_first);
+    return out;
+}
+
+// Lazy order - merge_unsorted_tail, repair_sorted, heapify_tail, repair_heap, lazy_sorted_vector, lazy_heap
+// For append-mostly data that is queried now and then. Only the part past the "in order up to here" watermark is
+// fixed: a sorted prefix gets its unsorted tail sorted on its own and merged in from the first prefix element above
+// the smallest new one; a heap gets its new elements sifted in by Floyd's bottom-up construction restricted to their
+// ancestors, O(k + log^2 n) for k new elements instead of O(n) for make_heap. repair_sorted / repair_heap find the
+// watermark with is_sorted_until / is_heap_until; lazy_sorted_vector and lazy_heap keep it, so appends are O(1), the
+// first query after a batch of appends pays for that batch only, and the queries after it pay nothing.
+
+// Sorts [first, last) when [first, sorted_until) is already sorted. A tail that continues in order is only scanned.
+template<typename RandomIt, typename Compare = std::less<>>
+void merge_unsorted_tail(RandomIt first, RandomIt sorted_until, RandomIt last, Compare comp = Compare()){
+    sorted_until = std::is_sorted_until(sorted_until == first ? first : sorted_until - 1, last, comp);
+    if(sorted_until == last) return;
+    par_sort(sorted_until, last, comp);
+    std::inplace_merge(std::upper_bound(first, sorted_until, *sorted_until, comp), sorted_until, last, comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<>>
+void repair_sorted(RandomIt first, RandomIt last, Compare comp = Compare()){
+    merge_unsorted_tail(first, std::is_sorted_until(first, last, comp), last, comp);
+}
+
+// Makes [first, last) a heap when [first, heap_until) is one, like std::make_heap (same layout as the std:: heap
+// algorithms). When the new elements are all leaves, only their ancestors are sifted down, one level at a time.
+template<typename RandomIt, typename Compare = std::less<>>
+void heapify_tail(RandomIt first, RandomIt heap_until, RandomIt last, Compare comp = Compare()){
+    const std::size_t n = last - first;
+    std::size_t lo = heap_until - first;
+    while(lo < n && (lo == 0 || !comp(first[(lo - 1) / 2], first[lo]))) ++lo;
+    if(lo == n) return;
+    if(lo <= (n - 2) / 2){
+        dary_make_heap<2>(first, last, comp);
+        return;
+    }
+    for(std::size_t hi = n - 1; hi > 0;){
+        lo = lo == 0 ? 0 : (lo - 1) / 2;
+        hi = (hi - 1) / 2;
+        for(std::size_t i = hi + 1; i-- > lo;) dary_sift_down<2>(first, n, i, std::move(first[i]), comp);
+    }
+}
+
+template<typename RandomIt, typename Compare = std::less<>>
+void repair_heap(RandomIt first, RandomIt last, Compare comp = Compare()){
+    heapify_tail(first, std::is_heap_until(first, last, comp), last, comp);
+}
+
+// lazy_sorted_vector - a vector that is sorted when it is searched. Appends are O(1); an append that is not less than
+// the last element (events arriving in time order) keeps the vector sorted and only moves the watermark.
+template<typename T, typename Compare = std::less<T>>
+class lazy_sorted_vector {
+public:
+    using value_type = T;
+    using iterator = typename std::vector<T>::const_iterator;
+    using const_iterator = iterator;
+
+    explicit lazy_sorted_vector(Compare comp = Compare()) : comp(comp) {}
+
+    template<typename InputIt>
+    lazy_sorted_vector(InputIt first, InputIt last, Compare comp = Compare()) : comp(comp), values(first, last) {}
+
+    std::size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+    void reserve(std::size_t n){ values.reserve(n); }
+    void clear(){
+        values.clear();
+        sorted = 0;
+    }
+
+    // Number of leading elements known to be in order
+    std::size_t sorted_until() const { return sorted; }
+
+    void push_back(T value){
+        if(sorted == values.size() && (values.empty() || !comp(value, values.back()))) ++sorted;
+        values.push_back(std::move(value));
+    }
+
+    template<typename InputIt>
+    void append(InputIt first, InputIt last){ values.insert(values.end(), first, last); }
+
+    // Sorts what was appended since the last repair and merges it in. Every query below calls it first.
+    void repair(){
+        merge_unsorted_tail(values.begin(), values.begin() + sorted, values.end(), comp);
+        sorted = values.size();
+    }
+
+    iterator lower_bound(const T& x){
+        repair();
+        return std::lower_bound(values.cbegin(), values.cend(), x, comp);
+    }
+    iterator upper_bound(const T& x){
+        repair();
+        return std::upper_bound(values.cbegin(), values.cend(), x, comp);
+    }
+    std::pair<iterator, iterator> equal_range(const T& x){
+        repair();
+        return std::equal_range(values.cbegin(), values.cend(), x, comp);
+    }
+    bool contains(const T& x){
+        repair();
+        return std::binary_search(values.cbegin(), values.cend(), x, comp);
+    }
+    std::size_t count(const T& x){
+        auto range = equal_range(x);
+        return range.second - range.first;
+    }
+    const std::vector<T>& sorted_data(){
+        repair();
+        return values;
+    }
+
+    // Elements in their current order: sorted up to sorted_until(), then in order of appending
+    iterator begin() const { return values.begin(); }
+    iterator end() const { return values.end(); }
+
+private:
+    Compare comp;
+    std::vector<T> values;
+    std::size_t sorted = 0;
+};
+
+// lazy_heap - priority queue whose pushes are O(1) appends; top() and pop() first heapify what was pushed since the
+// last of them (top() is the largest element for std::less)
+template<typename T, typename Compare = std::less<T>>
+class lazy_heap {
+public:
+    explicit lazy_heap(Compare comp = Compare()) : comp(comp) {}
+
+    bool empty() const { return values.empty(); }
+    std::size_t size() const { return values.size(); }
+    void reserve(std::size_t n){ values.reserve(n); }
+
+    // Number of leading elements known to form a heap
+    std::size_t heap_until() const { return heap; }
+
+    void push(T value){ values.push_back(std::move(value)); }
+
+    template<typename InputIt>
+    void push_many(InputIt first, InputIt last){ values.insert(values.end(), first, last); }
+
+    void repair(){
+        heapify_tail(values.begin(), values.begin() + heap, values.end(), comp);
+        heap = values.size();
+    }
+
+    const T& top(){
+        repair();
+        return values.front();
+    }
+
+    void pop(){
+        repair();
+        std::pop_heap(values.begin(), values.end(), comp);
+        values.pop_back();
+        heap = values.size();
+    }
+
+    // Elements in heap order up to heap_until(), then in order of pushing
+    auto begin() const { return values.begin(); }
+    auto end() const { return values.end(); }
+
+private:
+    Compare comp;
+    std::vector<T> values;
+    std::size_t heap = 0;
+};
+
 void heap_algorithms(){
     std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 9, 10};
 
@@ -197,6 +6434,25 @@ void permutation_algorithms(){
     std::cout << "reverse               ";  
     for(auto& i : numbers)    std::cout << i << " ";    
     std::cout << std::endl;
+
+    // fast_reverse / par_reverse - swap whole SIMD vectors from both ends, reversing their lanes in registers
+    fast_reverse(numbers.begin(), numbers.end());
+    std::cout << "fast_reverse          ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // fast_rotate - the shorter side goes through a stack buffer, memmove shifts the rest
+    std::iota(numbers.begin(), numbers.end(), 1);
+    fast_rotate(numbers.begin(), numbers.begin() + 3, numbers.end());
+    std::cout << "fast_rotate           ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_rotate - three parallel reverses on large ranges
+    std::vector<int> big(1 << 22);
+    std::iota(big.begin(), big.end(), 0);
+    par_rotate(big.begin(), big.begin() + 1000, big.end());
+    std::cout << "par_rotate            " << big[0] << " ... " << big.back() << std::endl;
 }
 
 void stable_foo_algorithms(){
@@ -220,6 +6476,30 @@ void stable_foo_algorithms(){
 
     // Explanation: predicate on sorting is length of string. In this case, "rat", "pig", "dog", "cat" and "ant" all have same length
     // Since they are same length, second condition on sorting will be the physical order. In stable_sort is it guarranteed.  
+
+    // stable_sort_by_length - same result as the stable_sort above, with a counting sort on the lengths
+    std::vector<std::string> animals_by_length = {"elephant", "mouse", "rat", "pig", "dog", "cat", "ant", "moth"};
+    stable_sort_by_length(animals_by_length.begin(), animals_by_length.end());
+    std::cout << "stable_sort_by_length ";
+    for(auto& i : animals_by_length)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // string_sort - same result as std::sort, comparing cached 8 byte prefixes instead of the strings
+    string_sort(animals_by_length.begin(), animals_by_length.end());
+    std::cout << "string_sort           ";
+    for(auto& i : animals_by_length)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // string_table - all strings in one buffer; sort and merge only move (offset, length) entries
+    string_table mammals, insects;
+    for(auto name : {"mouse", "rat", "elephant", "pig"})    mammals.push_back(name);
+    for(auto name : {"moth", "ant"})    insects.push_back(name);
+    mammals.sort();
+    insects.sort();
+    string_table all = merge_string_tables(mammals, insects);
+    std::cout << "merge_string_tables   ";
+    for(std::size_t i = 0; i < all.size(); ++i)    std::cout << all[i] << " ";
+    std::cout << std::endl;
 }
 
 void is_foo_algorithms(){
@@ -267,6 +6547,29 @@ void is_foo_until_algorithms(){
     auto heap = std::is_heap_until(numbers.begin(), numbers.end());
     if(heap != numbers.end())   std::cout << "Is heap until " << *heap << std::endl;
     else                        std::cout << "Is heap until the end" << std::endl;
+
+    // repair_sorted - sorts only the elements past is_sorted_until and merges them in
+    std::vector<int> events = {1, 3, 5, 7, 9, 4, 2, 8};
+    repair_sorted(events.begin(), events.end());
+    std::cout << "repair_sorted     ";
+    for(auto& i : events)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // repair_heap - sifts in only the elements past is_heap_until
+    std::vector<int> tasks = {9, 7, 8, 3, 5, 6, 10, 1};
+    repair_heap(tasks.begin(), tasks.end());
+    std::cout << "repair_heap       ";
+    for(auto& i : tasks)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // lazy_sorted_vector / lazy_heap - appends are O(1); the first query after them repairs only what was appended
+    lazy_sorted_vector<int> buffer;
+    for(int t : {10, 20, 30, 25, 40, 15})    buffer.push_back(t);
+    std::cout << "lazy_sorted_vector sorted until " << buffer.sorted_until();
+    std::cout << ", contains 25 " << buffer.contains(25) << ", sorted until " << buffer.sorted_until() << std::endl;
+    lazy_heap<int> queue;
+    for(int t : {5, 1, 9, 3})    queue.push(t);
+    std::cout << "lazy_heap top " << queue.top() << ", heap until " << queue.heap_until() << std::endl;
 }
 
 void querying_algorithms(){
@@ -286,9 +6589,13 @@ void querying_algorithms(){
 
     // reduce
     // auto reduce = std::reduce(std::execution::par, numbers.begin(), numbers.end());
-    // std::cout << "reduce        " << reduce << std::endl;
+    // std::execution::par needs TBB with g++, par_reduce runs the same reduction on the built-in thread pool
+    auto reduce = par_reduce(numbers.begin(), numbers.end(), 0);
+    std::cout << "reduce        " << reduce << std::endl;
 
     // transform_reduce
+    auto squares = par_transform_reduce(numbers.begin(), numbers.end(), 0, std::plus<int>(), [](int i){ return i * i; });
+    std::cout << "transform_reduce (sum of squares) " << squares << std::endl;
 
     // partial_sum
     std::cout << "Current State         ";  
@@ -301,11 +6608,31 @@ void querying_algorithms(){
     for(auto& i : numbers)    std::cout << i << " ";    
     std::cout << std::endl;
 
-    // inclusive_scan
+    // inclusive_scan - same as partial_sum, but the parallel version may split the range into chunks
     // std::inclusive_scan(numbers.begin(), numbers.end(), numbers.begin());
+    std::vector<int> scan(numbers.size());
+    par_inclusive_scan(numbers.begin(), numbers.end(), scan.begin());
+    std::cout << "inclusive_scan         ";
+    for(auto& i : scan)    std::cout << i << " ";
+    std::cout << std::endl;
+
     // transform_inclusive_scan
-    // exclusive_scan
+    par_transform_inclusive_scan(numbers.begin(), numbers.end(), scan.begin(), std::plus<int>(), [](int i){ return i % 2; });
+    std::cout << "transform_inclusive_scan ";
+    for(auto& i : scan)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // exclusive_scan - element i is the sum of the elements before i, starting from init
+    par_exclusive_scan(numbers.begin(), numbers.end(), scan.begin(), 0);
+    std::cout << "exclusive_scan         ";
+    for(auto& i : scan)    std::cout << i << " ";
+    std::cout << std::endl;
+
     // transform_exclusive_scan
+    par_transform_exclusive_scan(numbers.begin(), numbers.end(), scan.begin(), 0, std::plus<int>(), [](int i){ return i % 2; });
+    std::cout << "transform_exclusive_scan ";
+    for(auto& i : scan)    std::cout << i << " ";
+    std::cout << std::endl;
 
     // inner_product
     auto inner_product = std::inner_product(numbers.begin(), numbers.end(), numbers.begin(), 0);
@@ -348,12 +6675,27 @@ void querying_algorithms(){
     else
         std::cout << word_one << " is not permutation of " << word_two << std::endl;
 
+    // fast_is_permutation - same answer without the quadratic worst case: counts 8 and 16 bit values in an array, sorts
+    // or hashes other types, after comparing an order-independent checksum of both ranges
+    std::vector<int> rows(1000000), shuffled_rows;
+    std::iota(rows.begin(), rows.end(), 0);
+    shuffled_rows = rows;
+    std::shuffle(shuffled_rows.begin(), shuffled_rows.end(), std::default_random_engine(0));
+    std::cout << "fast_is_permutation " << fast_is_permutation(word_one.begin(), word_one.end(), word_two.begin()) << " "
+              << fast_is_permutation(rows.begin(), rows.end(), shuffled_rows.begin());
+    shuffled_rows.back() = -1;
+    std::cout << " " << fast_is_permutation(rows.begin(), rows.end(), shuffled_rows.begin()) << std::endl;
+
     // lexicographical_compare
     if(std::lexicographical_compare(word_one.begin(), word_one.end(), word_two.begin(), word_two.end()))
         std::cout << word_one << " is lexicographically less than " << word_two << std::endl;
     else
         std::cout << word_one << " is lexicographically more than " << word_two << std::endl;
 
+    // fast_lexicographical_compare - the first difference is found a whole vector of characters at a time
+    std::cout << "fast_lexicographical_compare " << fast_lexicographical_compare(word_one.begin(), word_one.end(), word_two.begin(), word_two.end())
+              << ", fast_mismatch at " << fast_mismatch(word_one.begin(), word_one.end(), word_two.begin(), word_two.end()).first - word_one.begin() << std::endl;
+
     // mismatch
     std::vector<int> numbers_one = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
     std::vector<int> numbers_two = {1, 2, 3, 4, 5, 7, 8, 9, 10, 11};
@@ -373,6 +6715,11 @@ void querying_algorithms(){
     else
         std::cout << "Could't find " << find_number << std::endl; 
 
+    // hash_find_duplicate - the first element equal to an earlier one, without sorting first like adjacent_find below
+    auto duplicate_it = hash_find_duplicate(numbers.begin(), numbers.end());
+    if(duplicate_it != numbers.end())
+        std::cout << "hash_find_duplicate " << *duplicate_it << " at " << duplicate_it - numbers.begin() << std::endl;
+
     std::sort(numbers.begin(), numbers.end());
 
     // adjacent_find
@@ -388,6 +6735,18 @@ void querying_algorithms(){
     auto equal_range = std::equal_range(numbers.begin(), numbers.end(), find_number);
     std::cout << "First element of equal_range " << *equal_range.first << ", last element of equal range " << *equal_range.second << std::endl;
 
+    // hash_count / hash_membership - occurrences of every distinct element and membership tests, on unsorted input
+    std::vector<int> unsorted = {5, 3, 5, 9, 3, 5};
+    std::cout << "hash_count ";
+    for(auto& [value, count] : hash_count(unsorted.begin(), unsorted.end()))    std::cout << value << "x" << count << " ";
+    std::cout << std::endl;
+    std::vector<int> queries = {3, 4, 5};
+    std::vector<bool> found;
+    hash_membership(unsorted.begin(), unsorted.end(), queries.begin(), queries.end(), std::back_inserter(found));
+    std::cout << "hash_membership of 3 4 5 ";
+    for(bool f : found)    std::cout << f << " ";
+    std::cout << std::endl;
+
     // lower_bound
     auto lower_bound = std::lower_bound(numbers.begin(), numbers.end(), find_number);
     std::cout << "Lower bound on finding " << find_number << " is " << *lower_bound << std::endl;
@@ -553,6 +6912,23 @@ void movers_algorithms(){
     std::cout << "Content of s2 after move_backward     ";  
     for(auto& i : v2)    std::cout << i << " ";    
     std::cout << std::endl;
+
+    // fast_swap_ranges / par_swap_ranges - trivially copyable elements are swapped a SIMD vector at a time
+    fast_swap_ranges(v1.begin(), v1.end(), v2.begin());
+    std::cout << "Content of v1 after fast_swap_ranges  ";
+    for(auto& i : v1)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_copy / par_move - parallel, with non-temporal stores on large buffers. Source and destination may overlap
+    // like with memmove, e.g. to drop the consumed head of a log buffer
+    std::vector<int> log(1 << 22);
+    std::iota(log.begin(), log.end(), 0);
+    par_copy(log.begin() + 1000000, log.end(), log.begin());
+    std::cout << "log after par_copy                    " << log[0] << " " << log[1] << " ... " << log[log.size() - 1000001] << std::endl;
+
+    // par_move_backward - the same towards the end, e.g. to open a gap
+    par_move_backward(log.begin(), log.begin() + 1000000, log.begin() + 2000000);
+    std::cout << "log after par_move_backward           " << log[1000000] << " " << log[1999999] << std::endl;
 }
 
 void value_modifiers_algorithms(){
@@ -597,17 +6973,51 @@ void value_modifiers_algorithms(){
 }
 
 void structure_changers_algorithms(){
-    // std::remove(begin(collection), end(collection), 99);
-    // More @ https://en.cppreference.com/w/cpp/algorithm/remove
-
-    // collection.erase(std::remove(begin(collection), end(collection), 99), end(collection));
+    std::vector<int> collection = {1, 99, 2, 99, 3, 3, 3, 4, 99, 5, 5};
 
+    // std::remove - moves the elements to keep to the front and returns the new end, the size does not change.
+    // erase(new end, end) then shrinks the container (the erase-remove idiom).
+    // More @ https://en.cppreference.com/w/cpp/algorithm/remove
+    collection.erase(std::remove(collection.begin(), collection.end(), 99), collection.end());
+    std::cout << "erase remove           ";
+    for(auto& i : collection)    std::cout << i << " ";
+    std::cout << std::endl;
 
-    // std::unique(begin(collection)), end(collection));
-    // More @ 
+    // std::unique - removes consecutive equal elements, all duplicates once the range is sorted
+    // More @ https://en.cppreference.com/w/cpp/algorithm/unique
+    collection.erase(std::unique(collection.begin(), collection.end()), collection.end());
+    std::cout << "erase unique           ";
+    for(auto& i : collection)    std::cout << i << " ";
+    std::cout << std::endl;
 
-    // collection.erase(std::remove(begin(collection), end(collection), 99), end(collection));
+    // fast_erase_if - erase-remove in one call, returns the number of erased elements. A predicate expression (or a
+    // value_predicate) is evaluated with vector instructions.
+    std::vector<int> numbers = {2, 3, 4, 5, 6, 7, 8, 9, 10, 14, 21};
+    auto erased = fast_erase_if(numbers, elem % 7 == 0);
+    std::cout << "fast_erase_if          ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << "| erased " << erased << std::endl;
+
+    // par_erase_if / par_erase_unique - the same on the thread pool, for large containers
+    std::vector<int> big(1 << 20);
+    for(std::size_t i = 0; i < big.size(); ++i) big[i] = static_cast<int>(i / 4);
+    par_erase_if(big, elem % 2 == 1);
+    par_erase_unique(big);
+    std::cout << "par_erase_unique       " << big.size() << " left, " << big[0] << " " << big[1] << " ... " << big.back() << std::endl;
+
+    // par_remove_copy_if / par_unique_copy - the output only needs room for the result
+    std::vector<int> kept(big.size());
+    auto kept_end = par_remove_copy_if(big.begin(), big.end(), kept.begin(), value_predicate<int>{compare_op::greater_equal, 10});
+    std::cout << "par_remove_copy_if     ";
+    for(auto i = kept.begin(); i != kept_end; ++i)    std::cout << *i << " ";
+    std::cout << std::endl;
 
+    // hash_unique - removes duplicates from unsorted input in one pass, first occurrences stay in input order
+    std::vector<std::string> words = {"b", "a", "b", "c", "a", "d"};
+    words.erase(hash_unique(words.begin(), words.end()), words.end());
+    std::cout << "hash_unique            ";
+    for(auto& i : words)    std::cout << i << " ";
+    std::cout << std::endl;
 }
 
 void foo_copy_algorithms(){
@@ -626,8 +7036,21 @@ void foo_copy_algorithms(){
     for(auto& i : cpy)    std::cout << i << " ";    
     std::cout << std::endl;
 
-    // std::unique_copy
-    // More @ 
+    // std::unique_copy - copies elements, skipping consecutive duplicates
+    // More @ https://en.cppreference.com/w/cpp/algorithm/unique_copy
+    std::vector<int> repeats = {1, 1, 2, 2, 2, 3, 1, 1};
+    std::vector<int> uniq;
+    std::unique_copy(repeats.begin(), repeats.end(), std::back_inserter(uniq));
+    std::cout << "unique_copy           ";
+    for(auto& i : uniq)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // hash_unique_copy - skips every duplicate, consecutive or not, without sorting first
+    uniq.clear();
+    hash_unique_copy(repeats.begin(), repeats.end(), std::back_inserter(uniq));
+    std::cout << "hash_unique_copy      ";
+    for(auto& i : uniq)    std::cout << i << " ";
+    std::cout << std::endl;
 
     // std::reverse_copy
     // More @ 
@@ -638,11 +7061,26 @@ void foo_copy_algorithms(){
     // std::replace_copy
     // More @ 
 
-    // std::partition_copy
-    // More @ 
+    // std::partition_copy - copies elements satisfying the predicate to one destination and the others to another
+    // More @ https://en.cppreference.com/w/cpp/algorithm/partition_copy
+    std::vector<int> even, odd;
+    std::partition_copy(numbers.begin(), numbers.end(), std::back_inserter(even), std::back_inserter(odd), [](int i){ return i % 2 == 0; });
 
-    // std::partial_sort_copy
-    // More @ 
+    std::cout << "Even                  ";
+    for(auto& i : even)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "Odd                   ";
+    for(auto& i : odd)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // std::partial_sort_copy - copies the first elements in sorted order, as many as fit in the destination
+    // More @ https://en.cppreference.com/w/cpp/algorithm/partial_sort_copy
+    std::vector<int> largest(3);
+    std::partial_sort_copy(numbers.begin(), numbers.end(), largest.begin(), largest.end(), std::greater<int>());
+
+    std::cout << "Largest three         ";
+    for(auto& i : largest)    std::cout << i << " ";
+    std::cout << std::endl;
 }
 
 void foo_if_algorithms(){
@@ -668,8 +7106,9 @@ void foo_if_algorithms(){
 
     // std::remove_if
     // More @ https://en.cppreference.com/w/cpp/algorithm/remove
-    // Important: note that remove_if returns pointer to first elements that satisfy the predicate,
-    numbers.erase(std::remove_if(numbers.begin(), numbers.end(), [](int n){ return n % 7 == 0;}));
+    // Important: remove_if only moves the elements to keep to the front and returns the new end; erase(new end, end)
+    // removes the rest. erase(new end) alone would erase a single element.
+    numbers.erase(std::remove_if(numbers.begin(), numbers.end(), [](int n){ return n % 7 == 0;}), numbers.end());
     
     std::cout << "Current State         ";  
     for(auto& i : numbers)    std::cout << i << " ";    
@@ -708,38 +7147,1864 @@ void other_algorithms(){
     for(auto& i : numbers_two)    std::cout << i << " ";    
     std::cout << std::endl; 
 
-    // std::for_each(begin(collection), end(collection), f)
+    // std::for_each(begin(collection), end(collection), f) - calls f on every element and returns it
+    // More @ https://en.cppreference.com/w/cpp/algorithm/for_each
+    int sum = 0;
+    std::for_each(numbers.begin(), numbers.end(), [&](int i){ sum += i; });
+    std::cout << "for_each sum          " << sum << std::endl;
+
+    // pipe - transform / filter / replace_if / reduce chains fused into one pass over the input, no intermediate vectors.
+    // Stages are lazy, a sink (collect, reduce, copy, for_each, count) runs the whole chain.
+    numbers = {2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto even_plus_ten = pipe(numbers).map([](int i){ return i + 10; }).filter(elem % 2 == 0);
+    std::cout << "pipe collect          ";
+    for(auto& i : even_plus_ten.collect())    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "pipe reduce           " << even_plus_ten.reduce(0) << std::endl;
+
+    // par_ sinks - the same fused loop on chunks of the input on the thread pool, results in input order
+    std::vector<int> big(1 << 20);
+    std::iota(big.begin(), big.end(), 0);
+    auto squares = pipe(big).map([](int i){ return static_cast<long long>(i) * i; }).replace_if(elem > 1000000, 1000000);
+    std::cout << "pipe par_reduce       " << squares.par_reduce(0LL) << std::endl;
+    std::vector<long long> capped(big.size());
+    squares.par_copy(capped.begin());
+    std::cout << "pipe par_copy         " << capped[999] << " " << capped[1000] << " " << capped[1001] << std::endl;
 }
 
 void raw_memory_algorithms(){
-    // std::uninitialized_fill
-    // More @ 
+    std::vector<std::string> words = {"raw", "memory", "algorithms"};
 
-    // std::uninitialized_copy
-    // More @ 
+    // Storage for three strings, none of them constructed yet
+    std::allocator<std::string> alloc;
+    std::string* raw = alloc.allocate(words.size());
 
-    // std::uninitialized_move
-    // More @ 
+    // std::uninitialized_copy - copy constructs into uninitialized storage
+    // More @ https://en.cppreference.com/w/cpp/memory/uninitialized_copy
+    std::uninitialized_copy(words.begin(), words.end(), raw);
+    std::cout << "uninitialized_copy     ";
+    for(std::size_t i = 0; i < words.size(); ++i)    std::cout << raw[i] << " ";
+    std::cout << std::endl;
 
-    // std::destroy(first, last)
-    // More @ 
+    // std::destroy(first, last) - runs the destructors, the storage stays allocated
+    // More @ https://en.cppreference.com/w/cpp/memory/destroy
+    std::destroy(raw, raw + words.size());
+
+    // std::uninitialized_fill
+    // More @ https://en.cppreference.com/w/cpp/memory/uninitialized_fill
+    std::uninitialized_fill(raw, raw + words.size(), std::string("fill"));
+    std::cout << "uninitialized_fill     ";
+    for(std::size_t i = 0; i < words.size(); ++i)    std::cout << raw[i] << " ";
+    std::cout << std::endl;
+    std::destroy(raw, raw + words.size());
+
+    // std::uninitialized_move - move constructs, the sources are left valid but unspecified (empty strings here)
+    // More @ https://en.cppreference.com/w/cpp/memory/uninitialized_move
+    std::uninitialized_move(words.begin(), words.end(), raw);
+    std::cout << "uninitialized_move     ";
+    for(std::size_t i = 0; i < words.size(); ++i)    std::cout << raw[i] << " ";
+    std::cout << "| sources now " << words[0].size() << " " << words[1].size() << " " << words[2].size() << " long" << std::endl;
+    std::destroy(raw, raw + words.size());
+    alloc.deallocate(raw, words.size());
 
     // #_n
-    
+
     // std::copy_n
     // std::fill_n
     // std::generate_n
     // std::search_n
     // std::for_each_n
-    // std::uninitialized_copy_n
-    // std::uninitialized_fill_n
-    // std::uninitialized_move_n
-    // std::uninitialized_default_construct_n
-    // std::uninitialized_value_construct_n
-    // std::destroy_n
+
+    // std::uninitialized_copy_n, std::uninitialized_fill_n, std::uninitialized_move_n,
+    // std::uninitialized_default_construct_n, std::uninitialized_value_construct_n, std::destroy_n
+    // More @ https://en.cppreference.com/w/cpp/memory/uninitialized_value_construct_n
+    std::allocator<int> int_alloc;
+    int* ints = int_alloc.allocate(5);
+    std::uninitialized_value_construct_n(ints, 5);      // zeroes
+    std::cout << "uninitialized_value_construct_n ";
+    for(int i = 0; i < 5; ++i)    std::cout << ints[i] << " ";
+    std::cout << std::endl;
+    std::uninitialized_default_construct_n(ints, 5);    // does nothing for int, the values stay as they are
+    std::uninitialized_fill_n(ints, 5, 7);
+    std::cout << "uninitialized_fill_n   ";
+    for(int i = 0; i < 5; ++i)    std::cout << ints[i] << " ";
+    std::cout << std::endl;
+    std::destroy_n(ints, 5);
+    int_alloc.deallocate(ints, 5);
+
+    // par_ versions - same contracts. Trivially copyable elements are copied / filled with memcpy and fill (with
+    // non-temporal stores past streaming_store_bytes), in parallel chunks on large buffers
+    const std::size_t n = 1 << 22;
+    int* big = int_alloc.allocate(n);
+    par_uninitialized_fill_n(big, n, 42);
+    int* copy = int_alloc.allocate(n);
+    par_uninitialized_copy_n(big, n, copy);
+    std::cout << "par_uninitialized_copy " << copy[0] << " ... " << copy[n - 1] << std::endl;
+    par_destroy_n(copy, n);
+    int_alloc.deallocate(copy, n);
+    int_alloc.deallocate(big, n);
+
+    // If a constructor throws, whatever was constructed is destroyed again before the exception leaves
+    std::vector<std::string> names(100000, "name");
+    names[70000] = "bad";
+    struct checked {
+        std::string name;
+        checked(const std::string& s) : name(s) { if(s == "bad") throw std::invalid_argument("bad name"); }
+    };
+    std::allocator<checked> checked_alloc;
+    checked* people = checked_alloc.allocate(names.size());
+    try {
+        par_uninitialized_copy(names.begin(), names.end(), people);
+    }
+    catch(const std::invalid_argument& e){
+        std::cout << "par_uninitialized_copy threw \"" << e.what() << "\", nothing left constructed" << std::endl;
+    }
+    checked_alloc.deallocate(people, names.size());
+
+    // default_init_allocator - resize without zeroing the new elements first, for buffers that are written anyway
+    std::vector<int, default_init_allocator<int>> buffer;
+    buffer.resize(n);
+    std::fill(buffer.begin(), buffer.end(), 1);
+    std::cout << "default_init resize    " << buffer.size() << " elements, sum " << std::accumulate(buffer.begin(), buffer.end(), 0) << std::endl;
+}
+
+void simd_numeric_algorithms(){
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+
+    // simd_accumulate / simd_inner_product - same results as std::accumulate / std::inner_product,
+    // 8 (AVX2) or 16 (AVX-512) int lanes at a time
+    std::cout << "simd_accumulate       " << simd_accumulate(numbers.begin(), numbers.end(), 0) << std::endl;
+    std::cout << "simd_inner_product    " << simd_inner_product(numbers.begin(), numbers.end(), numbers.begin(), 0) << std::endl;
+
+    // simd_partial_sum - prefix sum computed inside the vector register in log2(lanes) shift-and-add steps
+    simd_partial_sum(numbers.begin(), numbers.end(), numbers.begin());
+    std::cout << "simd_partial_sum      ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // simd_adjacent_difference - inverse of partial_sum
+    simd_adjacent_difference(numbers.begin(), numbers.end(), numbers.begin());
+    std::cout << "simd_adjacent_difference ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+}
+
+void parallel_sort_algorithms(){
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 9, 10, -3, -8};
+
+    // Shuffle for demo purpose
+    std::shuffle(numbers.begin(), numbers.end(), std::default_random_engine(0));
+    std::cout << "Current State         ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_sort - ints, floats and doubles are radix sorted, everything else is samplesorted on the thread pool
+    par_sort(numbers.begin(), numbers.end());
+    std::cout << "par_sort              ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_stable_sort - keeps the stable_sort guarantee, equal elements stay in their original order
+    std::vector<std::string> animals = {"elephant", "mouse", "rat", "pig", "dog", "cat", "ant", "moth"};
+    par_stable_sort(animals.begin(), animals.end(), [](const auto& a, const auto& b) { return a.size () < b.size (); });
+    std::cout << "par_stable_sort       ";
+    for(auto& i : animals)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_radix_sort - stable sort by an arithmetic key, no comparisons at all
+    animals = {"elephant", "mouse", "rat", "pig", "dog", "cat", "ant", "moth"};
+    par_radix_sort(animals.begin(), animals.end(), [](const std::string& s){ return s.size(); });
+    std::cout << "par_radix_sort        ";
+    for(auto& i : animals)    std::cout << i << " ";
+    std::cout << std::endl;
+}
+
+void dary_heap_algorithms(){
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 9, 10};
+
+    // dary_make_heap - same as make_heap, but every node has 4 children
+    dary_make_heap<4>(numbers.begin(), numbers.end());
+    std::cout << "dary_make_heap<4>     ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // dary_is_heap_until - a 4-ary heap is usually not a binary heap
+    std::cout << "Is 4-ary heap until   " << (dary_is_heap_until<4>(numbers.begin(), numbers.end()) - numbers.begin()) << std::endl;
+    std::cout << "Is binary heap until  " << (std::is_heap_until(numbers.begin(), numbers.end()) - numbers.begin()) << std::endl;
+
+    // dary_push_heap / dary_pop_heap
+    numbers.push_back(8);
+    dary_push_heap<4>(numbers.begin(), numbers.end());
+    std::cout << "dary_push_heap<4>     ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    dary_pop_heap<4>(numbers.begin(), numbers.end());
+    std::cout << "dary_pop_heap<4>      ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // dary_heap - priority queue with push_many / pop_many, std::greater gives a min-heap (e.g. timer deadlines)
+    dary_heap<int, 8, std::greater<int>> timers;
+    timers.push_many(numbers.begin(), numbers.end());
+    timers.push(0);
+
+    std::vector<int> next;
+    timers.pop_many(4, std::back_inserter(next));
+    std::cout << "pop_many(4)           ";
+    for(auto& i : next)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "top                   " << timers.top() << std::endl;
+}
+
+void search_index_algorithms(){
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 5, 5, 5, 6, 7, 8, 9};
+    int find_number = 5;
+
+    // eytzinger_index - sorted keys rearranged in BFS order of a binary search tree, results are positions in numbers
+    eytzinger_index<int> eytzinger(numbers.begin(), numbers.end());
+    auto range = eytzinger.equal_range(find_number);
+    std::cout << "eytzinger equal_range of " << find_number << " is [" << range.first << ", " << range.second << ")" << std::endl;
+    std::cout << "eytzinger lower_bound   " << numbers[eytzinger.lower_bound(find_number)] << std::endl;
+    std::cout << "eytzinger upper_bound   " << numbers[eytzinger.upper_bound(find_number)] << std::endl;
+
+    // btree_index - one cache line of keys per node, a node is compared with vector instructions
+    btree_index<int> btree(numbers.begin(), numbers.end());
+    std::cout << "btree contains 5?       " << btree.contains(5) << std::endl;
+    std::cout << "btree contains 10?      " << btree.contains(10) << std::endl;
+
+    // lower_bound_batch - many lookups in one interleaved pass
+    std::vector<int> queries = {0, 5, 7, 10}, positions;
+    btree.lower_bound_batch(queries.begin(), queries.end(), std::back_inserter(positions));
+    std::cout << "lower_bound_batch       ";
+    for(auto& i : positions)    std::cout << i << " ";
+    std::cout << std::endl;
+}
+
+void flat_set_algorithms(){
+    // flat_set - sorted, duplicate-free vector with a set interface
+    flat_set<int> s1 {1, 2, 5, 5, 5, 9};
+    flat_set<int> s2 {2, 5, 7};
+    s2.insert(8);
+    std::cout << "flat_set s1 is                ";
+    for(auto& i : s1)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "flat_set s2 is                ";
+    for(auto& i : s2)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // flat_set_intersection / union / difference / symmetric_difference - same results as the std:: versions on sets
+    std::vector<int> out(s1.size() + s2.size());
+    auto last = flat_set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), out.begin());
+    std::cout << "Flat set intersection is      ";
+    for(auto it = out.begin(); it != last; ++it)    std::cout << *it << " ";
+    std::cout << std::endl;
+
+    last = flat_set_union(s1.begin(), s1.end(), s2.begin(), s2.end(), out.begin());
+    std::cout << "Flat set union is             ";
+    for(auto it = out.begin(); it != last; ++it)    std::cout << *it << " ";
+    std::cout << std::endl;
+
+    last = flat_set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(), out.begin());
+    std::cout << "Flat set difference is        ";
+    for(auto it = out.begin(); it != last; ++it)    std::cout << *it << " ";
+    std::cout << std::endl;
+
+    // Result adopted by a flat_set without sorting it again
+    std::vector<int> symmetric;
+    flat_set_symmetric_difference(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(symmetric));
+    flat_set<int> s3(sorted_unique, symmetric);
+    std::cout << "Flat set symmetric diff is    ";
+    for(auto& i : s3)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // _count variants - size of the result, nothing is written
+    std::cout << "Intersection / union count    " << flat_set_intersection_count(s1.begin(), s1.end(), s2.begin(), s2.end())
+              << " / " << flat_set_union_count(s1.begin(), s1.end(), s2.begin(), s2.end()) << std::endl;
+
+    // flat_includes - a small set against a large one gallops instead of scanning
+    std::vector<int> large(1000);
+    std::iota(large.begin(), large.end(), 0);
+    std::cout << "large includes s1?            " << flat_includes(large.begin(), large.end(), s1.begin(), s1.end()) << std::endl;
+}
+
+void kway_merge_algorithms(){
+    std::vector<int> numbers = {1, 4, 7, 10, 2, 5, 8, 11, 3, 6, 9, 12};
+
+    // kway_merge - merges any number of sorted runs in one pass
+    std::vector<std::pair<std::vector<int>::iterator, std::vector<int>::iterator>> runs = {
+        {numbers.begin(), numbers.begin() + 4}, {numbers.begin() + 4, numbers.begin() + 8}, {numbers.begin() + 8, numbers.end()}};
+    std::vector<int> merged(numbers.size());
+    kway_merge(runs, merged.begin());
+    std::cout << "kway_merge            ";
+    for(auto& i : merged)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_kway_merge - each thread merges a slice of the output, same result
+    std::vector<int> par_merged(numbers.size());
+    par_kway_merge(runs, par_merged.begin());
+    std::cout << "par_kway_merge        ";
+    for(auto& i : par_merged)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // bounded_inplace_merge - inplace_merge with a fixed amount of scratch space, here 2 elements
+    std::vector<int> halves = {1, 3, 5, 7, 9, 2, 4, 6, 8, 10};
+    std::vector<int> buffer(2);
+    bounded_inplace_merge(halves.begin(), halves.begin() + 5, halves.end(), buffer);
+    std::cout << "bounded_inplace_merge ";
+    for(auto& i : halves)    std::cout << i << " ";
+    std::cout << std::endl;
+}
+
+void parallel_partition_algorithms(){
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    // par_partition - same contract as std::partition, chunks are partitioned on the thread pool
+    auto it = par_partition(numbers.begin(), numbers.end(), [](int i){ return i % 2 == 0; });
+    std::cout << "par_partition          ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "Returned iterator      " << *it << std::endl;
+
+    // value_predicate - a comparison with a constant, evaluated with vector instructions
+    std::vector<int> numbers2 = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto greater_than_5 = value_predicate<int>{compare_op::greater, 5};
+    par_stable_partition(numbers2.begin(), numbers2.end(), greater_than_5);
+    std::cout << "par_stable_partition   ";
+    for(auto& i : numbers2)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_partition_copy - stable, both outputs must have room for all elements
+    std::vector<int> big(numbers.size()), small(numbers.size());
+    auto ends = par_partition_copy(numbers2.begin(), numbers2.end(), big.begin(), small.begin(), greater_than_5);
+    std::cout << "par_partition_copy     ";
+    for(auto i = big.begin(); i != ends.first; ++i)    std::cout << *i << " ";
+    std::cout << "| ";
+    for(auto i = small.begin(); i != ends.second; ++i)    std::cout << *i << " ";
+    std::cout << std::endl;
+}
+
+void simd_scan_algorithms(){
+    std::vector<int> numbers = {2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    // Predicate expressions - elem stands for the element, the expression is a predicate that can also be evaluated
+    // on a whole vector of elements at once. The lambda [](int n){ return n % 7 == 0; } becomes elem % 7 == 0
+    auto it = simd_find_if(numbers.begin(), numbers.end(), elem % 7 == 0);
+    std::cout << "simd_find_if           " << *it << std::endl;
+
+    it = simd_find_if_not(numbers.begin(), numbers.end(), elem % 2 == 0);
+    std::cout << "simd_find_if_not       " << *it << std::endl;
+
+    std::cout << "simd_count_if          " << simd_count_if(numbers.begin(), numbers.end(), elem % 3 == 0) << std::endl;
+    std::cout << "simd_count             " << simd_count(numbers.begin(), numbers.end(), 5) << std::endl;
+
+    // all_of / any_of / none_of stop at the first vector that decides the answer
+    std::cout << std::boolalpha;
+    std::cout << "simd_all_of  i > 0     " << simd_all_of(numbers.begin(), numbers.end(), elem > 0) << std::endl;
+    std::cout << "simd_any_of  5 < i < 7 " << simd_any_of(numbers.begin(), numbers.end(), elem > 5 && elem < 7) << std::endl;
+    std::cout << "simd_none_of i < 0     " << simd_none_of(numbers.begin(), numbers.end(), elem < 0) << std::endl;
+
+    // Byte types are scanned 32 (AVX2) or 64 (AVX-512) at a time
+    std::string text = "column buffers, scanned a vector at a time";
+    std::cout << "simd_find ','          " << simd_find(text.data(), text.data() + text.size(), ',') - text.data() << std::endl;
+    std::cout << "simd_count ' '         " << simd_count(text.data(), text.data() + text.size(), ' ') << std::endl;
+
+    // mismatch / equal / adjacent_find
+    std::vector<int> other = {2, 3, 4, 5, 6, 0, 8, 9, 10};
+    auto diff = simd_mismatch(numbers.begin(), numbers.end(), other.begin());
+    std::cout << "simd_mismatch          " << *diff.first << " " << *diff.second << std::endl;
+    std::cout << "simd_equal             " << simd_equal(numbers.begin(), numbers.end(), other.begin()) << std::endl;
+    std::vector<int> runs = {1, 3, 5, 5, 7};
+    std::cout << "simd_adjacent_find     " << simd_adjacent_find(runs.begin(), runs.end()) - runs.begin() << std::endl;
+    std::cout << std::noboolalpha;
+}
+
+void selection_algorithms(){
+    std::vector<int> numbers = {9, 1, 8, 2, 7, 3, 6, 4, 5, 10};
+
+    // floyd_rivest_select - same contract as std::nth_element, fewer comparisons on large ranges
+    floyd_rivest_select(numbers.begin(), numbers.begin() + 4, numbers.end());
+    std::cout << "floyd_rivest_select    ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "5th smallest           " << numbers[4] << std::endl;
+
+    // par_nth_element - large ranges are first cut down around nth with a sample and par_partition
+    par_nth_element(numbers.begin(), numbers.begin() + 2, numbers.end(), std::greater<int>());
+    std::cout << "par_nth_element        ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "3rd largest            " << numbers[2] << std::endl;
+
+    // quantiles - p50 / p90 / p99 / p999 in one pass, instead of one nth_element per quantile
+    std::vector<int> latencies(1000);
+    for(std::size_t i = 0; i < latencies.size(); ++i)    latencies[i] = (i * 7919) % 1000 + 1;
+    std::vector<double> q = {0.5, 0.9, 0.99, 0.999};
+    std::vector<int> values(q.size());
+    quantiles(latencies.begin(), latencies.end(), q.begin(), q.end(), values.begin());
+    std::cout << "p50 p90 p99 p999       ";
+    for(auto& i : values)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // top_k - the 3 largest values of a stream, holding at most 6 of them at any time
+    top_k<int, std::greater<int>> largest(3);
+    for(int i = 0; i < 1000; ++i)    largest.push((i * 7919) % 1000);
+    std::cout << "top_k                  ";
+    for(auto& i : largest.sorted())    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // fast_partial_sort_copy - same result as std::partial_sort_copy, built on top_k
+    std::vector<int> smallest(4);
+    fast_partial_sort_copy(numbers.begin(), numbers.end(), smallest.begin(), smallest.end());
+    std::cout << "fast_partial_sort_copy ";
+    for(auto& i : smallest)    std::cout << i << " ";
+    std::cout << std::endl;
+}
+
+void arena_algorithms(){
+    std::vector<int> v1 = {1, 2, 5, 5, 5, 9};
+    std::vector<int> v2 = {2, 5, 7};
+
+    // std::pmr::set on an arena - the nodes are carved out of the arena's blocks, not one malloc each.
+    // Inserting a sorted sequence at end() also makes every insert O(1)
+    arena nodes;
+    std::pmr::set<int> sunion(&nodes);
+    std::set_union(v1.begin(), v1.end(), v2.begin(), v2.end(), std::inserter(sunion, sunion.end()));
+    std::cout << "pmr::set union         ";
+    for(auto& i : sunion)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // arena_allocator - the same arena, without a virtual call per allocation
+    std::set<int, std::less<int>, arena_allocator<int>> sinter(arena_allocator<int>{nodes});
+    std::set_intersection(v1.begin(), v1.end(), v2.begin(), v2.end(), std::inserter(sinter, sinter.end()));
+    std::cout << "arena set intersection ";
+    for(auto& i : sinter)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "Nodes allocated        " << sunion.size() + sinter.size() << " in " << nodes.bytes_used() << " bytes" << std::endl;
+
+    // An arena on a stack buffer - small outputs never reach the heap
+    char buffer[1024];
+    arena local(buffer, sizeof(buffer));
+    std::pmr::vector<int> merged(&local);
+
+    // reserve_back_inserter - reserves for the largest possible output, so merge never reallocates
+    std::merge(v1.begin(), v1.end(), v2.begin(), v2.end(), reserve_back_inserter(merged, v1.begin(), v1.end(), v2.begin(), v2.end()));
+    std::cout << "merge                  ";
+    for(auto& i : merged)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "capacity               " << merged.capacity() << std::endl;
+
+    std::vector<int> kept;
+    std::remove_copy(v1.begin(), v1.end(), reserve_back_inserter(kept, v1.begin(), v1.end()), 5);
+    std::cout << "remove_copy            ";
+    for(auto& i : kept)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "capacity               " << kept.capacity() << std::endl;
+}
+
+void random_algorithms(){
+    std::vector<int> v(10);
+    std::iota(v.begin(), v.end(), 1);
+
+    // fast_shuffle - Fisher-Yates with a cheap counter-based generator; the same seed gives the same order everywhere
+    fast_shuffle(v.begin(), v.end(), wyrand(42));
+    std::cout << "fast_shuffle wyrand        ";
+    for(auto& i : v)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    std::iota(v.begin(), v.end(), 1);
+    fast_shuffle(v.begin(), v.end(), philox4x32(42));
+    std::cout << "fast_shuffle philox4x32    ";
+    for(auto& i : v)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // par_shuffle - in parallel, and the result only depends on the seed, whatever the number of threads
+    std::vector<int> big(1 << 20), again;
+    std::iota(big.begin(), big.end(), 0);
+    again = big;
+    par_shuffle(big.begin(), big.end(), 7);
+    par_shuffle(again.begin(), again.end(), 7);
+    std::cout << "par_shuffle                ";
+    for(std::size_t i = 0; i < 5; ++i)    std::cout << big[i] << " ";
+    std::cout << "... reproducible " << (big == again) << std::endl;
+
+    // fast_sample - like std::sample, the sample keeps the input order
+    std::vector<int> hundred(100), sample;
+    std::iota(hundred.begin(), hundred.end(), 1);
+    fast_sample(hundred.begin(), hundred.end(), std::back_inserter(sample), 5, wyrand(1));
+    std::cout << "fast_sample                ";
+    for(auto& i : sample)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // reservoir_sampler - a uniform sample of a stream whose length is not known up front
+    reservoir_sampler<int> reservoir(5, wyrand(1));
+    for(int i = 1; i <= 1000000; ++i) reservoir.push(i);
+    std::cout << "reservoir_sampler          ";
+    for(auto& i : reservoir.sample())    std::cout << i << " ";
+    std::cout << "of " << reservoir.seen() << std::endl;
+
+    // weighted_sample - without replacement, heavier elements tend to come first and weight 0 never comes
+    std::vector<std::string> names = {"a", "b", "c", "d", "e"};
+    std::vector<double> weights = {1, 0, 10, 100, 1000};
+    std::vector<std::string> picked;
+    weighted_sample(names.begin(), names.end(), weights.begin(), std::back_inserter(picked), 3, wyrand(3));
+    std::cout << "weighted_sample            ";
+    for(auto& s : picked)    std::cout << s << " ";
+    std::cout << std::endl;
+}
+
+void sorting_network_algorithms(){
+    std::vector<int> numbers = {9, 1, 8, 2, 7, 3, 6, 4, 5, 10};
+
+    // network_sort - a fixed sequence of compare-exchanges, no loop and no branch, for up to 32 elements
+    network_sort<10>(numbers.begin());
+    std::cout << "network_sort           ";
+    for(auto& i : numbers)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // network_merge - two sorted runs of 5 merged by the odd-even merge network
+    std::vector<int> runs = {1, 4, 6, 8, 9, 2, 3, 5, 7, 10};
+    network_merge<5, 5>(runs.begin());
+    std::cout << "network_merge          ";
+    for(auto& i : runs)    std::cout << i << " ";
+    std::cout << std::endl;
+
+    // network_partial_sort - only the comparators that decide the 3 smallest are kept
+    numbers = {9, 1, 8, 2, 7, 3, 6, 4, 5, 10};
+    network_partial_sort<3, 10>(numbers.begin(), std::greater<int>());
+    std::cout << "3 largest              " << numbers[0] << " " << numbers[1] << " " << numbers[2] << std::endl;
+
+    // network_median / network_minmax
+    numbers = {9, 1, 8, 2, 7, 3, 6, 4, 5};
+    auto minmax = network_minmax<9>(numbers.begin());
+    std::cout << "network_minmax         " << minmax.first << " " << minmax.second << std::endl;
+    std::cout << "network_median         " << network_median<9>(numbers.begin()) << std::endl;
+
+    // network_sorted - the same networks at compile time
+    constexpr std::array<int, 5> table = network_sorted(std::array<int, 5>{50, 10, 40, 20, 30});
+    static_assert(table[0] == 10 && table[4] == 50, "sorted at compile time");
+    std::cout << "network_sorted         ";
+    for(auto& i : table)    std::cout << i << " ";
+    std::cout << std::endl;
+    std::cout << "comparators for 16     " << sorting_network_v<16>.size() << std::endl;
+
+    // batch_network_sort - 100000 rows of 16 floats, a SIMD register of rows per compare-exchange
+    std::vector<float> rows(100000 * 16);
+    for(std::size_t i = 0; i < rows.size(); ++i)    rows[i] = static_cast<float>((i * 7919) % 1000);
+    batch_network_sort<16>(rows.data(), rows.size() / 16);
+    std::cout << "batch_network_sort     ";
+    for(std::size_t i = 0; i < 16; ++i)    std::cout << rows[i] << " ";
+    std::cout << std::endl;
+
+    // batch_network_partial_sort - the best 8 of every row of 16
+    for(std::size_t i = 0; i < rows.size(); ++i)    rows[i] = static_cast<float>((i * 7919) % 1000);
+    batch_network_partial_sort<8, 16>(rows.data(), rows.size() / 16);
+    std::cout << "top-8 of row 1         ";
+    for(std::size_t i = 16; i < 24; ++i)    std::cout << rows[i] << " ";
+    std::cout << std::endl;
+}
+
+void instrumentation_algorithms(){
+    std::vector<counted<int>> numbers(100000);
+    for(std::size_t i = 0; i < numbers.size(); ++i)    numbers[i] = static_cast<int>((i * 7919) % numbers.size());
+    const std::vector<counted<int>> input = numbers;
+    instrument_report report;
+
+    // counted<T> elements count the comparisons, copies and moves, instrument_scope records the difference
+    {
+        instrument_scope scope(report, "sort", numbers.size());
+        std::sort(numbers.begin(), numbers.end());
+    }
+    numbers = input;
+    {
+        instrument_scope scope(report, "stable_sort", numbers.size());
+        std::stable_sort(numbers.begin(), numbers.end());
+    }
+
+    // allocation_limit - stable_sort and inplace_merge only get a 4 KB buffer, as when memory is short
+    numbers = input;
+    {
+        allocation_limit limit(4096);
+        instrument_scope scope(report, "stable_sort 4 KB", numbers.size());
+        std::stable_sort(numbers.begin(), numbers.end());
+    }
+    numbers = input;
+    std::sort(numbers.begin(), numbers.begin() + numbers.size() / 2);
+    std::sort(numbers.begin() + numbers.size() / 2, numbers.end());
+    const std::vector<counted<int>> halves = numbers;
+    {
+        instrument_scope scope(report, "inplace_merge", numbers.size());
+        std::inplace_merge(numbers.begin(), numbers.begin() + numbers.size() / 2, numbers.end());
+    }
+    numbers = halves;
+    {
+        allocation_limit limit(4096);
+        instrument_scope scope(report, "inplace_merge 4 KB", numbers.size());
+        std::inplace_merge(numbers.begin(), numbers.begin() + numbers.size() / 2, numbers.end());
+    }
+
+    // counting_compare / counting_iterator - plain ints, the comparator and the iterators do the counting
+    std::vector<int> plain(100000);
+    for(std::size_t i = 0; i < plain.size(); ++i)    plain[i] = static_cast<int>((i * 7919) % plain.size());
+    {
+        instrument_scope scope(report, "nth_element", plain.size());
+        std::nth_element(counting_iterator(plain.begin()), counting_iterator(plain.begin() + plain.size() / 2),
+                         counting_iterator(plain.end()), counting_compare<>());
+    }
+
+    std::cout << "algorithm           comparisons     moves    copies  allocs  failed  bytes_touched" << std::endl;
+    for(auto& r : report.records())
+        std::cout << std::left << std::setw(20) << r.name << std::right
+                  << std::setw(11) << r.counts[instrument_counter::comparisons]
+                  << std::setw(10) << r.counts[instrument_counter::moves]
+                  << std::setw(10) << r.counts[instrument_counter::copies]
+                  << std::setw(8) << r.counts[instrument_counter::allocations]
+                  << std::setw(8) << r.counts[instrument_counter::failed_allocations]
+                  << std::setw(15) << r.counts[instrument_counter::bytes_touched] << std::endl;
+
+    // counting_allocator - the allocations of one container, here a vector growing by push_back
+    allocation_stats stats;
+    std::vector<int, counting_allocator<int>> grown{counting_allocator<int>(stats)};
+    for(int i = 0; i < 100000; ++i)    grown.push_back(i);
+    std::cout << "push_back x 100000  " << stats.allocations << " allocations, " << stats.bytes << " bytes, peak "
+              << stats.peak_bytes << std::endl;
+
+    // write_json / write_csv - the machine-readable report, with cycles and nanoseconds per record
+    std::ostringstream csv;
+    report.write_csv(csv);
+    std::cout << csv.str().substr(0, csv.str().find('\n')) << std::endl;
+}
+
+void thread_pool_algorithms(){
+    thread_pool& pool = default_thread_pool();
+
+    // Nested parallel_for - the inner loops run on the same workers, which steal ranges from each other
+    std::vector<long> row_sums(8);
+    pool.parallel_for(row_sums.size(), [&](std::size_t row){
+        std::vector<long> cells(1000);
+        pool.parallel_for(cells.size(), [&](std::size_t i){ cells[i] = static_cast<long>(row * i); });
+        row_sums[row] = std::accumulate(cells.begin(), cells.end(), 0L);
+    });
+    std::cout << "nested parallel_for    ";
+    for(auto& s : row_sums)    std::cout << s << " ";
+    std::cout << std::endl;
+
+    // par_ algorithms from several request threads at once share the pool instead of starting threads of their own
+    std::vector<std::thread> requests;
+    std::vector<int> sorted(4);
+    for(std::size_t r = 0; r < sorted.size(); ++r)
+        requests.emplace_back([&, r]{
+            std::vector<int> v(1 << 20);
+            for(std::size_t i = 0; i < v.size(); ++i)    v[i] = static_cast<int>((i * 7919) % v.size());
+            par_sort(v.begin(), v.end());
+            sorted[r] = std::is_sorted(v.begin(), v.end());
+        });
+    for(auto& t : requests)    t.join();
+    std::cout << "concurrent par_sort    ";
+    for(auto& s : sorted)    std::cout << s << " ";
+    std::cout << std::endl;
+}
+
+#if STL_HAS_MMAP
+void external_memory_algorithms(){
+    struct record { std::uint64_t key, value; };
+    auto by_key = [](const record& a, const record& b){ return a.key < b.key; };
+
+    // record_writer - two unsorted snapshots of 1M records; b lost every 10th key of a and gained 100000 new ones
+    {
+        record_writer<record> a("snapshot_a.bin"), b("snapshot_b.bin");
+        for(std::uint64_t i = 0; i < 1000000; ++i){
+            const std::uint64_t key = i * 2654435761u % 1000000;
+            a.push({key, i});
+            if(key % 10 != 0)    b.push({key, i});
+            if(key % 10 == 5)    b.push({key + 1000000, i});
+        }
+        a.close();
+        b.close();
+    }
+
+    // external_sort - runs of 32768 records (1 MB budget) merged 8 at a time, so in two passes
+    external_config config;
+    config.memory_bytes = 1 << 20;
+    config.window_bytes = 1 << 20;
+    config.max_fan_in = 8;
+    external_sort<record>("snapshot_a.bin", "snapshot_a.bin", config, by_key);
+    external_sort<record>("snapshot_b.bin", "snapshot_b.bin", config, by_key);
+
+    // external_set_difference / external_set_intersection / external_merge - streaming, a window of each file at a time
+    std::cout << "removed keys           " << external_set_difference<record>("snapshot_a.bin", "snapshot_b.bin", "removed.bin", config, by_key) << std::endl;
+    std::cout << "added keys             " << external_set_difference<record>("snapshot_b.bin", "snapshot_a.bin", "added.bin", config, by_key) << std::endl;
+    std::cout << "kept keys              " << external_set_intersection<record>("snapshot_a.bin", "snapshot_b.bin", "kept.bin", config, by_key) << std::endl;
+    std::cout << "merged records         " << external_merge<record>("snapshot_a.bin", "snapshot_b.bin", "merged.bin", config, by_key) << std::endl;
+
+    // mapped_file - reads a result in place
+    mapped_file removed("removed.bin");
+    auto records = removed.records<record>();
+    std::cout << "first removed keys     ";
+    for(auto r = records.first; r != records.second && r != records.first + 5; ++r)    std::cout << r->key << " ";
+    std::cout << std::endl;
+
+    for(auto path : {"snapshot_a.bin", "snapshot_b.bin", "removed.bin", "added.bin", "kept.bin", "merged.bin"})    std::remove(path);
+}
+#endif
+
+// Benchmark mode - runs every algorithm family above on large generated inputs
+// Usage: ./a.out bench [--sizes 1K,1M,100M] [--types int32,int64,double,string]
+//                      [--dists sorted,reverse,random,few_unique,organ_pipe]
+//                      [--families heap,sorting,...] [--min-time 0.2] [--falloff 1.5] [--report counts.json]
+// For every (algorithm, type, distribution) it prints ns/element and throughput per size and
+// the first size where the (complexity-normalised) cost per element grows past --falloff x the best
+// cost seen at smaller sizes, i.e. the point where the working set stops fitting in some cache level.
+// --report also runs every case once inside an instrument_scope and writes the allocations and cycles to a file.
+
+enum class distribution { sorted, reverse, random, few_unique, organ_pipe };
+
+const char* distribution_name(distribution d){
+    switch(d){
+        case distribution::sorted:      return "sorted";
+        case distribution::reverse:     return "reverse";
+        case distribution::random:      return "random";
+        case distribution::few_unique:  return "few_unique";
+        case distribution::organ_pipe:  return "organ_pipe";
+    }
+    return "?";
+}
+
+struct bench_config {
+    std::vector<std::size_t> sizes = {1000, 10000, 100000, 1000000, 10000000};
+    std::vector<std::string> types = {"int32", "int64", "double", "string"};
+    std::vector<distribution> dists = {distribution::sorted, distribution::reverse, distribution::random,
+                                       distribution::few_unique, distribution::organ_pipe};
+    std::vector<std::string> families;      // empty = all
+    double min_time = 0.2;                  // seconds spent per measurement (at least one run)
+    double falloff = 1.5;
+    unsigned seed = 0;
+    std::string report;                     // file for the instrumented runs, CSV if it ends in .csv, JSON otherwise
+};
+
+struct bench_result {
+    std::string family, name, type, dist;
+    std::size_t n;
+    double ns_per_element;
+    double normalized;                      // ns / element, divided by log2(n) for n log n algorithms
+};
+
+// Keeps the compiler from discarding benchmark results
+template<typename V>
+inline void do_not_optimize(const V& value){
+    asm volatile("" : : "r,m"(value) : "memory");
 }
 
-int main(){
+// Maps a key to an element so that key order == element order for every benchmarked type
+template<typename T>
+T make_value(std::uint64_t key){
+    if constexpr (std::is_same_v<T, std::string>){
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "key-%016llu", static_cast<unsigned long long>(key));
+        return buffer;
+    }
+    else if constexpr (std::is_floating_point_v<T>) return static_cast<T>(key) * T(0.5);
+    else                                            return static_cast<T>(key);
+}
+
+template<typename T>
+std::vector<T> make_input(std::size_t n, distribution d, unsigned seed){
+    std::vector<std::uint64_t> keys(n);
+    std::mt19937_64 rng(seed);
+    switch(d){
+        case distribution::sorted:
+            std::iota(keys.begin(), keys.end(), 0);
+            break;
+        case distribution::reverse:
+            for(std::size_t i = 0; i < n; ++i) keys[i] = n - 1 - i;
+            break;
+        case distribution::random:
+            std::iota(keys.begin(), keys.end(), 0);
+            std::shuffle(keys.begin(), keys.end(), rng);
+            break;
+        case distribution::few_unique:
+            for(auto& k : keys) k = rng() % 16;
+            break;
+        case distribution::organ_pipe:
+            for(std::size_t i = 0; i < n; ++i) keys[i] = i < n / 2 ? 2 * i : 2 * (n - 1 - i);
+            break;
+    }
+    std::vector<T> values;
+    values.reserve(n);
+    for(auto k : keys) values.push_back(make_value<T>(k));
+    return values;
+}
+
+// One benchmarked operation. 'prepare' runs untimed on a fresh copy of the input,
+// 'run' is timed and gets the prepared copy plus a scratch buffer of the same size.
+template<typename T>
+struct bench_case {
+    std::string family;
+    std::string name;
+    bool n_log_n;
+    std::function<void(std::vector<T>&)> prepare;
+    std::function<void(std::vector<T>&, std::vector<T>&)> run;
+};
+
+template<typename T>
+std::vector<bench_case<T>> bench_cases(){
+    using vec = std::vector<T>;
+    auto none = [](vec&){};
+    auto sort = [](vec& v){ std::sort(v.begin(), v.end()); };
+    auto heap = [](vec& v){ std::make_heap(v.begin(), v.end()); };
+    // Sorted / a heap except for the last 1%, used by the lazy order benchmarks
+    auto sort_most = [](vec& v){ std::sort(v.begin(), v.end() - v.size() / 100); };
+    auto heap_most = [](vec& v){ std::make_heap(v.begin(), v.end() - v.size() / 100); };
+    // Splits v into two sorted halves, used by the merge / set benchmarks
+    auto sort_halves = [](vec& v){
+        std::sort(v.begin(), v.begin() + v.size() / 2);
+        std::sort(v.begin() + v.size() / 2, v.end());
+    };
+    // Splits v into 16 sorted runs, used by the k-way merge benchmarks
+    auto sort_runs = [](vec& v){
+        for(std::size_t r = 0; r < 16; ++r) std::sort(v.begin() + v.size() * r / 16, v.begin() + v.size() * (r + 1) / 16);
+    };
+    auto runs_of = [](vec& v){
+        std::vector<std::pair<typename vec::iterator, typename vec::iterator>> runs;
+        for(std::size_t r = 0; r < 16; ++r) runs.push_back({v.begin() + v.size() * r / 16, v.begin() + v.size() * (r + 1) / 16});
+        return runs;
+    };
+    std::vector<bench_case<T>> cases = {
+        {"heap", "make_heap", false, none, [](vec& v, vec&){ std::make_heap(v.begin(), v.end()); }},
+        {"heap", "push_heap", true, none, [](vec& v, vec&){
+            for(auto it = v.begin(); it != v.end(); ++it) std::push_heap(v.begin(), it + 1);
+        }},
+        {"heap", "pop_heap", true, heap, [](vec& v, vec&){
+            for(auto it = v.end(); it != v.begin(); --it) std::pop_heap(v.begin(), it);
+        }},
+        {"heap", "dary_make_heap<4>", false, none, [](vec& v, vec&){ dary_make_heap<4>(v.begin(), v.end()); }},
+        {"heap", "dary_heap<4> push", true, none, [](vec& v, vec&){
+            dary_heap<T, 4> heap;
+            heap.reserve(v.size());
+            for(auto& x : v) heap.push(x);
+            do_not_optimize(heap.top());
+        }},
+        {"heap", "dary_heap<8> push", true, none, [](vec& v, vec&){
+            dary_heap<T, 8> heap;
+            heap.reserve(v.size());
+            for(auto& x : v) heap.push(x);
+            do_not_optimize(heap.top());
+        }},
+        {"heap", "dary_pop_heap<4>", true, [](vec& v){ dary_make_heap<4>(v.begin(), v.end()); }, [](vec& v, vec&){
+            for(auto it = v.end(); it != v.begin(); --it) dary_pop_heap<4>(v.begin(), it);
+        }},
+        {"heap", "dary_pop_heap<8>", true, [](vec& v){ dary_make_heap<8>(v.begin(), v.end()); }, [](vec& v, vec&){
+            for(auto it = v.end(); it != v.begin(); --it) dary_pop_heap<8>(v.begin(), it);
+        }},
+
+        {"sorting", "sort", true, none, [](vec& v, vec&){ std::sort(v.begin(), v.end()); }},
+        {"sorting", "par_sort", true, none, [](vec& v, vec&){ par_sort(v.begin(), v.end()); }},
+        {"sorting", "partial_sort", true, none, [](vec& v, vec&){
+            std::partial_sort(v.begin(), v.begin() + v.size() / 10, v.end());
+        }},
+        {"sorting", "nth_element", false, none, [](vec& v, vec&){
+            std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        }},
+        {"sorting", "floyd_rivest_select", false, none, [](vec& v, vec&){
+            floyd_rivest_select(v.begin(), v.begin() + v.size() / 2, v.end());
+        }},
+        {"sorting", "par_nth_element", false, none, [](vec& v, vec&){
+            par_nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        }},
+        {"sorting", "nth_element p50/p99/p999", false, none, [](vec& v, vec&){
+            for(double q : {0.5, 0.99, 0.999}) std::nth_element(v.begin(), v.begin() + std::size_t(q * (v.size() - 1)), v.end());
+        }},
+        {"sorting", "quantiles p50/p99/p999", false, none, [](vec& v, vec& out){
+            const double q[] = {0.5, 0.99, 0.999};
+            do_not_optimize(quantiles(v.begin(), v.end(), std::begin(q), std::end(q), out.begin()));
+        }},
+        {"sorting", "partial_sort_copy 1%", true, none, [](vec& v, vec& out){
+            do_not_optimize(std::partial_sort_copy(v.begin(), v.end(), out.begin(), out.begin() + v.size() / 100));
+        }},
+        {"sorting", "fast_partial_sort_copy 1%", true, none, [](vec& v, vec& out){
+            do_not_optimize(fast_partial_sort_copy(v.begin(), v.end(), out.begin(), out.begin() + v.size() / 100));
+        }},
+        // Every 16 elements as an independent row, e.g. per-row feature vectors
+        {"sorting", "sort rows of 16", false, none, [](vec& v, vec&){
+            for(std::size_t r = 0; r + 16 <= v.size(); r += 16) std::sort(v.begin() + r, v.begin() + r + 16);
+        }},
+        {"sorting", "network_sort rows of 16", false, none, [](vec& v, vec&){
+            for(std::size_t r = 0; r + 16 <= v.size(); r += 16) network_sort<16>(v.begin() + r);
+        }},
+        {"sorting", "batch_network_sort 16", false, none, [](vec& v, vec&){ batch_network_sort<16>(v.data(), v.size() / 16); }},
+        {"sorting", "partial_sort 8 of 16", false, none, [](vec& v, vec&){
+            for(std::size_t r = 0; r + 16 <= v.size(); r += 16) std::partial_sort(v.begin() + r, v.begin() + r + 8, v.begin() + r + 16);
+        }},
+        {"sorting", "batch_network_psort 8/16", false, none, [](vec& v, vec&){
+            batch_network_partial_sort<8, 16>(v.data(), v.size() / 16);
+        }},
+        {"sorting", "sort_heap", true, heap, [](vec& v, vec&){ std::sort_heap(v.begin(), v.end()); }},
+        {"sorting", "inplace_merge", false, sort_halves, [](vec& v, vec&){
+            std::inplace_merge(v.begin(), v.begin() + v.size() / 2, v.end());
+        }},
+
+        {"sorting", "bounded_inplace_merge", false, sort_halves, [](vec& v, vec&){
+            bounded_inplace_merge(v.begin(), v.begin() + v.size() / 2, v.end(), v.size() / 64);
+        }},
+        {"sorting", "pairwise merge 16 runs", false, sort_runs, [](vec& v, vec& out){
+            // What kway_merge replaces: fold the runs with std::merge, ping-ponging between two buffers
+            for(std::size_t r = 1; r < 16; ++r){
+                auto end = v.begin() + v.size() * (r + 1) / 16, mid = v.begin() + v.size() * r / 16;
+                std::merge(v.begin(), mid, mid, end, out.begin());
+                std::move(out.begin(), out.begin() + (end - v.begin()), v.begin());
+            }
+        }},
+        {"sorting", "kway_merge 16 runs", false, sort_runs, [runs_of](vec& v, vec& out){
+            do_not_optimize(kway_merge(runs_of(v), out.begin()));
+        }},
+        {"sorting", "par_kway_merge 16 runs", false, sort_runs, [runs_of](vec& v, vec& out){
+            do_not_optimize(par_kway_merge(runs_of(v), out.begin()));
+        }},
+
+        {"partition", "partition", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(std::partition(v.begin(), v.end(), [&](const T& x){ return x < pivot; }));
+        }},
+        {"partition", "partition_point", false, sort, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(std::partition_point(v.begin(), v.end(), [&](const T& x){ return x < pivot; }));
+        }},
+
+        {"partition", "par_partition", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(par_partition(v.begin(), v.end(), [&](const T& x){ return x < pivot; }));
+        }},
+        {"partition", "partition_copy", false, none, [](vec& v, vec& out){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(std::partition_copy(v.begin(), v.end(), out.begin(), out.rbegin(), [&](const T& x){ return x < pivot; }));
+        }},
+        {"partition", "par_partition_copy", false, none, [](vec& v, vec& out){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(par_partition_copy(v.begin(), v.end(), out.begin(), out.rbegin(), [&](const T& x){ return x < pivot; }));
+        }},
+
+        {"permutation", "rotate", false, none, [](vec& v, vec&){
+            std::rotate(v.begin(), v.begin() + v.size() / 3, v.end());
+        }},
+        {"permutation", "shuffle", false, none, [](vec& v, vec&){
+            std::shuffle(v.begin(), v.end(), std::default_random_engine(0));
+        }},
+        {"permutation", "fast_rotate", false, none, [](vec& v, vec&){
+            fast_rotate(v.begin(), v.begin() + v.size() / 3, v.end());
+        }},
+        {"permutation", "par_rotate", false, none, [](vec& v, vec&){
+            par_rotate(v.begin(), v.begin() + v.size() / 3, v.end());
+        }},
+        {"permutation", "rotate by 100", false, none, [](vec& v, vec&){
+            std::rotate(v.begin(), v.begin() + std::min<std::size_t>(100, v.size()), v.end());
+        }},
+        {"permutation", "fast_rotate by 100", false, none, [](vec& v, vec&){
+            fast_rotate(v.begin(), v.begin() + std::min<std::size_t>(100, v.size()), v.end());
+        }},
+        {"permutation", "reverse", false, none, [](vec& v, vec&){ std::reverse(v.begin(), v.end()); }},
+        {"permutation", "fast_reverse", false, none, [](vec& v, vec&){ fast_reverse(v.begin(), v.end()); }},
+        {"permutation", "par_reverse", false, none, [](vec& v, vec&){ par_reverse(v.begin(), v.end()); }},
+
+        {"stable", "stable_sort", true, none, [](vec& v, vec&){ std::stable_sort(v.begin(), v.end()); }},
+        {"stable", "par_stable_sort", true, none, [](vec& v, vec&){ par_stable_sort(v.begin(), v.end()); }},
+        {"stable", "stable_partition", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(std::stable_partition(v.begin(), v.end(), [&](const T& x){ return x < pivot; }));
+        }},
+
+        {"stable", "par_stable_partition", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(par_stable_partition(v.begin(), v.end(), [&](const T& x){ return x < pivot; }));
+        }},
+
+        {"is_foo", "is_sorted", false, sort, [](vec& v, vec&){ do_not_optimize(std::is_sorted(v.begin(), v.end())); }},
+        {"is_foo", "is_heap", false, heap, [](vec& v, vec&){ do_not_optimize(std::is_heap(v.begin(), v.end())); }},
+        {"is_foo_until", "is_sorted_until", false, none, [](vec& v, vec&){
+            do_not_optimize(std::is_sorted_until(v.begin(), v.end()));
+        }},
+        {"is_foo_until", "is_heap_until", false, none, [](vec& v, vec&){
+            do_not_optimize(std::is_heap_until(v.begin(), v.end()));
+        }},
+        // 99% already in order, 1% appended after it
+        {"is_foo_until", "sort 1% appended", true, sort_most, [](vec& v, vec&){ std::sort(v.begin(), v.end()); }},
+        {"is_foo_until", "repair_sorted 1% appended", false, sort_most, [](vec& v, vec&){ repair_sorted(v.begin(), v.end()); }},
+        {"is_foo_until", "make_heap 1% pushed", false, heap_most, [](vec& v, vec&){ std::make_heap(v.begin(), v.end()); }},
+        {"is_foo_until", "repair_heap 1% pushed", false, heap_most, [](vec& v, vec&){ repair_heap(v.begin(), v.end()); }},
+        // 16 batches of appends, each followed by a search
+        {"is_foo_until", "append + search, resort", true, none, [](vec& v, vec&){
+            vec buffer;
+            std::size_t found = 0;
+            for(std::size_t b = 0; b < 16; ++b){
+                buffer.insert(buffer.end(), v.begin() + v.size() * b / 16, v.begin() + v.size() * (b + 1) / 16);
+                std::sort(buffer.begin(), buffer.end());
+                found += std::binary_search(buffer.begin(), buffer.end(), v[b]);
+            }
+            do_not_optimize(found);
+        }},
+        {"is_foo_until", "lazy_sorted_vector", true, none, [](vec& v, vec&){
+            lazy_sorted_vector<T> buffer;
+            std::size_t found = 0;
+            for(std::size_t b = 0; b < 16; ++b){
+                buffer.append(v.begin() + v.size() * b / 16, v.begin() + v.size() * (b + 1) / 16);
+                found += buffer.contains(v[b]);
+            }
+            do_not_optimize(found);
+        }},
+
+        {"querying", "count", false, none, [](vec& v, vec&){
+            do_not_optimize(std::count(v.begin(), v.end(), make_value<T>(5)));
+        }},
+        {"querying", "find", false, none, [](vec& v, vec&){
+            do_not_optimize(std::find(v.begin(), v.end(), make_value<T>(v.size())));
+        }},
+        {"querying", "minmax_element", false, none, [](vec& v, vec&){
+            do_not_optimize(std::minmax_element(v.begin(), v.end()));
+        }},
+        // Is out (v reversed) a permutation of v? std::is_permutation is quadratic here, the usual workaround sorts copies
+        {"querying", "sort + equal", true, none, [](vec& v, vec& out){
+            std::reverse_copy(v.begin(), v.end(), out.begin());
+            vec a = v, b = out;
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            do_not_optimize(std::equal(a.begin(), a.end(), b.begin()));
+        }},
+        {"querying", "fast_is_permutation", false, none, [](vec& v, vec& out){
+            std::reverse_copy(v.begin(), v.end(), out.begin());
+            do_not_optimize(fast_is_permutation(v.begin(), v.end(), out.begin()));
+        }},
+        {"querying", "adjacent_find", false, none, [](vec& v, vec&){
+            do_not_optimize(std::adjacent_find(v.begin(), v.end()));
+        }},
+        {"querying", "sort + count groups", true, none, [](vec& v, vec&){
+            vec a = v;
+            std::sort(a.begin(), a.end());
+            std::size_t groups = 0;
+            for(auto it = a.begin(); it != a.end(); ++groups) it = std::upper_bound(it, a.end(), *it);
+            do_not_optimize(groups);
+        }},
+        {"querying", "hash_count", false, none, [](vec& v, vec&){
+            do_not_optimize(hash_count(v.begin(), v.end()).size());
+        }},
+        {"querying", "hash_find_duplicate", false, none, [](vec& v, vec&){
+            do_not_optimize(hash_find_duplicate(v.begin(), v.end()));
+        }},
+        {"querying", "hash_membership", false, none, [](vec& v, vec& out){
+            for(std::size_t i = 0; i < v.size(); ++i) out[i] = make_value<T>((i * 2654435761u) % v.size());
+            std::vector<char> found(v.size());
+            hash_membership(v.begin(), v.end(), out.begin(), out.end(), found.begin());
+            do_not_optimize(found.data());
+        }},
+        {"querying", "lower_bound", true, sort, [](vec& v, vec&){
+            std::size_t found = 0;
+            for(std::size_t i = 0; i < v.size(); ++i)
+                found += std::lower_bound(v.begin(), v.end(), make_value<T>((i * 2654435761u) % v.size())) != v.end();
+            do_not_optimize(found);
+        }},
+        // The index benchmarks include building the index, which is O(n) next to the n log n lookups
+        {"querying", "eytzinger lower_bound", true, sort, [](vec& v, vec&){
+            eytzinger_index<T> index(v.begin(), v.end());
+            std::size_t found = 0;
+            for(std::size_t i = 0; i < v.size(); ++i) found += index.lower_bound(make_value<T>((i * 2654435761u) % v.size()));
+            do_not_optimize(found);
+        }},
+        {"querying", "eytzinger batch", true, sort, [](vec& v, vec& out){
+            eytzinger_index<T> index(v.begin(), v.end());
+            for(std::size_t i = 0; i < v.size(); ++i) out[i] = make_value<T>((i * 2654435761u) % v.size());
+            std::vector<std::size_t> ranks(v.size());
+            index.lower_bound_batch(out.begin(), out.end(), ranks.begin());
+            do_not_optimize(ranks.back());
+        }},
+
+        {"set", "set_union", false, sort_halves, [](vec& v, vec& out){
+            auto mid = v.begin() + v.size() / 2;
+            out.resize(v.size());
+            do_not_optimize(std::set_union(v.begin(), mid, mid, v.end(), out.begin()));
+        }},
+        {"set", "set_intersection", false, sort_halves, [](vec& v, vec& out){
+            auto mid = v.begin() + v.size() / 2;
+            do_not_optimize(std::set_intersection(v.begin(), mid, mid, v.end(), out.begin()));
+        }},
+        {"set", "set_difference", false, sort_halves, [](vec& v, vec& out){
+            auto mid = v.begin() + v.size() / 2;
+            do_not_optimize(std::set_difference(v.begin(), mid, mid, v.end(), out.begin()));
+        }},
+        // Growing the output one element at a time: a node allocation per element, or one bump in an arena
+        {"set", "set_union -> std::set", false, sort_halves, [](vec& v, vec&){
+            auto mid = v.begin() + v.size() / 2;
+            std::set<T> s;
+            std::set_union(v.begin(), mid, mid, v.end(), std::inserter(s, s.end()));
+            do_not_optimize(s.size());
+        }},
+        {"set", "set_union -> pmr::set", false, sort_halves, [](vec& v, vec&){
+            auto mid = v.begin() + v.size() / 2;
+            arena nodes;
+            std::pmr::set<T> s(&nodes);
+            std::set_union(v.begin(), mid, mid, v.end(), std::inserter(s, s.end()));
+            do_not_optimize(s.size());
+        }},
+        {"set", "set_union -> arena set", false, sort_halves, [](vec& v, vec&){
+            auto mid = v.begin() + v.size() / 2;
+            arena nodes;
+            std::set<T, std::less<T>, arena_allocator<T>> s{arena_allocator<T>{nodes}};
+            std::set_union(v.begin(), mid, mid, v.end(), std::inserter(s, s.end()));
+            do_not_optimize(s.size());
+        }},
+        {"set", "set_union back_inserter", false, sort_halves, [](vec& v, vec&){
+            auto mid = v.begin() + v.size() / 2;
+            std::vector<T> r;
+            std::set_union(v.begin(), mid, mid, v.end(), std::back_inserter(r));
+            do_not_optimize(r.size());
+        }},
+        {"set", "set_union reserved", false, sort_halves, [](vec& v, vec&){
+            auto mid = v.begin() + v.size() / 2;
+            std::vector<T> r;
+            std::set_union(v.begin(), mid, mid, v.end(), reserve_back_inserter(r, v.begin(), mid, mid, v.end()));
+            do_not_optimize(r.size());
+        }},
+        // Every chunk builds its own std::set at the same time, from the global heap or from its own arena
+        {"set", "par std::set per chunk", true, none, [](vec& v, vec&){
+            parallel_chunks<T>(v.size(), [&](std::size_t, std::size_t begin, std::size_t end){
+                std::set<T> s(v.begin() + begin, v.begin() + end);
+                do_not_optimize(s.size());
+            });
+        }},
+        {"set", "par arena set per chunk", true, none, [](vec& v, vec&){
+            parallel_chunks<T>(v.size(), [&](std::size_t, std::size_t begin, std::size_t end){
+                arena nodes;
+                std::set<T, std::less<T>, arena_allocator<T>> s(v.begin() + begin, v.begin() + end, std::less<T>(), nodes);
+                do_not_optimize(s.size());
+            });
+        }},
+        {"set", "merge", false, sort_halves, [](vec& v, vec& out){
+            auto mid = v.begin() + v.size() / 2;
+            do_not_optimize(std::merge(v.begin(), mid, mid, v.end(), out.begin()));
+        }},
+
+        {"movers", "copy", false, none, [](vec& v, vec& out){ do_not_optimize(std::copy(v.begin(), v.end(), out.begin())); }},
+        {"movers", "copy back_inserter", false, none, [](vec& v, vec&){
+            std::vector<T> r;
+            std::copy(v.begin(), v.end(), std::back_inserter(r));
+            do_not_optimize(r.size());
+        }},
+        {"movers", "copy reserved inserter", false, none, [](vec& v, vec&){
+            std::vector<T> r;
+            std::copy(v.begin(), v.end(), reserve_back_inserter(r, v.begin(), v.end()));
+            do_not_optimize(r.size());
+        }},
+        {"movers", "move", false, none, [](vec& v, vec& out){ do_not_optimize(std::move(v.begin(), v.end(), out.begin())); }},
+        {"movers", "swap_ranges", false, none, [](vec& v, vec& out){
+            do_not_optimize(std::swap_ranges(v.begin(), v.end(), out.begin()));
+        }},
+        {"movers", "fast_swap_ranges", false, none, [](vec& v, vec& out){
+            do_not_optimize(fast_swap_ranges(v.begin(), v.end(), out.begin()));
+        }},
+        {"movers", "par_swap_ranges", false, none, [](vec& v, vec& out){
+            do_not_optimize(par_swap_ranges(v.begin(), v.end(), out.begin()));
+        }},
+        {"movers", "par_copy", false, none, [](vec& v, vec& out){ do_not_optimize(par_copy(v.begin(), v.end(), out.begin())); }},
+        {"movers", "par_move", false, none, [](vec& v, vec& out){ do_not_optimize(par_move(v.begin(), v.end(), out.begin())); }},
+        // Shifting a buffer left by a tenth of its length, source and destination overlapping
+        {"movers", "copy overlapping", false, none, [](vec& v, vec&){
+            do_not_optimize(std::copy(v.begin() + v.size() / 10, v.end(), v.begin()));
+        }},
+        {"movers", "par_copy overlapping", false, none, [](vec& v, vec&){
+            do_not_optimize(par_copy(v.begin() + v.size() / 10, v.end(), v.begin()));
+        }},
+        {"movers", "move_backward", false, none, [](vec& v, vec&){
+            do_not_optimize(std::move_backward(v.begin(), v.end() - v.size() / 10, v.end()));
+        }},
+        {"movers", "par_move_backward", false, none, [](vec& v, vec&){
+            do_not_optimize(par_move_backward(v.begin(), v.end() - v.size() / 10, v.end()));
+        }},
+
+        {"value_modifiers", "fill", false, none, [](vec& v, vec&){ std::fill(v.begin(), v.end(), make_value<T>(1)); }},
+        {"value_modifiers", "replace", false, none, [](vec& v, vec&){
+            std::replace(v.begin(), v.end(), make_value<T>(5), make_value<T>(6));
+        }},
+
+        {"structure_changers", "erase_remove", false, none, [](vec& v, vec&){
+            v.erase(std::remove(v.begin(), v.end(), make_value<T>(5)), v.end());
+        }},
+        {"structure_changers", "erase_unique", false, sort, [](vec& v, vec&){
+            v.erase(std::unique(v.begin(), v.end()), v.end());
+        }},
+        {"structure_changers", "fast_erase", false, none, [](vec& v, vec&){
+            v.erase(fast_remove(v.begin(), v.end(), make_value<T>(5)), v.end());
+        }},
+        {"structure_changers", "par_erase_unique", false, sort, [](vec& v, vec&){ par_erase_unique(v); }},
+        // Deduplicating unsorted input: sorting first, or one hashing pass that also keeps the input order
+        {"structure_changers", "sort + erase_unique", false, none, [](vec& v, vec&){
+            std::sort(v.begin(), v.end());
+            v.erase(std::unique(v.begin(), v.end()), v.end());
+        }},
+        {"structure_changers", "hash_erase_duplicates", false, none, [](vec& v, vec&){ hash_erase_duplicates(v); }},
+        {"structure_changers", "par_hash_unique", false, none, [](vec& v, vec&){
+            v.erase(par_hash_unique(v.begin(), v.end()), v.end());
+        }},
+
+        {"foo_copy", "remove_copy", false, none, [](vec& v, vec& out){
+            do_not_optimize(std::remove_copy(v.begin(), v.end(), out.begin(), make_value<T>(5)));
+        }},
+        {"foo_copy", "remove_copy back_inserter", false, none, [](vec& v, vec&){
+            std::vector<T> r;
+            std::remove_copy(v.begin(), v.end(), std::back_inserter(r), make_value<T>(5));
+            do_not_optimize(r.size());
+        }},
+        {"foo_copy", "remove_copy reserved", false, none, [](vec& v, vec&){
+            std::vector<T> r;
+            std::remove_copy(v.begin(), v.end(), reserve_back_inserter(r, v.begin(), v.end()), make_value<T>(5));
+            do_not_optimize(r.size());
+        }},
+        {"foo_copy", "unique_copy", false, none, [](vec& v, vec& out){
+            do_not_optimize(std::unique_copy(v.begin(), v.end(), out.begin()));
+        }},
+        {"foo_copy", "par_unique_copy", false, none, [](vec& v, vec& out){
+            do_not_optimize(par_unique_copy(v.begin(), v.end(), out.begin()));
+        }},
+        {"foo_copy", "reverse_copy", false, none, [](vec& v, vec& out){
+            do_not_optimize(std::reverse_copy(v.begin(), v.end(), out.begin()));
+        }},
+
+        {"foo_if", "count_if", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(std::count_if(v.begin(), v.end(), [&](const T& x){ return x < pivot; }));
+        }},
+        {"foo_if", "erase_remove_if", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            v.erase(std::remove_if(v.begin(), v.end(), [&](const T& x){ return x < pivot; }), v.end());
+        }},
+        {"foo_if", "fast_erase_if", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            fast_erase_if(v, [&](const T& x){ return x < pivot; });
+        }},
+        {"foo_if", "par_erase_if", false, none, [](vec& v, vec&){
+            auto pivot = make_value<T>(v.size() / 2);
+            par_erase_if(v, [&](const T& x){ return x < pivot; });
+        }},
+        {"foo_if", "par_remove_copy_if", false, none, [](vec& v, vec& out){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(par_remove_copy_if(v.begin(), v.end(), out.begin(), [&](const T& x){ return x < pivot; }));
+        }},
+        {"foo_if", "copy_if", false, none, [](vec& v, vec& out){
+            auto pivot = make_value<T>(v.size() / 2);
+            do_not_optimize(std::copy_if(v.begin(), v.end(), out.begin(), [&](const T& x){ return x < pivot; }));
+        }},
+
+        {"other", "for_each", false, none, [](vec& v, vec&){
+            std::size_t touched = 0;
+            std::for_each(v.begin(), v.end(), [&](const T& x){ do_not_optimize(x); ++touched; });
+            do_not_optimize(touched);
+        }},
+
+        // Building a fresh buffer of n elements, page faults included: value-initialized and then written, written once,
+        // or not initialized at all
+        {"raw_memory", "vector(n) then fill", false, none, [](vec& v, vec&){
+            std::vector<T> b(v.size());
+            std::fill(b.begin(), b.end(), v[0]);
+            do_not_optimize(b[b.size() / 2]);
+        }},
+        {"raw_memory", "vector(n, value)", false, none, [](vec& v, vec&){
+            std::vector<T> b(v.size(), v[0]);
+            do_not_optimize(b[b.size() / 2]);
+        }},
+        {"raw_memory", "default_init vector(n)", false, none, [](vec& v, vec&){
+            std::vector<T, default_init_allocator<T>> b(v.size());
+            do_not_optimize(b.data());
+        }},
+        {"raw_memory", "par_uninitialized_fill", false, none, [](vec& v, vec&){
+            std::allocator<T> alloc;
+            T* raw = alloc.allocate(v.size());
+            par_uninitialized_fill(raw, raw + v.size(), v[0]);
+            do_not_optimize(raw[v.size() / 2]);
+            par_destroy_n(raw, v.size());
+            alloc.deallocate(raw, v.size());
+        }},
+        {"raw_memory", "vector(first, last)", false, none, [](vec& v, vec&){
+            std::vector<T> b(v.begin(), v.end());
+            do_not_optimize(b[b.size() / 2]);
+        }},
+        {"raw_memory", "uninitialized_copy", false, none, [](vec& v, vec&){
+            std::allocator<T> alloc;
+            T* raw = alloc.allocate(v.size());
+            std::uninitialized_copy(v.begin(), v.end(), raw);
+            do_not_optimize(raw[v.size() / 2]);
+            std::destroy_n(raw, v.size());
+            alloc.deallocate(raw, v.size());
+        }},
+        {"raw_memory", "par_uninitialized_copy", false, none, [](vec& v, vec&){
+            std::allocator<T> alloc;
+            T* raw = alloc.allocate(v.size());
+            par_uninitialized_copy(v.begin(), v.end(), raw);
+            do_not_optimize(raw[v.size() / 2]);
+            par_destroy_n(raw, v.size());
+            alloc.deallocate(raw, v.size());
+        }},
+
+        {"random", "shuffle mt19937_64", false, none, [](vec& v, vec&){
+            std::shuffle(v.begin(), v.end(), std::mt19937_64(42));
+        }},
+        {"random", "fast_shuffle wyrand", false, none, [](vec& v, vec&){ fast_shuffle(v.begin(), v.end(), wyrand(42)); }},
+        {"random", "fast_shuffle philox4x32", false, none, [](vec& v, vec&){ fast_shuffle(v.begin(), v.end(), philox4x32(42)); }},
+        {"random", "par_shuffle", false, none, [](vec& v, vec&){ par_shuffle(v.begin(), v.end(), 42); }},
+        {"random", "sample 1%", false, none, [](vec& v, vec& out){
+            do_not_optimize(std::sample(v.begin(), v.end(), out.begin(), v.size() / 100, std::mt19937_64(42)));
+        }},
+        {"random", "fast_sample 1%", false, none, [](vec& v, vec& out){
+            do_not_optimize(fast_sample(v.begin(), v.end(), out.begin(), v.size() / 100, wyrand(42)));
+        }},
+        {"random", "reservoir_sampler 1%", false, none, [](vec& v, vec&){
+            reservoir_sampler<T> sampler(v.size() / 100, wyrand(42));
+            sampler.push(v.begin(), v.end());
+            do_not_optimize(sampler.sample().data());
+        }},
+        {"random", "weighted_sample 1%", false, none, [](vec& v, vec& out){
+            std::vector<double> weights(v.size());
+            for(std::size_t i = 0; i < weights.size(); ++i) weights[i] = 1 + i % 4;
+            do_not_optimize(weighted_sample(v.begin(), v.end(), weights.begin(), out.begin(), v.size() / 100, wyrand(42)));
+        }},
+    };
+
+    if constexpr (std::is_same_v<T, std::string>){
+        std::vector<bench_case<T>> strings = {
+            {"sorting", "string_sort", true, none, [](vec& v, vec&){ string_sort(v.begin(), v.end()); }},
+            {"stable", "stable_sort by length", true, none, [](vec& v, vec&){
+                std::stable_sort(v.begin(), v.end(), [](const T& a, const T& b){ return a.size() < b.size(); });
+            }},
+            {"stable", "stable_sort_by_length", false, none, [](vec& v, vec&){ stable_sort_by_length(v.begin(), v.end()); }},
+            {"stable", "string_table sort", true, none, [](vec& v, vec&){
+                string_table table;
+                for(auto& s : v) table.push_back(s);
+                table.sort();
+                do_not_optimize(table[0].data());
+            }},
+            {"querying", "lexicographical_compare", false, sort, [](vec& v, vec&){
+                std::size_t less = 0;
+                for(std::size_t i = 1; i < v.size(); ++i) less += std::lexicographical_compare(v[i - 1].begin(), v[i - 1].end(), v[i].begin(), v[i].end());
+                do_not_optimize(less);
+            }},
+            {"querying", "fast_lexicographical_cmp", false, sort, [](vec& v, vec&){
+                std::size_t less = 0;
+                for(std::size_t i = 1; i < v.size(); ++i) less += fast_lexicographical_compare(v[i - 1].begin(), v[i - 1].end(), v[i].begin(), v[i].end());
+                do_not_optimize(less);
+            }},
+        };
+        cases.insert(cases.end(), strings.begin(), strings.end());
+    }
+
+    // Numeric algorithms only make sense for arithmetic types
+    if constexpr (std::is_arithmetic_v<T>){
+        // Sums, prefix sums and sums of squares of n integers below sqrt(max / n) cannot overflow (signed overflow
+        // would be undefined behaviour inside the benchmark); floating point values are left as they are
+        auto small_values = [](vec& v){
+            if constexpr (std::is_integral_v<T>){
+                const auto bound = static_cast<std::uint64_t>(std::sqrt(double(std::numeric_limits<T>::max()) / std::max<std::size_t>(1, v.size())));
+                for(auto& x : v) x = static_cast<T>(static_cast<std::uint64_t>(x) % std::max<std::uint64_t>(1, bound));
+            }
+        };
+        // Like sort_halves, but each half is made strictly increasing as the flat_set_ algorithms expect
+        auto unique_halves = [](vec& v){
+            for(auto half : {std::make_pair(std::size_t(0), v.size() / 2), std::make_pair(v.size() / 2, v.size())}){
+                std::sort(v.begin() + half.first, v.begin() + half.second);
+                for(std::size_t i = half.first + 1; i < half.second; ++i)
+                    if(!(v[i - 1] < v[i])) v[i] = v[i - 1] + T(1);
+            }
+        };
+        std::vector<bench_case<T>> numeric = {
+#if STL_HAS_MMAP
+            // File in, file out, with a memory budget of 1/8 of the data
+            {"external", "external_sort", true, [](vec& v){
+                record_writer<T> writer("bench_external.bin");
+                writer.write(v.data(), v.size());
+                writer.close();
+            }, [](vec& v, vec&){
+                external_config config;
+                config.memory_bytes = std::max<std::size_t>(4096, v.size() * sizeof(T) / 8);
+                do_not_optimize(external_sort<T>("bench_external.bin", "bench_external.sorted", config));
+                std::remove("bench_external.bin");
+                std::remove("bench_external.sorted");
+            }},
+#endif
+            {"querying", "accumulate", false, small_values, [](vec& v, vec&){
+                do_not_optimize(std::accumulate(v.begin(), v.end(), T(0)));
+            }},
+            {"querying", "partial_sum", false, small_values, [](vec& v, vec&){
+                do_not_optimize(std::partial_sum(v.begin(), v.end(), v.begin()));
+            }},
+            {"querying", "inner_product", false, small_values, [](vec& v, vec&){
+                do_not_optimize(std::inner_product(v.begin(), v.end(), v.begin(), T(0)));
+            }},
+            {"querying", "adjacent_difference", false, none, [](vec& v, vec& out){
+                do_not_optimize(std::adjacent_difference(v.begin(), v.end(), out.begin()));
+            }},
+            {"querying", "par_reduce", false, small_values, [](vec& v, vec&){
+                do_not_optimize(par_reduce(v.begin(), v.end(), T(0)));
+            }},
+            {"querying", "par_inclusive_scan", false, small_values, [](vec& v, vec&){
+                do_not_optimize(par_inclusive_scan(v.begin(), v.end(), v.begin()));
+            }},
+            {"querying", "par_transform_reduce", false, small_values, [](vec& v, vec&){
+                do_not_optimize(par_transform_reduce(v.begin(), v.end(), v.begin(), T(0)));
+            }},
+            {"querying", "simd_accumulate", false, small_values, [](vec& v, vec&){
+                do_not_optimize(simd_accumulate(v.begin(), v.end(), T(0)));
+            }},
+            {"querying", "simd_partial_sum", false, small_values, [](vec& v, vec&){
+                do_not_optimize(simd_partial_sum(v.begin(), v.end(), v.begin()));
+            }},
+            {"querying", "simd_inner_product", false, small_values, [](vec& v, vec&){
+                do_not_optimize(simd_inner_product(v.begin(), v.end(), v.begin(), T(0)));
+            }},
+            {"querying", "simd_adjacent_difference", false, none, [](vec& v, vec& out){
+                do_not_optimize(simd_adjacent_difference(v.begin(), v.end(), out.begin()));
+            }},
+            {"querying", "btree lower_bound", true, sort, [](vec& v, vec&){
+                btree_index<T> index(v.begin(), v.end());
+                std::size_t found = 0;
+                for(std::size_t i = 0; i < v.size(); ++i) found += index.lower_bound(make_value<T>((i * 2654435761u) % v.size()));
+                do_not_optimize(found);
+            }},
+            {"querying", "btree batch", true, sort, [](vec& v, vec& out){
+                btree_index<T> index(v.begin(), v.end());
+                for(std::size_t i = 0; i < v.size(); ++i) out[i] = make_value<T>((i * 2654435761u) % v.size());
+                std::vector<std::size_t> ranks(v.size());
+                index.lower_bound_batch(out.begin(), out.end(), ranks.begin());
+                do_not_optimize(ranks.back());
+            }},
+            {"set", "flat_set_union", false, unique_halves, [](vec& v, vec& out){
+                auto mid = v.begin() + v.size() / 2;
+                out.resize(v.size());
+                do_not_optimize(flat_set_union(v.begin(), mid, mid, v.end(), out.begin()));
+            }},
+            {"set", "flat_set_intersection", false, unique_halves, [](vec& v, vec& out){
+                auto mid = v.begin() + v.size() / 2;
+                do_not_optimize(flat_set_intersection(v.begin(), mid, mid, v.end(), out.begin()));
+            }},
+            {"set", "flat_set_difference", false, unique_halves, [](vec& v, vec& out){
+                auto mid = v.begin() + v.size() / 2;
+                do_not_optimize(flat_set_difference(v.begin(), mid, mid, v.end(), out.begin()));
+            }},
+            {"set", "flat_set_inter_count", false, unique_halves, [](vec& v, vec&){
+                auto mid = v.begin() + v.size() / 2;
+                do_not_optimize(flat_set_intersection_count(v.begin(), mid, mid, v.end()));
+            }},
+            // Every 64th element of the first half against the whole second half
+            {"set", "set_intersection 1:64", false, unique_halves, [](vec& v, vec& out){
+                auto mid = v.begin() + v.size() / 2;
+                std::size_t small = 0;
+                for(auto it = v.begin(); it < mid; it += 64) out[small++] = *it;
+                do_not_optimize(std::set_intersection(out.begin(), out.begin() + small, mid, v.end(), out.begin() + small));
+            }},
+            {"set", "flat_set_intersect 1:64", false, unique_halves, [](vec& v, vec& out){
+                auto mid = v.begin() + v.size() / 2;
+                std::size_t small = 0;
+                for(auto it = v.begin(); it < mid; it += 64) out[small++] = *it;
+                do_not_optimize(flat_set_intersection(out.begin(), out.begin() + small, mid, v.end(), out.begin() + small));
+            }},
+            // vpred = value_predicate, classified with vector compares (and compress-stored on AVX-512)
+            {"partition", "fast_partition vpred", false, none, [](vec& v, vec&){
+                do_not_optimize(fast_partition(v.begin(), v.end(), value_predicate<T>{compare_op::less, make_value<T>(v.size() / 2)}));
+            }},
+            {"partition", "par_partition vpred", false, none, [](vec& v, vec&){
+                do_not_optimize(par_partition(v.begin(), v.end(), value_predicate<T>{compare_op::less, make_value<T>(v.size() / 2)}));
+            }},
+            {"partition", "par_partition_copy vpred", false, none, [](vec& v, vec& out){
+                do_not_optimize(par_partition_copy(v.begin(), v.end(), out.begin(), out.rbegin(),
+                                                   value_predicate<T>{compare_op::less, make_value<T>(v.size() / 2)}));
+            }},
+            {"foo_if", "fast_erase_if vpred", false, none, [](vec& v, vec&){
+                fast_erase_if(v, value_predicate<T>{compare_op::less, make_value<T>(v.size() / 2)});
+            }},
+            {"foo_if", "par_erase_if vpred", false, none, [](vec& v, vec&){
+                par_erase_if(v, value_predicate<T>{compare_op::less, make_value<T>(v.size() / 2)});
+            }},
+            {"stable", "stable_partition vpred", false, none, [](vec& v, vec&){
+                do_not_optimize(par_stable_partition(v.begin(), v.end(), value_predicate<T>{compare_op::less, make_value<T>(v.size() / 2)}));
+            }},
+            // Predicate expressions evaluated on whole vectors, against the same condition as a lambda
+            {"querying", "count_if lambda", false, none, [](vec& v, vec&){
+                do_not_optimize(std::count_if(v.begin(), v.end(), [](T x){ return x > T(0); }));
+            }},
+            {"querying", "simd_count_if elem > 0", false, none, [](vec& v, vec&){
+                do_not_optimize(simd_count_if(v.begin(), v.end(), elem > 0));
+            }},
+            {"querying", "simd_find", false, none, [](vec& v, vec&){
+                do_not_optimize(simd_find(v.begin(), v.end(), make_value<T>(v.size())));
+            }},
+            {"querying", "simd_count", false, none, [](vec& v, vec&){
+                do_not_optimize(simd_count(v.begin(), v.end(), make_value<T>(5)));
+            }},
+            {"querying", "simd_all_of elem >= 0", false, none, [](vec& v, vec&){
+                do_not_optimize(simd_all_of(v.begin(), v.end(), elem >= 0));
+            }},
+            {"querying", "simd_adjacent_find", false, none, [](vec& v, vec&){
+                do_not_optimize(simd_adjacent_find(v.begin(), v.end()));
+            }},
+            {"querying", "mismatch", false, none, [](vec& v, vec& out){
+                std::copy(v.begin(), v.end(), out.begin());
+                do_not_optimize(std::mismatch(v.begin(), v.end(), out.begin()));
+            }},
+            {"querying", "simd_mismatch", false, none, [](vec& v, vec& out){
+                std::copy(v.begin(), v.end(), out.begin());
+                do_not_optimize(simd_mismatch(v.begin(), v.end(), out.begin()));
+            }},
+            {"value_modifiers", "iota", false, none, [](vec& v, vec&){ std::iota(v.begin(), v.end(), T(42)); }},
+            {"other", "transform", false, none, [](vec& v, vec& out){
+                std::transform(v.begin(), v.end(), out.begin(), [](T i){ return i + T(10); });
+            }},
+            // transform -> copy_if -> reduce, one pass per stage with intermediate vectors, against the fused pipeline
+            {"other", "transform+copy_if+reduce", false, none, [](vec& v, vec& out){
+                const T pivot = make_value<T>(v.size() / 2);
+                std::vector<T> mapped(v.size());
+                std::transform(v.begin(), v.end(), mapped.begin(), [](T i){ return i / T(2) + T(1); });
+                auto end = std::copy_if(mapped.begin(), mapped.end(), out.begin(), [&](T i){ return i < pivot; });
+                do_not_optimize(std::accumulate(out.begin(), end, 0.0));
+            }},
+            {"other", "pipe map filter reduce", false, none, [](vec& v, vec&){
+                const T pivot = make_value<T>(v.size() / 2);
+                do_not_optimize(pipe(v).map([](T i){ return i / T(2) + T(1); }).filter([&](T i){ return i < pivot; }).reduce(0.0));
+            }},
+            {"other", "pipe par_reduce", false, none, [](vec& v, vec&){
+                const T pivot = make_value<T>(v.size() / 2);
+                do_not_optimize(pipe(v).map([](T i){ return i / T(2) + T(1); }).filter([&](T i){ return i < pivot; }).par_reduce(0.0));
+            }},
+            {"other", "pipe par_copy", false, none, [](vec& v, vec& out){
+                const T pivot = make_value<T>(v.size() / 2);
+                do_not_optimize(pipe(v).map([](T i){ return i / T(2) + T(1); }).filter([&](T i){ return i < pivot; }).par_copy(out.begin()));
+            }},
+        };
+        cases.insert(cases.end(), numeric.begin(), numeric.end());
+    }
+    return cases;
+}
+
+template<typename T>
+void run_benchmarks(const std::string& type_name, const bench_config& config, std::vector<bench_result>& results,
+                    instrument_report& report){
+    auto cases = bench_cases<T>();
+    for(auto d : config.dists){
+        for(auto n : config.sizes){
+            if(n < 2) continue;
+            const std::vector<T> input = make_input<T>(n, d, config.seed);
+            std::vector<T> work, scratch(n);
+
+            for(auto& c : cases){
+                if(!config.families.empty() &&
+                   std::find(config.families.begin(), config.families.end(), c.family) == config.families.end())
+                    continue;
+
+                // Best of as many runs as fit in min_time (copy and prepare count against the budget
+                // but are excluded from the measurement)
+                double best = std::numeric_limits<double>::max();
+                auto budget_start = std::chrono::steady_clock::now();
+                do {
+                    // Fresh copy: assigning over the previous run would keep (string) elements in the heap blocks
+                    // the last permutation scattered them to
+                    std::vector<T>().swap(work);
+                    work = input;
+                    c.prepare(work);
+                    auto start = std::chrono::steady_clock::now();
+                    c.run(work, scratch);
+                    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    best = std::min(best, elapsed.count());
+                } while(std::chrono::duration<double>(std::chrono::steady_clock::now() - budget_start).count() < config.min_time);
+
+                double ns = best * 1e9 / n;
+                double normalized = c.n_log_n ? ns / std::log2(static_cast<double>(n)) : ns;
+                results.push_back({c.family, c.name, type_name, distribution_name(d), n, ns, normalized});
+
+                std::cout << std::left << std::setw(20) << c.family << std::setw(26) << c.name
+                          << std::setw(8) << type_name << std::setw(12) << distribution_name(d)
+                          << std::right << std::setw(12) << n
+                          << std::fixed << std::setprecision(3) << std::setw(12) << ns << " ns/elem"
+                          << std::setprecision(1) << std::setw(10) << 1e3 / ns << " Melem/s" << std::endl;
+
+                // One more run, untimed, counting allocations, failed allocations and cycles
+                if(!config.report.empty()){
+                    std::vector<T>().swap(work);
+                    work = input;
+                    c.prepare(work);
+                    instrument_scope scope(report, c.family + " " + c.name + " " + type_name + " " + distribution_name(d), n);
+                    c.run(work, scratch);
+                }
+            }
+        }
+    }
+}
+
+// Prints, per (family, algorithm, type, distribution), the first size that is falloff x slower
+// per element than the best of all smaller sizes
+void report_falloff(std::vector<bench_result> results, double falloff){
+    std::stable_sort(results.begin(), results.end(), [](const bench_result& a, const bench_result& b){
+        return std::tie(a.family, a.name, a.type, a.dist, a.n) < std::tie(b.family, b.name, b.type, b.dist, b.n);
+    });
+
+    std::cout << std::endl << "Falloff (normalised cost > " << falloff << "x best of smaller sizes)" << std::endl;
+    for(auto first = results.begin(); first != results.end();){
+        auto last = std::find_if(first, results.end(), [&](const bench_result& r){
+            return std::tie(r.family, r.name, r.type, r.dist) != std::tie(first->family, first->name, first->type, first->dist);
+        });
+
+        double best = first->normalized;
+        auto fall = std::find_if(first + 1, last, [&](const bench_result& r){
+            if(r.normalized > falloff * best) return true;
+            best = std::min(best, r.normalized);
+            return false;
+        });
+
+        std::cout << std::left << std::setw(20) << first->family << std::setw(26) << first->name
+                  << std::setw(8) << first->type << std::setw(12) << first->dist;
+        if(fall != last)
+            std::cout << "falls off at " << fall->n << " (" << std::fixed << std::setprecision(2)
+                      << fall->normalized / best << "x)" << std::endl;
+        else
+            std::cout << "no falloff up to " << (last - 1)->n << std::endl;
+        first = last;
+    }
+}
+
+// Accepts plain numbers and K / M / G suffixes, e.g. "1K,100M"
+std::vector<std::size_t> parse_sizes(const std::string& list){
+    std::vector<std::size_t> sizes;
+    std::stringstream stream(list);
+    for(std::string item; std::getline(stream, item, ',');){
+        std::size_t pos = 0;
+        double value = std::stod(item, &pos);
+        switch(pos < item.size() ? std::toupper(static_cast<unsigned char>(item[pos])) : 0){
+            case 'K': value *= 1e3; break;
+            case 'M': value *= 1e6; break;
+            case 'G': value *= 1e9; break;
+        }
+        sizes.push_back(static_cast<std::size_t>(value));
+    }
+    return sizes;
+}
+
+std::vector<std::string> parse_list(const std::string& list){
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    for(std::string item; std::getline(stream, item, ',');) items.push_back(item);
+    return items;
+}
+
+int benchmark(int argc, char** argv){
+    bench_config config;
+    for(int i = 2; i < argc; i += 2){
+        if(i + 1 == argc){
+            std::cerr << "option " << argv[i] << " needs a value" << std::endl;
+            return 1;
+        }
+        std::string option = argv[i], value = argv[i + 1];
+        if(option == "--sizes")         config.sizes = parse_sizes(value);
+        else if(option == "--types")    config.types = parse_list(value);
+        else if(option == "--families") config.families = parse_list(value);
+        else if(option == "--min-time") config.min_time = std::stod(value);
+        else if(option == "--falloff")  config.falloff = std::stod(value);
+        else if(option == "--seed")     config.seed = std::stoul(value);
+        else if(option == "--report")   config.report = value;
+        else if(option == "--dists"){
+            config.dists.clear();
+            for(auto& name : parse_list(value)){
+                for(auto d : {distribution::sorted, distribution::reverse, distribution::random,
+                              distribution::few_unique, distribution::organ_pipe})
+                    if(name == distribution_name(d)) config.dists.push_back(d);
+            }
+        }
+        else {
+            std::cerr << "unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    std::sort(config.sizes.begin(), config.sizes.end());
+
+    std::vector<bench_result> results;
+    instrument_report report;
+    for(auto& type : config.types){
+        if(type == "int32")       run_benchmarks<std::int32_t>(type, config, results, report);
+        else if(type == "int64")  run_benchmarks<std::int64_t>(type, config, results, report);
+        else if(type == "double") run_benchmarks<double>(type, config, results, report);
+        else if(type == "string") run_benchmarks<std::string>(type, config, results, report);
+        else std::cerr << "unknown type " << type << std::endl;
+    }
+    report_falloff(results, config.falloff);
+
+    if(!config.report.empty()){
+        std::ofstream file(config.report);
+        if(config.report.size() >= 4 && config.report.compare(config.report.size() - 4, 4, ".csv") == 0) report.write_csv(file);
+        else report.write_json(file);
+        if(!file){
+            std::cerr << "cannot write " << config.report << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Test mode - regression checks, run with ./a.out test. Prints every failed check and returns 1 if there was one.
+// Unless STL_THREADS is set the pool gets 8 threads, so the parallel paths run even on a small machine.
+
+struct test_context {
+    int failures = 0;
+
+    void check(bool ok, const std::string& what){
+        if(ok) return;
+        std::cout << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+};
+
+// Chunks that are all true below the split and all false above it leave no misplaced elements to swap
+void test_par_partition(test_context& t){
+    const std::size_t chunk = parallel_chunk_elements<int>();
+    auto run = [&](const std::vector<std::size_t>& trues_per_chunk, const std::string& name){
+        std::vector<int> v;
+        for(std::size_t c = 0; c < trues_per_chunk.size(); ++c)
+            for(std::size_t i = 0; i < chunk; ++i) v.push_back(i < trues_per_chunk[c] ? -1 - int(i % 7) : int(i % 7));
+        const long sum = std::accumulate(v.begin(), v.end(), 0L);
+        const std::size_t trues = std::count_if(v.begin(), v.end(), [](int x){ return x < 0; });
+        auto mid = par_partition(v.begin(), v.end(), [](int x){ return x < 0; });
+        t.check(std::is_partitioned(v.begin(), v.end(), [](int x){ return x < 0; }) &&
+                static_cast<std::size_t>(mid - v.begin()) == trues && std::accumulate(v.begin(), v.end(), 0L) == sum,
+                "par_partition " + name);
+    };
+    run({30000, chunk, 32768, chunk}, "with all true chunks");
+    run({chunk, 100, 0, chunk, 0}, "with all false chunks above the split");
+    std::mt19937_64 rng(1);
+    for(int trial = 0; trial < 50; ++trial){
+        std::vector<std::size_t> pattern(2 + rng() % 6);
+        for(auto& trues : pattern) trues = rng() % 3 == 0 ? 0 : rng() % 3 == 0 ? chunk : rng() % (chunk + 1);
+        run(pattern, "with random chunk patterns");
+    }
+}
+
+// Each chunk's buffer is freed when the chunk is done; the result matches std::stable_partition for both chunk paths
+void test_par_stable_partition(test_context& t){
+    std::mt19937_64 rng(2);
+    for(std::size_t n : {std::size_t(0), std::size_t(1000), 5 * parallel_chunk_elements<int>() + 17}){
+        std::vector<int> v(n);
+        for(auto& x : v) x = int(rng() % 2001) - 1000;
+        auto expected = v;
+        std::stable_partition(expected.begin(), expected.end(), value_predicate<int>{compare_op::less, 0});
+        par_stable_partition(v.begin(), v.end(), value_predicate<int>{compare_op::less, 0});
+        t.check(v == expected, "par_stable_partition of " + std::to_string(n) + " int");
+        std::vector<std::string> s(n);
+        for(std::size_t i = 0; i < n; ++i) s[i] = std::to_string(v[i]);
+        auto expected_s = s;
+        auto negative = [](const std::string& x){ return x[0] == '-'; };
+        std::stable_partition(expected_s.begin(), expected_s.end(), negative);
+        par_stable_partition(s.begin(), s.end(), negative);
+        t.check(s == expected_s, "par_stable_partition of " + std::to_string(n) + " string");
+    }
+}
+
+// -0.0 and +0.0 are equal keys, so the radix path of par_stable_sort keeps them in input order like std::stable_sort
+template<typename T>
+void test_par_stable_sort_zeros(test_context& t, const std::string& type){
+    std::mt19937_64 rng(4);
+    for(std::size_t n : {std::size_t(2), std::size_t(1000), std::size_t(1) << 17}){
+        std::vector<T> v(n);
+        for(std::size_t i = 0; i < n; ++i) v[i] = n == 2 ? T(i == 0 ? 0.0 : -0.0) : rng() % 4 == 0 ? T(1) : rng() % 2 ? T(0.0) : T(-0.0);
+        auto expected = v;
+        std::stable_sort(expected.begin(), expected.end());
+        par_stable_sort(v.begin(), v.end());
+        bool same = true;
+        for(std::size_t i = 0; i < n; ++i) same = same && v[i] == expected[i] && std::signbit(v[i]) == std::signbit(expected[i]);
+        t.check(same, "par_stable_sort of " + std::to_string(n) + " " + type + " +-0.0");
+    }
+}
+
+// Both branches of fast_sample advance the caller's generator, so back-to-back calls draw different samples
+void test_fast_sample_advances(test_context& t){
+    std::vector<int> values(1000);
+    std::iota(values.begin(), values.end(), 0);
+    const std::set<int> ordered(values.begin(), values.end());
+    wyrand rng(5);
+    std::vector<int> a(10), b(10);
+    fast_sample(values.begin(), values.end(), a.begin(), 10, rng);
+    fast_sample(values.begin(), values.end(), b.begin(), 10, rng);
+    t.check(a != b, "fast_sample of a vector advances the generator");
+    fast_sample(ordered.begin(), ordered.end(), a.begin(), 10, rng);
+    fast_sample(ordered.begin(), ordered.end(), b.begin(), 10, rng);
+    t.check(a != b, "fast_sample of a set advances the generator");
+}
+
+// Kept slices are gathered behind the first gap, for any fraction of dropped elements and non-trivial element types
+void test_par_compact(test_context& t){
+    std::mt19937_64 rng(3);
+    const std::size_t n = 9 * parallel_chunk_elements<int>() + 5;
+    for(std::size_t per_mille : {0, 1, 10, 100, 500, 1000}){
+        std::vector<int> v(n);
+        for(auto& x : v) x = rng() % 1000 < per_mille ? -1 : int(rng() % 4);
+        auto expected = v;
+        expected.erase(std::remove_if(expected.begin(), expected.end(), [](int x){ return x < 0; }), expected.end());
+        auto w = v;
+        w.erase(par_remove_if(w.begin(), w.end(), [](int x){ return x < 0; }), w.end());
+        const std::string what = " with " + std::to_string(per_mille) + " per mille dropped";
+        t.check(w == expected, "par_remove_if" + what);
+        expected = v;
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        w = v;
+        w.erase(par_unique(w.begin(), w.end()), w.end());
+        t.check(w == expected, "par_unique" + what);
+        std::vector<std::string> s(n);
+        for(std::size_t i = 0; i < n; ++i) s[i] = std::to_string(v[i]);
+        auto expected_s = s;
+        expected_s.erase(std::remove(expected_s.begin(), expected_s.end(), "-1"), expected_s.end());
+        s.erase(par_remove_if(s.begin(), s.end(), [](const std::string& x){ return x == "-1"; }), s.end());
+        t.check(s == expected_s, "par_remove_if of strings" + what);
+    }
+}
+
+// Keys at the padding value (+inf, the largest integer) and NaN queries give the ranks of std::lower_bound / upper_bound
+template<typename T>
+void test_btree_index_limits(test_context& t, const std::string& type){
+    const T top = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    const T bottom = std::numeric_limits<T>::has_infinity ? -top : std::numeric_limits<T>::lowest();
+    std::vector<std::vector<T>> key_sets = {{top}, {1, 2, 3, top}, {bottom, top, top}, {}};
+    for(std::size_t n : {15, 16, 17, 100, 1000}){
+        std::vector<T> keys(n);
+        for(std::size_t i = 0; i < n; ++i) keys[i] = i < n - n / 4 ? T(i / 2) : top;
+        key_sets.push_back(keys);
+    }
+    std::vector<T> queries = {bottom, T(0), T(1), T(2), T(3), T(4), T(200), top};
+    if constexpr (std::numeric_limits<T>::has_quiet_NaN) queries.push_back(std::numeric_limits<T>::quiet_NaN());
+    for(auto& keys : key_sets){
+        btree_index<T> index(keys.begin(), keys.end());
+        for(T x : queries){
+            const std::size_t lower = std::lower_bound(keys.begin(), keys.end(), x) - keys.begin();
+            const std::size_t upper = std::upper_bound(keys.begin(), keys.end(), x) - keys.begin();
+            const std::string what = "btree_index<" + type + "> of " + std::to_string(keys.size()) + " keys, query " + std::to_string(x);
+            t.check(index.lower_bound(x) == lower, what + " lower_bound");
+            t.check(index.upper_bound(x) == upper, what + " upper_bound");
+            t.check(index.contains(x) == (x == x && std::binary_search(keys.begin(), keys.end(), x)), what + " contains");
+            std::size_t batch = 0;
+            index.lower_bound_batch(&x, &x + 1, &batch);
+            t.check(batch == lower, what + " lower_bound_batch");
+        }
+    }
+}
+
+int self_test(){
+    test_context t;
+    test_par_partition(t);
+    test_par_stable_partition(t);
+    test_par_compact(t);
+    test_fast_sample_advances(t);
+    test_par_stable_sort_zeros<float>(t, "float");
+    test_par_stable_sort_zeros<double>(t, "double");
+    test_btree_index_limits<double>(t, "double");
+    test_btree_index_limits<float>(t, "float");
+    test_btree_index_limits<std::int32_t>(t, "int32");
+    std::cout << (t.failures == 0 ? "all checks passed" : std::to_string(t.failures) + " checks failed") << std::endl;
+    return t.failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv){
+    if(argc > 1 && std::string(argv[1]) == "bench") return benchmark(argc, argv);
+    if(argc > 1 && std::string(argv[1]) == "test"){
+        if(std::getenv("STL_THREADS") == nullptr) setenv("STL_THREADS", "8", 0);
+        return self_test();
+    }
+
     // heap_algorithms();
     // sorting_algorithms();
     // partition_algorithms();
@@ -756,5 +9021,20 @@ int main(){
     // foo_if_algorithms();
     // other_algorithms();
     // raw_memory_algorithms();
+    // simd_numeric_algorithms();
+    // parallel_sort_algorithms();
+    // dary_heap_algorithms();
+    // search_index_algorithms();
+    // flat_set_algorithms();
+    // kway_merge_algorithms();
+    // parallel_partition_algorithms();
+    // simd_scan_algorithms();
+    // selection_algorithms();
+    // arena_algorithms();
+    // random_algorithms();
+    // sorting_network_algorithms();
+    // instrumentation_algorithms();
+    // external_memory_algorithms();
+    // thread_pool_algorithms();
     return 0;
 }
\ No newline at end of file